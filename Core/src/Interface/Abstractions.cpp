@@ -1,10 +1,13 @@
 #include "Abstractions.h"
 #include <glad/glad.h>
+#include "GLStateCache.h"
+#include "GpuMemory.h"
 #include <memory.h>
 #include "../Utils.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #define STB_IMAGE_IMPLEMENTATION  
 #include <stb/stb_image.h>
 
@@ -22,11 +25,11 @@ void InitDefaultStructures()
 }
 
 
-Shader::Shader(const std::string& filename)
+Shader::Shader(const std::string& filename, const std::vector<std::string>& defines, unsigned int version) : filePath(filename)
 {
 	std::string src = File::readFile(filename);
-	vertex = ParseShader(src, ShaderType::Vertex);
-	fragment = ParseShader(src, ShaderType::Fragment);
+	vertex = ParseShader(src, ShaderType::Vertex, defines, version);
+	fragment = ParseShader(src, ShaderType::Fragment, defines, version);
 
 	size_t start = filename.find_last_of("/") + 1;
 	size_t end = filename.find_last_of(".");
@@ -37,6 +40,8 @@ Shader::Shader(const std::string& filename)
 	unsigned int fragmentShader = CompileShader(fragment, name, ShaderType::Fragment);
 
 	this->id = LinkShaders(vertexShader, fragmentShader);
+	this->program = std::make_shared<const GLProgram>(id);
+	this->reflection = std::make_shared<ShaderReflection>(ShaderReflection::Reflect(id));
 }
 
 
@@ -48,14 +53,18 @@ Shader::Shader(const std::string& _vertex, const std::string& _fragment, const s
 	unsigned int fragmentShader = CompileShader(_fragment, name, ShaderType::Fragment);
 
 	this->id = LinkShaders(vertexShader, fragmentShader);
+	this->program = std::make_shared<const GLProgram>(id);
+	this->reflection = std::make_shared<ShaderReflection>(ShaderReflection::Reflect(id));
 }
 
-std::string Shader::ParseShader(const std::string& src, ShaderType type)
+std::string Shader::ParseShader(const std::string& src, ShaderType type, const std::vector<std::string>& defines, unsigned int version)
 {
 	std::string define = (type == ShaderType::Vertex) ? "#define VERTEX\n" : "#define FRAGMENT\n";
 	std::stringstream stream;
-	stream << "#version 330\n";
+	stream << "#version " << version << "\n";
 	stream << define;
+	for (const std::string& variant : defines)
+		stream << "#define " << variant << "\n";
 	stream << src;
 	return stream.str();
 }
@@ -83,6 +92,48 @@ unsigned int Shader::CompileShader(std::string _src, const std::string& name, Sh
 }
 
 
+static void AssignUniformBlockBindings(unsigned int program)
+{
+	static const struct { const char* Name; UniformBlockBinding Binding; } blocks[] = {
+		{ "FrameData", FrameDataBinding },
+		{ "ViewData", ViewDataBinding },
+		{ "LightData", LightDataBinding },
+		{ "ObjectData", ObjectDataBinding },
+	};
+
+	for (const auto& block : blocks)
+	{
+		GLuint index = glGetUniformBlockIndex(program, block.Name);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, block.Binding);
+	}
+}
+
+static void AssignSamplerUnits(unsigned int program)
+{
+	static const struct { const char* Name; TextureUnitBinding Unit; } samplers[] = {
+		{ "uTexture", AlbedoUnit },
+		{ "uLightBuffer", LightBufferUnit },
+		{ "uClusterBuffer", ClusterBufferUnit },
+		{ "uLightIndexBuffer", LightIndexBufferUnit },
+		{ "uShadowMap", ShadowMapUnit },
+		{ "uGBufferAlbedo", GBufferAlbedoUnit },
+		{ "uGBufferNormal", GBufferNormalUnit },
+		{ "uGBufferDepth", GBufferDepthUnit },
+	};
+
+	// Sampler values live in the program, setting them needs it bound
+	const unsigned int previousProgram = GLStateCache::GetProgram();
+	GLStateCache::UseProgram(program);
+	for (const auto& sampler : samplers)
+	{
+		GLint location = glGetUniformLocation(program, sampler.Name);
+		if (location >= 0)
+			glUniform1i(location, sampler.Unit);
+	}
+	GLStateCache::UseProgram(previousProgram);
+}
+
 unsigned int Shader::LinkShaders(unsigned int vertex, unsigned int fragment)
 {
 	unsigned int id = glCreateProgram();
@@ -90,6 +141,12 @@ unsigned int Shader::LinkShaders(unsigned int vertex, unsigned int fragment)
 	glAttachShader(id, fragment);
 	glLinkProgram(id);
 
+	// The program keeps the binary, the stages are not needed past linking
+	glDetachShader(id, vertex);
+	glDetachShader(id, fragment);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
 	GLint isLinked;
 	glGetProgramiv(id, GL_LINK_STATUS, &isLinked);
 	if (!isLinked) {
@@ -97,135 +154,394 @@ unsigned int Shader::LinkShaders(unsigned int vertex, unsigned int fragment)
 		glGetProgramInfoLog(id, 512, nullptr, infoLog);
 		std::cerr << "Shader program linking error: " << infoLog << std::endl;
 	}
+	else
+	{
+		AssignUniformBlockBindings(id);
+		AssignSamplerUnits(id);
+	}
 
 	return id;
 }
 
 
 void Shader::Bind() const {
-	glUseProgram(id);
+	GLStateCache::UseProgram(id);
 }
 void Shader::Unbind() const {
-	glUseProgram(0);
+	GLStateCache::UseProgram(0);
 }
 
 
 
 
-void Shader::SetUniform1i(const std::string& name, int val) {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), val);
+/*
+	Upload and GL type of every type the typed interface accepts
+*/
+
+template<typename T> struct UniformTraits;
+
+#define UNIFORM_TRAITS(T, GLType, Call) \
+	template<> struct UniformTraits<T> \
+	{ \
+		static constexpr GLenum Type = GLType; \
+		static void Upload(GLint location, const T& value) { Call; } \
+	};
+
+UNIFORM_TRAITS(int, GL_INT, glUniform1i(location, value))
+UNIFORM_TRAITS(glm::ivec2, GL_INT_VEC2, glUniform2i(location, value.x, value.y))
+UNIFORM_TRAITS(glm::ivec3, GL_INT_VEC3, glUniform3i(location, value.x, value.y, value.z))
+UNIFORM_TRAITS(glm::ivec4, GL_INT_VEC4, glUniform4i(location, value.x, value.y, value.z, value.w))
+UNIFORM_TRAITS(unsigned int, GL_UNSIGNED_INT, glUniform1ui(location, value))
+UNIFORM_TRAITS(glm::uvec2, GL_UNSIGNED_INT_VEC2, glUniform2ui(location, value.x, value.y))
+UNIFORM_TRAITS(glm::uvec3, GL_UNSIGNED_INT_VEC3, glUniform3ui(location, value.x, value.y, value.z))
+UNIFORM_TRAITS(glm::uvec4, GL_UNSIGNED_INT_VEC4, glUniform4ui(location, value.x, value.y, value.z, value.w))
+UNIFORM_TRAITS(float, GL_FLOAT, glUniform1f(location, value))
+UNIFORM_TRAITS(glm::vec2, GL_FLOAT_VEC2, glUniform2f(location, value.x, value.y))
+UNIFORM_TRAITS(glm::vec3, GL_FLOAT_VEC3, glUniform3f(location, value.x, value.y, value.z))
+UNIFORM_TRAITS(glm::vec4, GL_FLOAT_VEC4, glUniform4f(location, value.x, value.y, value.z, value.w))
+UNIFORM_TRAITS(glm::mat2, GL_FLOAT_MAT2, glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value)))
+UNIFORM_TRAITS(glm::mat3, GL_FLOAT_MAT3, glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)))
+UNIFORM_TRAITS(glm::mat4, GL_FLOAT_MAT4, glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)))
+
+#undef UNIFORM_TRAITS
+
+static bool IsSamplerType(GLenum type)
+{
+	switch (type)
+	{
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_BUFFER:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		return true;
+	default:
+		return false;
+	}
 }
 
-void Shader::SetUniform2i(const std::string& name, const glm::ivec2& value) {
-	glUniform2i(glGetUniformLocation(id, name.c_str()), value.x, value.y);
+template<typename T>
+UniformHandle<T> Shader::GetUniform(UniformName name) const
+{
+	if (!reflection)
+		return UniformHandle<T>();
+
+	int index = reflection->FindUniform(name.Hash);
+	if (index < 0)
+		return UniformHandle<T>();
+
+	const GLenum type = reflection->Uniforms[index].Type;
+	const bool samplerUnit = UniformTraits<T>::Type == GL_INT && IsSamplerType(type);
+	if (type != UniformTraits<T>::Type && !samplerUnit)
+	{
+		UniformInfo& uniform = reflection->Uniforms[index];
+		if (!uniform.TypeMismatchReported)
+			std::cerr << "Uniform " << name.Name << " of shader " << this->name << " does not match the requested type" << std::endl;
+		uniform.TypeMismatchReported = true;
+		return UniformHandle<T>();
+	}
+
+	return UniformHandle<T>(index);
 }
 
-void Shader::SetUniform3i(const std::string& name, const glm::ivec3& value) {
-	glUniform3i(glGetUniformLocation(id, name.c_str()), value.x, value.y, value.z);
+template<typename T>
+bool Shader::Set(UniformHandle<T> handle, const T& value) const
+{
+	if (!handle.IsValid() || !reflection || handle.GetIndex() >= static_cast<int>(reflection->Uniforms.size()))
+		return false;
+
+	UniformInfo& uniform = reflection->Uniforms[handle.GetIndex()];
+
+	if (reflection->CacheValues && uniform.CacheSize >= sizeof(T))
+	{
+		unsigned char* cached = reflection->Values.data() + uniform.CacheOffset;
+		if (uniform.CacheValid && memcmp(cached, &value, sizeof(T)) == 0)
+			return false;
+
+		memcpy(cached, &value, sizeof(T));
+		uniform.CacheValid = true;
+	}
+
+	UniformTraits<T>::Upload(uniform.Location, value);
+	return true;
 }
 
-void Shader::SetUniform4i(const std::string& name, const glm::ivec4& value) {
-	glUniform4i(glGetUniformLocation(id, name.c_str()), value.x, value.y, value.z, value.w);
+#define INSTANTIATE_UNIFORM_TYPE(T) \
+	template UniformHandle<T> Shader::GetUniform<T>(UniformName name) const; \
+	template bool Shader::Set<T>(UniformHandle<T> handle, const T& value) const;
+
+INSTANTIATE_UNIFORM_TYPE(int)
+INSTANTIATE_UNIFORM_TYPE(glm::ivec2)
+INSTANTIATE_UNIFORM_TYPE(glm::ivec3)
+INSTANTIATE_UNIFORM_TYPE(glm::ivec4)
+INSTANTIATE_UNIFORM_TYPE(unsigned int)
+INSTANTIATE_UNIFORM_TYPE(glm::uvec2)
+INSTANTIATE_UNIFORM_TYPE(glm::uvec3)
+INSTANTIATE_UNIFORM_TYPE(glm::uvec4)
+INSTANTIATE_UNIFORM_TYPE(float)
+INSTANTIATE_UNIFORM_TYPE(glm::vec2)
+INSTANTIATE_UNIFORM_TYPE(glm::vec3)
+INSTANTIATE_UNIFORM_TYPE(glm::vec4)
+INSTANTIATE_UNIFORM_TYPE(glm::mat2)
+INSTANTIATE_UNIFORM_TYPE(glm::mat3)
+INSTANTIATE_UNIFORM_TYPE(glm::mat4)
+
+#undef INSTANTIATE_UNIFORM_TYPE
+
+const UniformBlockInfo* Shader::GetUniformBlock(UniformName name) const
+{
+	if (!reflection)
+		return nullptr;
+
+	int index = reflection->FindBlock(name.Hash);
+	return index >= 0 ? &reflection->Blocks[index] : nullptr;
 }
 
-void Shader::SetUniform1ui(const std::string& name, unsigned int val) {
-	glUniform1ui(glGetUniformLocation(id, name.c_str()), val);
+void Shader::SetValueCaching(bool enabled)
+{
+	if (!reflection)
+		return;
+
+	reflection->CacheValues = enabled;
+	for (UniformInfo& uniform : reflection->Uniforms)
+		uniform.CacheValid = false;
 }
 
-void Shader::SetUniform2ui(const std::string& name, const glm::uvec2& value) {
-	glUniform2ui(glGetUniformLocation(id, name.c_str()), value.x, value.y);
+// Array uploads bypass the value cache, so the cached value is dropped
+int Shader::GetUniformLocation(UniformName name) const
+{
+	if (!reflection)
+		return -1;
+
+	int index = reflection->FindUniform(name.Hash);
+	if (index < 0)
+		return -1;
+
+	reflection->Uniforms[index].CacheValid = false;
+	return reflection->Uniforms[index].Location;
 }
 
-void Shader::SetUniform3ui(const std::string& name, const glm::uvec3& value) {
-	glUniform3ui(glGetUniformLocation(id, name.c_str()), value.x, value.y, value.z);
+
+void Shader::SetUniform1i(UniformName name, int val) const {
+	SetUniform(name, val);
 }
 
-void Shader::SetUniform4ui(const std::string& name, const glm::uvec4& value) {
-	glUniform4ui(glGetUniformLocation(id, name.c_str()), value.x, value.y, value.z, value.w);
+void Shader::SetUniform2i(UniformName name, const glm::ivec2& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniform1f(const std::string& name, float val) {
-	glUniform1f(glGetUniformLocation(id, name.c_str()), val);
+void Shader::SetUniform3i(UniformName name, const glm::ivec3& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniform2f(const std::string& name, const glm::vec2& value) {
-	glUniform2f(glGetUniformLocation(id, name.c_str()), value.x, value.y);
+void Shader::SetUniform4i(UniformName name, const glm::ivec4& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniform3f(const std::string& name, const glm::vec3& value) {
-	glUniform3f(glGetUniformLocation(id, name.c_str()), value.x, value.y, value.z);
+void Shader::SetUniform1ui(UniformName name, unsigned int val) const {
+	SetUniform(name, val);
 }
 
-void Shader::SetUniform4f(const std::string& name, const glm::vec4& value) {
-	glUniform4f(glGetUniformLocation(id, name.c_str()), value.x, value.y, value.z, value.w);
+void Shader::SetUniform2ui(UniformName name, const glm::uvec2& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniformMatrix2fv(const std::string& name, const glm::mat2& matrix) {
-	glUniformMatrix2fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix));
+void Shader::SetUniform3ui(UniformName name, const glm::uvec3& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniformMatrix3fv(const std::string& name, const glm::mat3& matrix) {
-	glUniformMatrix3fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix));
+void Shader::SetUniform4ui(UniformName name, const glm::uvec4& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniformMatrix4fv(const std::string& name, const glm::mat4& matrix) {
-	glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix));
+void Shader::SetUniform1f(UniformName name, float val) const {
+	SetUniform(name, val);
 }
 
-void Shader::SetUniform1iv(const std::string& name, int count, const int* values) {
-	glUniform1iv(glGetUniformLocation(id, name.c_str()), count, values);
+void Shader::SetUniform2f(UniformName name, const glm::vec2& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniform1fv(const std::string& name, int count, const float* values) {
-	glUniform1fv(glGetUniformLocation(id, name.c_str()), count, values);
+void Shader::SetUniform3f(UniformName name, const glm::vec3& value) const {
+	SetUniform(name, value);
 }
 
-void Shader::SetUniform3fv(const std::string& name, int count, const glm::vec3* values) {
-	glUniform3fv(glGetUniformLocation(id, name.c_str()), count, glm::value_ptr(*values));
+void Shader::SetUniform4f(UniformName name, const glm::vec4& value) const {
+	SetUniform(name, value);
+}
+
+void Shader::SetUniformMatrix2fv(UniformName name, const glm::mat2& matrix) const {
+	SetUniform(name, matrix);
+}
+
+void Shader::SetUniformMatrix3fv(UniformName name, const glm::mat3& matrix) const {
+	SetUniform(name, matrix);
+}
+
+void Shader::SetUniformMatrix4fv(UniformName name, const glm::mat4& matrix) const {
+	SetUniform(name, matrix);
+}
+
+void Shader::SetUniform1iv(UniformName name, int count, const int* values) const {
+	glUniform1iv(GetUniformLocation(name), count, values);
+}
+
+void Shader::SetUniform1fv(UniformName name, int count, const float* values) const {
+	glUniform1fv(GetUniformLocation(name), count, values);
+}
+
+void Shader::SetUniform3fv(UniformName name, int count, const glm::vec3* values) const {
+	glUniform3fv(GetUniformLocation(name), count, glm::value_ptr(*values));
 }
 
 
 
 Texture::Texture(std::string path) : filePath(path)
 {
-	glGenTextures(1, &id);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);  // Horizontal wrapping (S axis)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  // Vertical wrapping (T axis)
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Minifying filter
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Magnifying filter
+	if (!Restore())
+		std::cerr << "Failed to load texture" << std::endl;
+}
 
-	data = stbi_load(path.c_str(), &width, &height, &nChannels, 0);
+namespace
+{
+	struct TextureFormat
+	{
+		GLenum Format;
+		GLenum InternalFormat;
+		unsigned int TexelSize;
+	};
 
-	if (data)
+	TextureFormat GetTextureFormat(int channels)
 	{
-		if (nChannels == 4) {
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		switch (channels)
+		{
+		case 1: return { GL_RED, GL_R8, 1 };
+		case 2: return { GL_RG, GL_RG8, 2 };
+		case 3: return { GL_RGB, GL_RGB8, 3 };
+		default: return { GL_RGBA, GL_RGBA8, 4 };
 		}
-		else {
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+	}
+
+	// Level 0 and every level below it down to 1x1
+	size_t GetMipChainBytes(int width, int height, unsigned int texelSize)
+	{
+		size_t bytes = 0;
+		while (true)
+		{
+			bytes += static_cast<size_t>(width) * height * texelSize;
+			if (width == 1 && height == 1)
+				return bytes;
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
 		}
 	}
-	else
+}
+
+// Replaces the resident texture, the old one stays alive for the frames still drawing with it.
+// Without pixels level 0 is left for the caller to fill, and the mips to generate.
+void Texture::Upload(const unsigned char* pixels, int levelWidth, int levelHeight)
+{
+	GLTexture texture = GLTexture::Create();
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture.Get());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);  // Horizontal wrapping (S axis)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  // Vertical wrapping (T axis)
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Minifying filter
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Magnifying filter
+
+	// Grey images read as grey instead of red
+	const TextureFormat format = GetTextureFormat(nChannels);
+	if (nChannels <= 2)
 	{
-		std::cerr << "Failed to load texture" << std::endl;
+		const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, nChannels == 2 ? GL_GREEN : GL_ONE };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
 	}
 
+	// Rows of RGB images are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, format.InternalFormat, levelWidth, levelHeight, 0, format.Format, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	if (pixels)
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+	residentBytes = GetMipChainBytes(levelWidth, levelHeight, format.TexelSize);
+	GpuMemory::Track(GpuMemoryCategory::Texture, GLObjectType::Texture, texture.Get(), residentBytes, filePath);
+
+	object = std::make_shared<const GLTexture>(std::move(texture));
+	id = object->Get();
+}
+
+bool Texture::Demote()
+{
+	const int levelWidth = std::max(width >> (droppedLevels + 1), 1);
+	const int levelHeight = std::max(height >> (droppedLevels + 1), 1);
+	if (!IsResident() || std::max(levelWidth, levelHeight) < MinResidentSize)
+		return false;
+
+	// Level 1 of the resident texture is the next demotion step. It is blitted into the
+	// new texture on the GPU, reading it back would stall on every frame in flight.
+	const std::shared_ptr<const GLTexture> previous = object;
+	Upload(nullptr, levelWidth, levelHeight);
+
+	const unsigned int framebuffer = GLStateCache::GetFramebuffer();
+	GLFramebuffer source = GLFramebuffer::Create();
+	GLFramebuffer destination = GLFramebuffer::Create();
+	GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, source.Get());
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, previous->Get(), 1);
+	GLStateCache::BindFramebuffer(GL_DRAW_FRAMEBUFFER, destination.Get());
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, id, 0);
+	glBlitFramebuffer(0, 0, levelWidth, levelHeight, 0, 0, levelWidth, levelHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, id);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	droppedLevels++;
+	return true;
+}
+
+void Texture::Evict()
+{
+	object.reset();
+	id = 0;
+	residentBytes = 0;
+}
+
+bool Texture::Restore()
+{
+	int fileWidth, fileHeight, fileChannels;
+	data = stbi_load(filePath.c_str(), &fileWidth, &fileHeight, &fileChannels, 0);
+	if (!data)
+		return false;
+
+	width = fileWidth;
+	height = fileHeight;
+	nChannels = fileChannels;
+	Upload(data, width, height);
+	droppedLevels = 0;
+
 	stbi_image_free(data);
+	data = nullptr;
+	return true;
+}
 
+size_t Texture::GetFullBytes() const
+{
+	return GetMipChainBytes(width, height, GetTextureFormat(nChannels).TexelSize);
 }
 
-void Texture::Bind(unsigned int tex)
+void Texture::Bind(unsigned int tex) const
 {
 	textureIndex = tex;
-	glActiveTexture(GL_TEXTURE0 + tex);
-	glBindTexture(GL_TEXTURE_2D, id);
+	GLStateCache::BindTexture(tex, GL_TEXTURE_2D, id);
 }
 
 void Texture::Unbind()
 {
-	glBindTexture(GL_TEXTURE_2D, id);
+	GLStateCache::BindTexture(textureIndex, GL_TEXTURE_2D, 0);
 }
 
@@ -1,9 +1,14 @@
 #pragma once
+#include <cstdint>
 #include <memory.h>
+#include <memory>
 #include <string>
 #include <glm/glm.hpp>
 #include <vector>
 
+#include "GLResource.h"
+#include "ShaderReflection.h"
+
 
 
 enum ShaderType
@@ -12,6 +17,36 @@ enum ShaderType
 	Fragment
 };
 
+/*
+	Fixed binding points of the uniform blocks shared by all programs,
+	every program gets them assigned right after linking
+*/
+
+enum UniformBlockBinding
+{
+	FrameDataBinding = 0,
+	ViewDataBinding = 1,
+	LightDataBinding = 2,
+	ObjectDataBinding = 3
+};
+
+/*
+	Fixed texture units of the samplers shared by all programs, assigned along
+	with the block bindings, so binding a program never sets sampler uniforms
+*/
+
+enum TextureUnitBinding
+{
+	AlbedoUnit = 0,
+	LightBufferUnit = 1,
+	ClusterBufferUnit = 2,
+	LightIndexBufferUnit = 3,
+	ShadowMapUnit = 4,
+	GBufferAlbedoUnit = 5,
+	GBufferNormalUnit = 6,
+	GBufferDepthUnit = 7
+};
+
 /*
 	Shader abstraction
 */
@@ -20,41 +55,58 @@ class Shader
 {
 public:
 	Shader() = default;
-	Shader(const std::string& filename);
+	Shader(const std::string& filename, const std::vector<std::string>& defines = {}, unsigned int version = 330);
 	Shader(const std::string& vertex, const std::string& fragment, const std::string& name = "");
 	~Shader() = default;
 
-	static std::string ParseShader(const std::string& src, ShaderType type);
+	static std::string ParseShader(const std::string& src, ShaderType type, const std::vector<std::string>& defines = {}, unsigned int version = 330);
 	static unsigned int CompileShader(std::string src, const std::string& name, ShaderType type);
 	static unsigned int LinkShaders(unsigned int vertex, unsigned int fragment);
 
 	// Integer uniforms
-	void SetUniform1i(const std::string& name, int val);
-	void SetUniform2i(const std::string& name, const glm::ivec2& value);
-	void SetUniform3i(const std::string& name, const glm::ivec3& value);
-	void SetUniform4i(const std::string& name, const glm::ivec4& value);
+	void SetUniform1i(UniformName name, int val) const;
+	void SetUniform2i(UniformName name, const glm::ivec2& value) const;
+	void SetUniform3i(UniformName name, const glm::ivec3& value) const;
+	void SetUniform4i(UniformName name, const glm::ivec4& value) const;
 
 	// Unsigned Integer Uniforms
-	void SetUniform1ui(const std::string& name, unsigned int val);
-	void SetUniform2ui(const std::string& name, const glm::uvec2& value);
-	void SetUniform3ui(const std::string& name, const glm::uvec3& value);
-	void SetUniform4ui(const std::string& name, const glm::uvec4& value);
+	void SetUniform1ui(UniformName name, unsigned int val) const;
+	void SetUniform2ui(UniformName name, const glm::uvec2& value) const;
+	void SetUniform3ui(UniformName name, const glm::uvec3& value) const;
+	void SetUniform4ui(UniformName name, const glm::uvec4& value) const;
 
 	// Float Uniforms
-	void SetUniform1f(const std::string& name, float val);
-	void SetUniform2f(const std::string& name, const glm::vec2& value);
-	void SetUniform3f(const std::string& name, const glm::vec3& value);
-	void SetUniform4f(const std::string& name, const glm::vec4& value);
+	void SetUniform1f(UniformName name, float val) const;
+	void SetUniform2f(UniformName name, const glm::vec2& value) const;
+	void SetUniform3f(UniformName name, const glm::vec3& value) const;
+	void SetUniform4f(UniformName name, const glm::vec4& value) const;
 
 	// Matrix Uniforms (2x2, 3x3, 4x4)
-	void SetUniformMatrix2fv(const std::string& name, const glm::mat2& matrix);
-	void SetUniformMatrix3fv(const std::string& name, const glm::mat3& matrix);
-	void SetUniformMatrix4fv(const std::string& name, const glm::mat4& matrix);
+	void SetUniformMatrix2fv(UniformName name, const glm::mat2& matrix) const;
+	void SetUniformMatrix3fv(UniformName name, const glm::mat3& matrix) const;
+	void SetUniformMatrix4fv(UniformName name, const glm::mat4& matrix) const;
 
 	// Other Types (For Example, Vectors Or Arrays)
-	void SetUniform1iv(const std::string& name, int count, const int* values);
-	void SetUniform1fv(const std::string& name, int count, const float* values);
-	void SetUniform3fv(const std::string& name, int count, const glm::vec3* values);
+	void SetUniform1iv(UniformName name, int count, const int* values) const;
+	void SetUniform1fv(UniformName name, int count, const float* values) const;
+	void SetUniform3fv(UniformName name, int count, const glm::vec3* values) const;
+
+	/*
+		Typed access through the reflected uniform table. Resolve handles once and
+		keep them, setting is then an index plus the glUniform call. With value
+		caching on, uploads of an unchanged value are skipped; Set returns whether
+		anything was uploaded.
+	*/
+	template<typename T>
+	UniformHandle<T> GetUniform(UniformName name) const;
+	template<typename T>
+	bool Set(UniformHandle<T> handle, const T& value) const;
+	template<typename T>
+	bool SetUniform(UniformName name, const T& value) const { return Set(GetUniform<T>(name), value); }
+
+	const UniformBlockInfo* GetUniformBlock(UniformName name) const;
+	const ShaderReflection* GetReflection() const { return reflection.get(); }
+	void SetValueCaching(bool enabled);
 
 	void Bind() const;
 	void Unbind() const;
@@ -62,7 +114,8 @@ public:
 
 	inline std::string GetName() { return this->name; }
 	inline void SetName(const std::string& name) { this->name = name; }
-	inline unsigned int GetId() { return id; }
+	inline unsigned int GetId() const { return id; }
+	inline const std::string& GetFilePath() const { return filePath; }
 
 
 	static Shader DefaultShader;
@@ -71,21 +124,39 @@ private:
 	std::string name;
 	std::string vertex;
 	std::string fragment;
-	unsigned int id;
+	std::string filePath;
+	unsigned int id = 0;
+	// Copies share the program, it is deleted with the last of them
+	std::shared_ptr<const GLProgram> program;
+	std::shared_ptr<ShaderReflection> reflection;
+
+	int GetUniformLocation(UniformName name) const;
 };
 
 class Texture
 {
 private:
-	unsigned int id;
+	unsigned int id = 0;
+	// Copies share the texture, it is deleted with the last of them
+	std::shared_ptr<const GLTexture> object;
 	unsigned char* data;
-	int width;
-	int height;
-	int nChannels;
-	unsigned int textureIndex;
+	int width = 0;
+	int height = 0;
+	int nChannels = 0;
+	mutable unsigned int textureIndex;
 	std::string filePath;
 
+	// Mip levels given up to the memory budget, the resident texture starts at this one
+	unsigned int droppedLevels = 0;
+	size_t residentBytes = 0;
+	mutable uint64_t lastUsedFrame = 0;
+
+	void Upload(const unsigned char* pixels, int levelWidth, int levelHeight);
+
 public:
+	// Demoting stops at this size, the next step is eviction
+	static constexpr int MinResidentSize = 32;
+
 	Texture() = default;
 	Texture(std::string path);
 	Texture(unsigned char* data, int width, int height) {}
@@ -94,12 +165,31 @@ public:
 	static Texture DefaultTexture;
 
 public:
-	void Bind(unsigned int tex = 0);
+	void Bind(unsigned int tex = 0) const;
 	void Unbind();
 
-	inline unsigned int GetId() { return id; }
+	/*
+		Residency, for textures loaded from a file. Demote replaces the texture
+		with its next mip and returns false once that would go below MinResidentSize.
+		Evict frees it entirely. Restore reloads the full texture from the file.
+	*/
+	bool Demote();
+	void Evict();
+	bool Restore();
+
+	bool IsResident() const { return id != 0; }
+	bool CanEvict() const { return !filePath.empty() && width > 0; }
+	unsigned int GetDroppedLevels() const { return droppedLevels; }
+	size_t GetResidentBytes() const { return residentBytes; }
+	// Estimated size with every level resident
+	size_t GetFullBytes() const;
+
+	void MarkUsed(uint64_t frame) const { lastUsedFrame = frame; }
+	uint64_t GetLastUsedFrame() const { return lastUsedFrame; }
+
+	inline unsigned int GetId() const { return id; }
 	inline unsigned int GetIndex() { return textureIndex; }
-	inline std::string GetFilePath() { return this->filePath; }
+	inline const std::string& GetFilePath() const { return filePath; }
 };
 
 
@@ -4,8 +4,13 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #include "Exception.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
 
 
 /*
@@ -13,75 +18,88 @@
  *
  */
 
-VertexBuffer::VertexBuffer(const void* data, unsigned int size) {
-	glGenBuffers(1, &m_RendererID);
-	glBindBuffer(GL_ARRAY_BUFFER, m_RendererID);
+VertexBuffer::VertexBuffer(const void* data, unsigned int size) : m_RendererID(GLBuffer::Create()), m_Size(size) {
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_RendererID.Get());
 	glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+	GpuMemory::Track(GpuMemoryCategory::VertexBuffer, GLObjectType::Buffer, m_RendererID.Get(), size);
 
 #ifdef DEBUG
-	std::cout << "Creating buffer :" << m_RendererID << std::endl;
-#endif
-}
-
-VertexBuffer::~VertexBuffer() {
-	//glDeleteBuffers(1, &m_RendererID);
-
-#ifdef DEBUG
-	std::cout << "~VertexBuffer :" << m_RendererID << std::endl;
+	std::cout << "Creating buffer :" << m_RendererID.Get() << std::endl;
 #endif
 }
 
 void VertexBuffer::Bind() const {
-	glBindBuffer(GL_ARRAY_BUFFER, m_RendererID);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_RendererID.Get());
 #ifdef DEBUG
-	std::cout << "Binding buffer :" << m_RendererID << std::endl;
+	std::cout << "Binding buffer :" << m_RendererID.Get() << std::endl;
 #endif
 
 }
 
 void VertexBuffer::Unbind() const {
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
 
 #ifdef DEBUG
-	std::cout << "Unbinding buffer :" << m_RendererID << std::endl;
+	std::cout << "Unbinding buffer :" << m_RendererID.Get() << std::endl;
 #endif
 
 }
 
+void VertexBuffer::UploadData(const void* data, unsigned int size)
+{
+	if (!m_RendererID)
+		m_RendererID = GLBuffer::Create();
+
+	// Orphan the old storage so the driver does not wait for draws still reading it
+	m_Size = std::max(size, m_Size);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_RendererID.Get());
+	glBufferData(GL_ARRAY_BUFFER, m_Size, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+	GpuMemory::Track(GpuMemoryCategory::VertexBuffer, GLObjectType::Buffer, m_RendererID.Get(), m_Size);
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const
+{
+	if (Stride != other.Stride || Attributes.size() != other.Attributes.size())
+		return false;
+
+	for (size_t i = 0; i < Attributes.size(); i++)
+	{
+		const VertexAttribute& a = Attributes[i];
+		const VertexAttribute& b = other.Attributes[i];
+		if (a.Location != b.Location || a.Components != b.Components || a.Type != b.Type
+			|| a.Normalized != b.Normalized || a.Offset != b.Offset)
+			return false;
+	}
+	return true;
+}
+
 /*
  *	Vertex Array implementation
  *
  */
 
 
-VertexArray::VertexArray() {
-	glGenVertexArrays(1, &m_RendererID);
+VertexArray::VertexArray() : m_RendererID(GLVertexArray::Create()) {
 
 #ifdef DEBUG
-	std::cout << "Creating array :" << m_RendererID << std::endl;
-#endif
-}
-
-VertexArray::~VertexArray() {
-	//glDeleteVertexArrays(1, &m_RendererID);
-#ifdef DEBUG
-	std::cout << "Deleting array :" << m_RendererID << std::endl;
+	std::cout << "Creating array :" << m_RendererID.Get() << std::endl;
 #endif
 }
 
 void VertexArray::Bind() const {
-	glBindVertexArray(m_RendererID);
+	GLStateCache::BindVertexArray(m_RendererID.Get());
 #ifdef DEBUGX
-	std::cout << "Binding array :" << m_RendererID << std::endl;
+	std::cout << "Binding array :" << m_RendererID.Get() << std::endl;
 #endif
 
 }
 
 void VertexArray::Unbind() const {
-	glBindVertexArray(0);
+	GLStateCache::BindVertexArray(0);
 
 #ifdef DEBUG
-	std::cout << "Unbinding array :" << m_RendererID << std::endl;
+	std::cout << "Unbinding array :" << m_RendererID.Get() << std::endl;
 #endif
 
 
@@ -94,19 +112,34 @@ void VertexArray::AddBuffer(const VertexBuffer &buffer, BufferIndex bindMode, un
 	glVertexAttribPointer(bindMode, size, GL_FLOAT, GL_FALSE, sizeof(float) * size, 0);
 
 #ifdef DEBUG
-	std::cout << "Adding attrib : " << bindMode << " to array :" << m_RendererID << std::endl;
+	std::cout << "Adding attrib : " << bindMode << " to array :" << m_RendererID.Get() << std::endl;
 #endif
 }
 
-void VertexArray::AddBuffer(const std::vector<float> &data, BufferIndex bindMode, unsigned int size)
+void VertexArray::SetLayout(unsigned int buffer, const VertexLayout& layout)
 {
 	Bind();
-	unsigned int vbo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, size, data.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(bindMode);
-	glVertexAttribPointer(bindMode, size, GL_FLOAT, GL_FALSE, sizeof(float) * size, 0);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (const VertexAttribute& attribute : layout.Attributes)
+	{
+		glEnableVertexAttribArray(attribute.Location);
+		glVertexAttribPointer(attribute.Location, attribute.Components, attribute.Type, attribute.Normalized ? GL_TRUE : GL_FALSE,
+			layout.Stride, reinterpret_cast<const void*>(static_cast<uintptr_t>(attribute.Offset)));
+	}
+}
+
+void VertexArray::AddInstanceBuffer(unsigned int buffer, BufferIndex bindMode, unsigned int offset) const
+{
+	Bind();
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		unsigned int location = bindMode + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			reinterpret_cast<const void*>(static_cast<uintptr_t>(offset + column * sizeof(glm::vec4))));
+		glVertexAttribDivisor(location, 1);
+	}
 }
 
 
@@ -116,52 +149,284 @@ void VertexArray::AddBuffer(const std::vector<float> &data, BufferIndex bindMode
  *
  */
 
-IndexBuffer::IndexBuffer(unsigned int* data, int count) : count(count)
+IndexBuffer::IndexBuffer(unsigned int* data, int count) : id(GLBuffer::Create()), count(count)
 {
-	glGenBuffers(1, &id);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, id.Get());
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW);
+	GpuMemory::Track(GpuMemoryCategory::IndexBuffer, GLObjectType::Buffer, id.Get(), count * sizeof(unsigned int));
 }
 
 void IndexBuffer::Bind()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, id.Get());
 }
 
 
 void IndexBuffer::Unbind()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-UniformBuffer::UniformBuffer()
+UniformBuffer::UniformBuffer() : m_RendererID(GLBuffer::Create()), m_Slot(0), m_Size(0)
 {
-	glGenBuffers(1, &m_RendererID);
 }
 
-UniformBuffer::UniformBuffer(const void* data, unsigned int size) : m_Slot(0)
+UniformBuffer::UniformBuffer(const void* data, unsigned int size) : m_RendererID(GLBuffer::Create()), m_Slot(0), m_Size(size)
 {
-	glGenBuffers(1, &m_RendererID);
-	glBindBuffer(GL_UNIFORM_BUFFER, m_RendererID);
+	GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, m_RendererID.Get());
 	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	GpuMemory::Track(GpuMemoryCategory::UniformBuffer, GLObjectType::Buffer, m_RendererID.Get(), size);
+	GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void UniformBuffer::Bind(unsigned int slot)
 {
 	m_Slot = slot;
-	glBindBufferBase(GL_UNIFORM_BUFFER, slot, m_RendererID);
+	GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, slot, m_RendererID.Get());
 }
 
 void UniformBuffer::Unbind()
 {
-	glBindBufferBase(GL_UNIFORM_BUFFER, m_Slot, 0);
+	GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, m_Slot, 0);
 }
 
 
 void UniformBuffer::UploadData(const void* data, unsigned int size)
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, m_RendererID);
-	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-}
\ No newline at end of file
+	GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, m_RendererID.Get());
+	if (size > m_Size)
+	{
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		m_Size = size;
+		GpuMemory::Track(GpuMemoryCategory::UniformBuffer, GLObjectType::Buffer, m_RendererID.Get(), size);
+	}
+	else
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	}
+	GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+/*
+ *
+ *  StreamingBuffer implementation
+ *
+ */
+
+StreamingBuffer::StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int regionCount)
+	: m_Target(target), m_RegionSize(0), m_RegionCount(regionCount), m_Region(0), m_Head(0), m_Frame(~0ull), m_Alignment(1), m_Mapped(nullptr)
+{
+	// Vertex attributes and indirect commands read 4 byte words
+	GLint alignment = 4;
+	if (target == GL_UNIFORM_BUFFER)
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	else if (target == GL_SHADER_STORAGE_BUFFER)
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	m_Alignment = static_cast<unsigned int>(std::max(alignment, 1));
+
+	Create(regionSize);
+}
+
+void StreamingBuffer::Create(unsigned int regionSize)
+{
+	if (m_RendererID)
+	{
+		// The old buffer is only deleted once the frames already issued completed
+		for (void*& fence : m_Fences)
+		{
+			if (fence)
+				glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+		GLStateCache::BindBuffer(m_Target, m_RendererID.Get());
+		if (m_Mapped)
+			glUnmapBuffer(m_Target);
+	}
+
+	m_RegionSize = GetAlignedSize(regionSize);
+	m_Fences.assign(m_RegionCount, nullptr);
+	m_Head = 0;
+	m_Mapped = nullptr;
+
+	const GLsizeiptr totalSize = static_cast<GLsizeiptr>(m_RegionSize) * m_RegionCount;
+
+	m_RendererID = GLBuffer::Create();
+	GLStateCache::BindBuffer(m_Target, m_RendererID.Get());
+
+	if (GLCapabilities::Get().BufferStorage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(m_Target, totalSize, nullptr, flags);
+		m_Mapped = static_cast<unsigned char*>(glMapBufferRange(m_Target, 0, totalSize, flags));
+	}
+	else
+	{
+		glBufferData(m_Target, totalSize, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	const GpuMemoryCategory category = m_Target == GL_UNIFORM_BUFFER ? GpuMemoryCategory::UniformBuffer : GpuMemoryCategory::OtherBuffer;
+	GpuMemory::Track(category, GLObjectType::Buffer, m_RendererID.Get(), totalSize);
+
+	GLStateCache::BindBuffer(m_Target, 0);
+}
+
+void StreamingBuffer::BeginFrame(uint64_t frame)
+{
+	if (!m_RendererID || frame == m_Frame)
+		return;
+
+	m_Frame = frame;
+	m_Region = static_cast<unsigned int>(frame % m_RegionCount);
+	m_Head = 0;
+
+	GLsync fence = static_cast<GLsync>(m_Fences[m_Region]);
+	if (!fence)
+		return;
+
+	// Only blocks when the CPU is a full ring ahead of the GPU
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+	glDeleteSync(fence);
+	m_Fences[m_Region] = nullptr;
+}
+
+void StreamingBuffer::EndFrame()
+{
+	if (!m_RendererID)
+		return;
+	if (m_Fences[m_Region])
+		glDeleteSync(static_cast<GLsync>(m_Fences[m_Region]));
+	m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingBuffer::Reserve(unsigned int size)
+{
+	const unsigned int end = GetAlignedSize(m_Head) + size;
+	if (end > m_RegionSize)
+		Create(std::max(m_RegionSize * 2, end));
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Push(const void* data, unsigned int size)
+{
+	unsigned int offset = GetAlignedSize(m_Head);
+
+	if (offset + size > m_RegionSize)
+	{
+		std::cerr << "StreamingBuffer region of " << m_RegionSize << " bytes exhausted, growing" << std::endl;
+		Create(std::max(m_RegionSize * 2, size));
+		offset = 0;
+	}
+
+	m_Head = offset + size;
+	const unsigned int absolute = m_Region * m_RegionSize + offset;
+
+	if (m_Mapped)
+	{
+		memcpy(m_Mapped + absolute, data, size);
+	}
+	else
+	{
+		GLStateCache::BindBuffer(m_Target, m_RendererID.Get());
+		glBufferSubData(m_Target, absolute, size, data);
+	}
+
+	return Allocation{ absolute, size };
+}
+
+void StreamingBuffer::BindRange(unsigned int slot, const Allocation& allocation) const
+{
+	GLStateCache::BindBufferRange(m_Target, slot, m_RendererID.Get(), allocation.Offset, allocation.Size);
+}
+
+
+/*
+ *
+ *  StorageBuffer implementation
+ *
+ */
+
+void StorageBuffer::Bind(unsigned int slot)
+{
+	GLStateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, m_RendererID.Get());
+}
+
+void StorageBuffer::UploadData(const void* data, unsigned int size)
+{
+	if (!m_RendererID)
+		m_RendererID = GLBuffer::Create();
+
+	m_Size = std::max(size, m_Size);
+	GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_RendererID.Get());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_Size, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+	GpuMemory::Track(GpuMemoryCategory::OtherBuffer, GLObjectType::Buffer, m_RendererID.Get(), m_Size);
+	GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+/*
+ *
+ *  TextureBuffer implementation
+ *
+ */
+
+TextureBuffer::TextureBuffer(unsigned int internalFormat, unsigned int capacity)
+	: m_RendererID(GLBuffer::Create()), m_TextureID(GLTexture::Create()), m_Format(internalFormat), m_Size(0)
+{
+	// Never leave the buffer empty, a zero sized texture buffer is incomplete
+	Allocate(std::max(capacity, 16u));
+}
+
+void TextureBuffer::Allocate(unsigned int size)
+{
+	m_Size = size;
+	GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, m_RendererID.Get());
+	glBufferData(GL_TEXTURE_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW);
+	GpuMemory::Track(GpuMemoryCategory::OtherBuffer, GLObjectType::Buffer, m_RendererID.Get(), m_Size);
+
+	GLStateCache::BindTexture(0, GL_TEXTURE_BUFFER, m_TextureID.Get());
+	glTexBuffer(GL_TEXTURE_BUFFER, m_Format, m_RendererID.Get());
+}
+
+void TextureBuffer::Bind(unsigned int unit) const
+{
+	GLStateCache::BindTexture(unit, GL_TEXTURE_BUFFER, m_TextureID.Get());
+}
+
+void TextureBuffer::UploadData(const void* data, unsigned int size)
+{
+	if (size > m_Size)
+		Allocate(std::max(size, m_Size * 2));
+	if (size == 0)
+		return;
+
+	GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, m_RendererID.Get());
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+}
+
+
+/*
+ *
+ *  IndirectBuffer implementation
+ *
+ */
+
+void IndirectBuffer::Bind()
+{
+	GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_RendererID.Get());
+}
+
+void IndirectBuffer::UploadData(const void* data, unsigned int size)
+{
+	if (!m_RendererID)
+		m_RendererID = GLBuffer::Create();
+
+	m_Size = std::max(size, m_Size);
+	GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_RendererID.Get());
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_Size, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, data);
+	GpuMemory::Track(GpuMemoryCategory::OtherBuffer, GLObjectType::Buffer, m_RendererID.Get(), m_Size);
+}
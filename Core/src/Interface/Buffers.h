@@ -1,18 +1,13 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <glm/glm.hpp>
 #include <vector>
 
+#include "GLResource.h"
 
 
-// struct VertexArrayLayout
-// {
-//     unsigned int coords = 0;
-//     unsigned int colors = 0;
-//     unsigned int texCoords = 0;
-//     unsigned int normalCoords = 0;
-// };
 
 enum BufferIndex
 {
@@ -20,10 +15,35 @@ enum BufferIndex
     Colors = 1,
     TexCoords = 2,
     NormalCoords = 3,
+    InstanceModel = 4, // mat4, occupies locations 4..7
     AOS = -1
 };
 
 
+/*
+    Attributes of one interleaved vertex. Type is the GL component type, normalized
+    integer types reach the shader as floats in [0, 1] (unsigned) or [-1, 1].
+*/
+
+struct VertexAttribute
+{
+	BufferIndex Location;
+	unsigned int Components;
+	unsigned int Type;
+	bool Normalized;
+	unsigned int Offset;
+};
+
+struct VertexLayout
+{
+	std::vector<VertexAttribute> Attributes;
+	unsigned int Stride = 0;
+
+	bool operator==(const VertexLayout& other) const;
+	bool operator!=(const VertexLayout& other) const { return !(*this == other); }
+};
+
+
 struct VertexData
 {
 	std::vector<glm::vec3> Positions;
@@ -34,33 +54,44 @@ struct VertexData
 
 class VertexBuffer {
 private:
-	unsigned int m_RendererID;
+	GLBuffer m_RendererID;
+	unsigned int m_Size;
 public:
+	VertexBuffer() : m_Size(0) {}
 	VertexBuffer(const void* data, unsigned int size);
-	~VertexBuffer();
 
 	void Bind() const;
 	void Unbind() const;
 
-	unsigned int GetRendererID() const { return m_RendererID; }
+	// Streams new contents into the buffer, growing it when needed
+	void UploadData(const void* data, unsigned int size);
+
+	unsigned int GetRendererID() const { return m_RendererID.Get(); }
 };
 
 
+/*
+    The array only references its buffers, whoever creates it has to keep them alive
+*/
+
 class VertexArray {
 private:
-	unsigned int m_RendererID;
+	GLVertexArray m_RendererID;
 public:
 	VertexArray();
-	~VertexArray();
 
 	void Bind() const;
 	void Unbind() const;
 
 	void AddBuffer(const VertexBuffer& buffer, BufferIndex bindMode, unsigned int size);
-	void AddBuffer(const std::vector<float>& data, BufferIndex bindMode, unsigned int size);
+	// Sources the attributes of the layout from one interleaved buffer, called once per buffer
+	void SetLayout(unsigned int buffer, const VertexLayout& layout);
+
+	// Per-instance mat4 attribute read from buffer at the given byte offset
+	void AddInstanceBuffer(unsigned int buffer, BufferIndex bindMode, unsigned int offset) const;
 
 
-	unsigned int GetRendererID() const { return m_RendererID; }
+	unsigned int GetRendererID() const { return m_RendererID.Get(); }
 };
 
 
@@ -71,17 +102,16 @@ public:
 class IndexBuffer
 {
 private:
-	unsigned int id;
-	int count;
+	GLBuffer id;
+	int count = 0;
 public:
 	IndexBuffer() {}
 	IndexBuffer(unsigned int* indices, int count);
-	~IndexBuffer() {}
 
 public:
 	void Bind();
 	void Unbind();
-	unsigned int GetId() const { return id; }
+	unsigned int GetId() const { return id.Get(); }
 	float GetCount() const { return count; };
 
 };
@@ -89,19 +119,150 @@ public:
 class UniformBuffer
 {
 private:
-	unsigned int m_RendererID;
+	GLBuffer m_RendererID;
 	unsigned int m_Slot;
+	unsigned int m_Size;
 public:
 	UniformBuffer();
 	UniformBuffer(const void* data, unsigned int size);
-	~UniformBuffer() {}
 
 	void Bind(unsigned int slot);
 	void Unbind();
 
+	// Updates in place, the storage is only reallocated when it has to grow
 	void UploadData(const void* data, unsigned int size);
 
-	unsigned int GetId() const { return m_RendererID; }
+	unsigned int GetId() const { return m_RendererID.Get(); }
 	unsigned int GetSlot() const { return m_Slot; }
 };
 
+
+/*
+    Streaming buffer abstraction
+
+    One buffer split into regionCount frame-sized regions. Each frame writes into the
+    region of its frame index and fences it at the end, the region is only reused once
+    its fence has signalled, so writing never waits on the GPU. Several BeginFrame calls
+    with the same frame index keep appending to the same region. With buffer storage the whole buffer
+    stays persistently mapped and a push is a memcpy; without it pushes fall back to
+    glBufferSubData into the fenced region.
+*/
+
+class StreamingBuffer
+{
+public:
+	struct Allocation
+	{
+		unsigned int Offset;
+		unsigned int Size;
+	};
+private:
+	GLBuffer m_RendererID;
+	unsigned int m_Target;
+	unsigned int m_RegionSize;
+	unsigned int m_RegionCount;
+	unsigned int m_Region;
+	unsigned int m_Head;
+	uint64_t m_Frame;
+	unsigned int m_Alignment;
+	unsigned char* m_Mapped;
+	std::vector<void*> m_Fences;
+
+	void Create(unsigned int regionSize);
+public:
+	StreamingBuffer() : m_Target(0), m_RegionSize(0), m_RegionCount(0), m_Region(0), m_Head(0), m_Frame(~0ull), m_Alignment(1), m_Mapped(nullptr) {}
+	StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int regionCount = 3);
+
+	// Moves to the frame's region, waiting only if the GPU is still reading it.
+	// Both do nothing for a default constructed buffer.
+	void BeginFrame(uint64_t frame);
+	// Fences everything pushed since BeginFrame
+	void EndFrame();
+
+	// Grows the regions up front so nothing pushed this frame gets reallocated
+	void Reserve(unsigned int size);
+	Allocation Push(const void* data, unsigned int size);
+	void BindRange(unsigned int slot, const Allocation& allocation) const;
+
+	unsigned int GetAlignedSize(unsigned int size) const { return (size + m_Alignment - 1) / m_Alignment * m_Alignment; }
+
+	unsigned int GetId() const { return m_RendererID.Get(); }
+	bool IsPersistent() const { return m_Mapped != nullptr; }
+};
+
+
+/*
+    Shader storage buffer abstraction, requires GL 4.3
+*/
+
+class StorageBuffer
+{
+private:
+	GLBuffer m_RendererID;
+	unsigned int m_Size;
+public:
+	StorageBuffer() : m_Size(0) {}
+
+	void Bind(unsigned int slot);
+	void UploadData(const void* data, unsigned int size);
+
+	unsigned int GetId() const { return m_RendererID.Get(); }
+};
+
+
+/*
+    Texture buffer abstraction, a buffer shaders read through texelFetch on a
+    samplerBuffer. Core since 3.1, so it is the large array that works on every
+    context; at least 65536 texels are guaranteed. Storage is allocated once and
+    written in place, so keep one per frame in flight; it only grows when the
+    data outgrows the capacity.
+*/
+
+class TextureBuffer
+{
+private:
+	GLBuffer m_RendererID;
+	GLTexture m_TextureID;
+	unsigned int m_Format;
+	unsigned int m_Size;
+
+	void Allocate(unsigned int size);
+public:
+	TextureBuffer() : m_Format(0), m_Size(0) {}
+	// internalFormat is the texel format, GL_RGBA32F, GL_R32UI, ..., capacity is in bytes
+	TextureBuffer(unsigned int internalFormat, unsigned int capacity);
+
+	void Bind(unsigned int unit) const;
+	void UploadData(const void* data, unsigned int size);
+
+	unsigned int GetId() const { return m_RendererID.Get(); }
+	unsigned int GetTextureId() const { return m_TextureID.Get(); }
+};
+
+
+/*
+    Draw indirect buffer abstraction, holds DrawElementsIndirectCommand records
+*/
+
+struct DrawElementsIndirectCommand
+{
+	unsigned int Count;
+	unsigned int InstanceCount;
+	unsigned int FirstIndex;
+	int BaseVertex;
+	unsigned int BaseInstance;
+};
+
+class IndirectBuffer
+{
+private:
+	GLBuffer m_RendererID;
+	unsigned int m_Size;
+public:
+	IndirectBuffer() : m_Size(0) {}
+
+	void Bind();
+	void UploadData(const void* data, unsigned int size);
+
+	unsigned int GetId() const { return m_RendererID.Get(); }
+};
@@ -1,68 +1,218 @@
 #include "FrameBuffer.h"
 #include <glad/glad.h>
+#include <algorithm>
 #include <iostream>
 #include "Exception.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
 
-FrameBuffer::FrameBuffer(int width, int height) : width(width), height(height)
+FrameBuffer::FrameBuffer(int width, int height)
+	: FrameBuffer(FrameBufferSpecification{ width, height })
 {
-	GL(glGenFramebuffers(1, &id));
-	glBindFramebuffer(GL_FRAMEBUFFER, id);
+}
 
-	glGenTextures(1, &textureId);
-	glBindTexture(GL_TEXTURE_2D, textureId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId, 0);
+AttachmentFormat GetAttachmentFormat(FrameBufferFormat format)
+{
+	switch (format)
+	{
+	case FrameBufferFormat::RGB8:            return { GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE };
+	case FrameBufferFormat::RGBA8:           return { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE };
+	case FrameBufferFormat::RGB10A2:         return { GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV };
+	case FrameBufferFormat::RG16F:           return { GL_RG16F, GL_RG, GL_HALF_FLOAT };
+	case FrameBufferFormat::R11G11B10F:      return { GL_R11F_G11F_B10F, GL_RGB, GL_HALF_FLOAT };
+	case FrameBufferFormat::RGBA16F:         return { GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT };
+	case FrameBufferFormat::Depth24:         return { GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT };
+	case FrameBufferFormat::Depth32F:        return { GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT };
+	case FrameBufferFormat::Depth24Stencil8: return { GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 };
+	default:                                 return { 0, 0, 0 };
+	}
+}
 
-	glGenTextures(1, &depthId);
-	glBindTexture(GL_TEXTURE_2D, depthId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthId, 0);
+bool IsDepthFormat(FrameBufferFormat format)
+{
+	return format == FrameBufferFormat::Depth24 || format == FrameBufferFormat::Depth32F || format == FrameBufferFormat::Depth24Stencil8;
+}
+
+unsigned int GetFormatSize(FrameBufferFormat format)
+{
+	switch (format)
+	{
+	case FrameBufferFormat::RGB8:            return 3;
+	case FrameBufferFormat::RG16F:           return 4;
+	case FrameBufferFormat::RGBA16F:         return 8;
+	case FrameBufferFormat::None:            return 0;
+	default:                                 return 4;
+	}
+}
+
+static unsigned int GetDepthAttachmentPoint(FrameBufferFormat format)
+{
+	return format == FrameBufferFormat::Depth24Stencil8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+}
+
+FrameBuffer::FrameBuffer(const FrameBufferSpecification& specification)
+	: width(specification.Width), height(specification.Height), specification(specification)
+{
+	GL(id = GLFramebuffer::Create());
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, id.Get());
+
+	const bool layered = specification.Layers > 1;
+	const unsigned int target = layered ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	const bool hasDepth = specification.DepthAttachment != FrameBufferFormat::None;
+
+	colorIds.resize(specification.ColorAttachments.size());
+	for (GLTexture& colorId : colorIds)
+	{
+		colorId = GLTexture::Create();
+		GLStateCache::BindTexture(0, target, colorId.Get());
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	if (hasDepth)
+	{
+		depthId = GLTexture::Create();
+		GLStateCache::BindTexture(0, target, depthId.Get());
+	}
+	if (hasDepth && specification.DepthCompare)
+	{
+		// Linear filtering on a compare texture gives 2x2 PCF in hardware
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		// Outside the map counts as lit
+		const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+	}
+	else if (hasDepth)
+	{
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	AllocateStorage();
+	AttachLayer(0);
+
+	if (colorIds.empty())
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	else if (colorIds.size() > 1)
+	{
+		std::vector<unsigned int> drawBuffers(colorIds.size());
+		for (size_t i = 0; i < drawBuffers.size(); i++)
+			drawBuffers[i] = GL_COLOR_ATTACHMENT0 + static_cast<unsigned int>(i);
+		glDrawBuffers(static_cast<int>(drawBuffers.size()), drawBuffers.data());
+	}
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-FrameBuffer::~FrameBuffer()
+// (Re)allocates every attachment at the current size, the texture names stay the same
+void FrameBuffer::AllocateStorage()
 {
-	glDeleteFramebuffers(1, &id);
-	glDeleteTextures(1, &textureId);
+	const int layers = specification.Layers;
+	const unsigned int target = layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+
+	auto allocate = [&](unsigned int texture, FrameBufferFormat attachment)
+	{
+		const AttachmentFormat format = GetAttachmentFormat(attachment);
+		GLStateCache::BindTexture(0, target, texture);
+		if (layers > 1)
+			glTexImage3D(target, 0, format.InternalFormat, width, height, layers, 0, format.Format, format.Type, nullptr);
+		else
+			glTexImage2D(target, 0, format.InternalFormat, width, height, 0, format.Format, format.Type, nullptr);
+
+		const size_t bytes = static_cast<size_t>(width) * height * std::max(layers, 1) * GetFormatSize(attachment);
+		GpuMemory::Track(GpuMemoryCategory::RenderTarget, GLObjectType::Texture, texture, bytes);
+	};
+
+	for (size_t i = 0; i < colorIds.size(); i++)
+		allocate(colorIds[i].Get(), specification.ColorAttachments[i]);
+
+	if (depthId)
+	{
+		// Compare sampling wants a float depth texture
+		const FrameBufferFormat depthFormat = specification.DepthCompare && specification.DepthAttachment == FrameBufferFormat::Depth24
+			? FrameBufferFormat::Depth32F
+			: specification.DepthAttachment;
+		allocate(depthId.Get(), depthFormat);
+	}
+}
 
-	std::cout << "Framebuffer deleted!" << std::endl;
+// Points every attachment of the bound framebuffer at one layer, or the whole texture when not layered
+void FrameBuffer::AttachLayer(int layer)
+{
+	const bool layered = specification.Layers > 1;
+
+	for (size_t i = 0; i < colorIds.size(); i++)
+	{
+		const unsigned int attachment = GL_COLOR_ATTACHMENT0 + static_cast<unsigned int>(i);
+		if (layered)
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, colorIds[i].Get(), 0, layer);
+		else
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, colorIds[i].Get(), 0);
+	}
+
+	if (!depthId)
+		return;
+
+	const unsigned int attachment = GetDepthAttachmentPoint(specification.DepthAttachment);
+	if (layered)
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, depthId.Get(), 0, layer);
+	else
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, depthId.Get(), 0);
 }
 
 void FrameBuffer::Bind()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, id);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, id.Get());
+}
+
+void FrameBuffer::BindLayer(int layer)
+{
+	Bind();
+	if (specification.Layers <= 1)
+		return;
+
+	AttachLayer(layer);
 }
 
 void FrameBuffer::Unbind()
 {
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void FrameBuffer::Update(int width, int height)
 {
 	Bind();
-	glViewport(0, 0, width, height);
-	// Rebind the existing texture instead of creating a new one
-	glBindTexture(GL_TEXTURE_2D, textureId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-	//
-	glBindTexture(GL_TEXTURE_2D, depthId); // Rebinding the depth texture
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	GLStateCache::Viewport(0, 0, width, height);
+
+	// Reallocate the existing textures instead of creating new ones
+	this->width = width;
+	this->height = height;
+	specification.Width = width;
+	specification.Height = height;
+	AllocateStorage();
 
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete after resize!" << std::endl;
 
 	Unbind();
-	this->width = width;
-	this->height = height;
 
 
 }
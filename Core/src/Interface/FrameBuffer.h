@@ -1,19 +1,71 @@
 #pragma once
+#include <cstddef>
+#include <vector>
 
+#include "GLResource.h"
+
+
+enum class FrameBufferFormat
+{
+	None,
+	RGB8,
+	RGBA8,
+	RGB10A2,
+	RG16F,
+	R11G11B10F,
+	RGBA16F,
+	Depth24,
+	Depth32F,
+	Depth24Stencil8
+};
+
+// GL internal format, pixel format and pixel type an attachment is allocated with
+struct AttachmentFormat
+{
+	unsigned int InternalFormat;
+	unsigned int Format;
+	unsigned int Type;
+};
+
+AttachmentFormat GetAttachmentFormat(FrameBufferFormat format);
+bool IsDepthFormat(FrameBufferFormat format);
+// Storage of one texel, for memory accounting
+unsigned int GetFormatSize(FrameBufferFormat format);
+
+struct FrameBufferSpecification
+{
+	int Width = 0;
+	int Height = 0;
+	// Above 1 every attachment is a 2D texture array with this many layers
+	int Layers = 1;
+	// One texture per entry, bound to consecutive draw buffers. Depth only targets,
+	// shadow maps and pre-passes, leave this empty
+	std::vector<FrameBufferFormat> ColorAttachments = { FrameBufferFormat::RGB8 };
+	// None leaves the target without depth
+	FrameBufferFormat DepthAttachment = FrameBufferFormat::Depth24;
+	// Depth is sampled with comparison, through a shadow sampler
+	bool DepthCompare = false;
+};
 
 class FrameBuffer
 {
 private:
-	unsigned int id;
-	unsigned int textureId;
-	unsigned int depthId;
+	GLFramebuffer id;
+	std::vector<GLTexture> colorIds;
+	GLTexture depthId;
 
 	int width, height;
+	FrameBufferSpecification specification;
+
+	void AllocateStorage();
+	void AttachLayer(int layer);
 public:
 	FrameBuffer(int width, int height);
-	~FrameBuffer();
+	explicit FrameBuffer(const FrameBufferSpecification& specification);
 
 	void Bind();
+	// Binds with every attachment pointing at one layer of the texture arrays
+	void BindLayer(int layer);
 	void Unbind();
 
 
@@ -21,8 +73,11 @@ public:
 
 	int GetWidth() const { return width; }
 	int GetHeight() const { return height; }
+	const FrameBufferSpecification& GetSpecification() const { return specification; }
 
-	unsigned int GetTextureId() const { return textureId; }
-	unsigned int GetId() const { return id; }
+	unsigned int GetTextureId(size_t index = 0) const { return index < colorIds.size() ? colorIds[index].Get() : 0; }
+	size_t GetColorAttachmentCount() const { return colorIds.size(); }
+	unsigned int GetDepthTextureId() const { return depthId.Get(); }
+	unsigned int GetId() const { return id.Get(); }
 };
 
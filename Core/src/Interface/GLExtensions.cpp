@@ -0,0 +1,62 @@
+#include "GLExtensions.h"
+#include <iostream>
+#include <cstring>
+
+#ifndef GL_VERSION_4_3
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = nullptr;
+#endif
+
+#ifndef GL_VERSION_4_4
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = nullptr;
+#endif
+
+static GLCapabilities s_Capabilities;
+
+
+const GLCapabilities& GLCapabilities::Get()
+{
+	return s_Capabilities;
+}
+
+void GLCapabilities::Load(GLADloadproc loader)
+{
+	glGetIntegerv(GL_MAJOR_VERSION, &s_Capabilities.Major);
+	glGetIntegerv(GL_MINOR_VERSION, &s_Capabilities.Minor);
+
+	const int version = s_Capabilities.Major * 10 + s_Capabilities.Minor;
+
+	if (version >= 43)
+	{
+		glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)loader("glMultiDrawElementsIndirect");
+		s_Capabilities.MultiDrawIndirect = glMultiDrawElementsIndirect != nullptr;
+	}
+
+	s_Capabilities.DrawParameters = version >= 46;
+
+	if (version >= 44 || HasExtension("GL_ARB_buffer_storage"))
+	{
+		glBufferStorage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorage");
+		s_Capabilities.BufferStorage = glBufferStorage != nullptr;
+	}
+
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &s_Capabilities.MaxTextureBufferSize);
+
+#ifdef DEBUG
+	std::cout << "Persistent buffer mapping: " << (s_Capabilities.BufferStorage ? "yes" : "no") << std::endl;
+	std::cout << "Multi draw indirect: " << (s_Capabilities.MultiDrawIndirect && s_Capabilities.DrawParameters ? "yes" : "no") << std::endl;
+#endif
+}
+
+bool GLCapabilities::HasExtension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+	for (GLint i = 0; i < count; i++)
+	{
+		const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (extension && std::strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
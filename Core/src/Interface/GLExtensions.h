@@ -0,0 +1,43 @@
+#pragma once
+#include <glad/glad.h>
+
+/*
+	The bundled glad loader is generated for GL 4.1. The entry points of newer
+	versions the renderer can take advantage of are declared and loaded here,
+	the same way glad does it, and are only called after checking GLCapabilities.
+*/
+
+#ifndef GL_VERSION_4_3
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glad_glMultiDrawElementsIndirect
+#endif
+
+#ifndef GL_VERSION_4_4
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+extern PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
+#define glBufferStorage glad_glBufferStorage
+#endif
+
+
+struct GLCapabilities
+{
+	int Major = 0;
+	int Minor = 0;
+
+	bool MultiDrawIndirect = false; // 4.3, together with shader storage buffers
+	bool DrawParameters = false;    // 4.6, gl_BaseInstance/gl_DrawID in shaders
+	bool BufferStorage = false;     // 4.4 or ARB_buffer_storage, persistent mapping
+	int MaxTextureBufferSize = 65536; // Texels, 65536 is the minimum every context supports
+
+	static const GLCapabilities& Get();
+	static void Load(GLADloadproc loader);
+	static bool HasExtension(const char* name);
+};
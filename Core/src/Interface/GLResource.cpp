@@ -0,0 +1,117 @@
+#include "GLResource.h"
+#include <glad/glad.h>
+#include <vector>
+
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+
+
+namespace
+{
+	struct PendingDeletion
+	{
+		GLObjectType Type;
+		unsigned int Id;
+		uint64_t Frame;
+	};
+
+	struct DeletionQueueState
+	{
+		std::vector<PendingDeletion> Pending;
+		uint64_t Frame = 0;
+	};
+
+	// Never destroyed, static GLObjects release into it during exit
+	DeletionQueueState& GetState()
+	{
+		static DeletionQueueState* state = new DeletionQueueState();
+		return *state;
+	}
+
+	void Delete(const PendingDeletion& entry)
+	{
+		switch (entry.Type)
+		{
+		case GLObjectType::Buffer:
+			glDeleteBuffers(1, &entry.Id);
+			GLStateCache::ForgetBuffer(entry.Id);
+			break;
+		case GLObjectType::VertexArray:
+			glDeleteVertexArrays(1, &entry.Id);
+			GLStateCache::ForgetVertexArray(entry.Id);
+			break;
+		case GLObjectType::Texture:
+			glDeleteTextures(1, &entry.Id);
+			GLStateCache::ForgetTexture(entry.Id);
+			break;
+		case GLObjectType::Framebuffer:
+			glDeleteFramebuffers(1, &entry.Id);
+			GLStateCache::ForgetFramebuffer(entry.Id);
+			break;
+		case GLObjectType::Renderbuffer:
+			glDeleteRenderbuffers(1, &entry.Id);
+			break;
+		case GLObjectType::Program:
+			glDeleteProgram(entry.Id);
+			GLStateCache::ForgetProgram(entry.Id);
+			break;
+		case GLObjectType::Query:
+			glDeleteQueries(1, &entry.Id);
+			break;
+		}
+	}
+}
+
+unsigned int CreateGLObject(GLObjectType type)
+{
+	unsigned int id = 0;
+	switch (type)
+	{
+	case GLObjectType::Buffer: glGenBuffers(1, &id); break;
+	case GLObjectType::VertexArray: glGenVertexArrays(1, &id); break;
+	case GLObjectType::Texture: glGenTextures(1, &id); break;
+	case GLObjectType::Framebuffer: glGenFramebuffers(1, &id); break;
+	case GLObjectType::Renderbuffer: glGenRenderbuffers(1, &id); break;
+	case GLObjectType::Program: id = glCreateProgram(); break;
+	case GLObjectType::Query: glGenQueries(1, &id); break;
+	}
+	return id;
+}
+
+void GLDeletionQueue::Push(GLObjectType type, unsigned int id)
+{
+	GpuMemory::Untrack(type, id);
+
+	DeletionQueueState& state = GetState();
+	state.Pending.push_back(PendingDeletion{ type, id, state.Frame });
+}
+
+void GLDeletionQueue::SetFrame(uint64_t frame)
+{
+	GetState().Frame = frame;
+}
+
+void GLDeletionQueue::Retire(uint64_t completedFrames)
+{
+	// Pushed in frame order, so everything retirable is at the front
+	std::vector<PendingDeletion>& pending = GetState().Pending;
+	size_t retired = 0;
+	while (retired < pending.size() && pending[retired].Frame < completedFrames)
+		Delete(pending[retired++]);
+
+	if (retired > 0)
+		pending.erase(pending.begin(), pending.begin() + retired);
+}
+
+void GLDeletionQueue::Flush()
+{
+	std::vector<PendingDeletion>& pending = GetState().Pending;
+	for (const PendingDeletion& entry : pending)
+		Delete(entry);
+	pending.clear();
+}
+
+size_t GLDeletionQueue::GetPendingCount()
+{
+	return GetState().Pending.size();
+}
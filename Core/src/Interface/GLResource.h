@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*
+	Ownership of GL object names. Every GLObject deletes its name when destroyed
+	or reset, but not right away: frames already submitted may still read the
+	object, so the name is queued with the frame that released it and deleted
+	once the FramePacer has seen that frame's fence signal.
+
+	Objects are move-only, whoever holds the GLObject owns the name. Classes that
+	are copied around (Shader, Texture) share theirs through a shared_ptr.
+*/
+
+enum class GLObjectType : uint8_t
+{
+	Buffer,
+	VertexArray,
+	Texture,
+	Framebuffer,
+	Renderbuffer,
+	Program,
+	Query
+};
+
+class GLDeletionQueue
+{
+public:
+	static void Push(GLObjectType type, unsigned int id);
+
+	// Frame that releases from now on are tagged with
+	static void SetFrame(uint64_t frame);
+	// Deletes everything released by frames before completedFrames
+	static void Retire(uint64_t completedFrames);
+	// Deletes everything, only when the GPU is idle or the context goes away
+	static void Flush();
+
+	static size_t GetPendingCount();
+};
+
+unsigned int CreateGLObject(GLObjectType type);
+
+template<GLObjectType Type>
+class GLObject
+{
+private:
+	unsigned int id = 0;
+
+public:
+	GLObject() = default;
+	explicit GLObject(unsigned int id) : id(id) {}
+	~GLObject() { Reset(); }
+
+	GLObject(const GLObject&) = delete;
+	GLObject& operator=(const GLObject&) = delete;
+
+	GLObject(GLObject&& other) noexcept : id(other.Release()) {}
+	GLObject& operator=(GLObject&& other) noexcept
+	{
+		if (this != &other)
+			Reset(other.Release());
+		return *this;
+	}
+
+	static GLObject Create() { return GLObject(CreateGLObject(Type)); }
+
+	// Queues the current name for deletion and takes ownership of the new one
+	void Reset(unsigned int newId = 0)
+	{
+		if (id != 0 && id != newId)
+			GLDeletionQueue::Push(Type, id);
+		id = newId;
+	}
+
+	// Gives up ownership without deleting
+	unsigned int Release()
+	{
+		const unsigned int released = id;
+		id = 0;
+		return released;
+	}
+
+	unsigned int Get() const { return id; }
+	explicit operator bool() const { return id != 0; }
+};
+
+using GLBuffer = GLObject<GLObjectType::Buffer>;
+using GLVertexArray = GLObject<GLObjectType::VertexArray>;
+using GLTexture = GLObject<GLObjectType::Texture>;
+using GLFramebuffer = GLObject<GLObjectType::Framebuffer>;
+using GLRenderbuffer = GLObject<GLObjectType::Renderbuffer>;
+using GLProgram = GLObject<GLObjectType::Program>;
+using GLQuery = GLObject<GLObjectType::Query>;
@@ -0,0 +1,440 @@
+#include "GLStateCache.h"
+#include <glad/glad.h>
+#include "GLExtensions.h"
+
+
+static constexpr unsigned int Unknown = 0xFFFFFFFFu;
+
+enum BufferTarget { ArrayTarget, ElementTarget, UniformTarget, StorageTarget, IndirectTarget, CopyReadTarget, CopyWriteTarget, BufferTargetCount };
+enum TextureTarget { Texture2DTarget, Texture2DArrayTarget, Texture3DTarget, TextureCubeTarget, TextureBufferTarget, TextureTargetCount };
+
+struct IndexedBinding
+{
+	unsigned int Buffer;
+	intptr_t Offset;
+	intptr_t Size; // 0 for a whole buffer bind
+};
+
+struct GLState
+{
+	unsigned int Program;
+	unsigned int VertexArray;
+	unsigned int Buffers[BufferTargetCount];
+	IndexedBinding UniformSlots[GLStateCache::MaxBufferSlots];
+	IndexedBinding StorageSlots[GLStateCache::MaxBufferSlots];
+	unsigned int ActiveUnit;
+	unsigned int Textures[GLStateCache::MaxTextureUnits][TextureTargetCount];
+	unsigned int DrawFramebuffer;
+	unsigned int ReadFramebuffer;
+	int Viewport[4];
+	int DepthTest;
+	int DepthWrite;
+	unsigned int DepthFunc;
+	int ColorWrite;
+	int Blend;
+	unsigned int BlendSource;
+	unsigned int BlendDestination;
+};
+
+static GLState s_State;
+static GLStateCache::Counters s_Counters;
+static bool s_Initialized = false;
+
+
+static void EnsureInitialized()
+{
+	if (!s_Initialized)
+		GLStateCache::Invalidate();
+}
+
+static bool Update(unsigned int& cached, unsigned int value)
+{
+	if (cached == value)
+	{
+		s_Counters.Skipped++;
+		return false;
+	}
+	cached = value;
+	s_Counters.Issued++;
+	return true;
+}
+
+static bool Update(int& cached, bool value)
+{
+	const int state = value ? 1 : 0;
+	if (cached == state)
+	{
+		s_Counters.Skipped++;
+		return false;
+	}
+	cached = state;
+	s_Counters.Issued++;
+	return true;
+}
+
+static int GetBufferTarget(unsigned int target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: return ArrayTarget;
+	case GL_ELEMENT_ARRAY_BUFFER: return ElementTarget;
+	case GL_UNIFORM_BUFFER: return UniformTarget;
+	case GL_SHADER_STORAGE_BUFFER: return StorageTarget;
+	case GL_DRAW_INDIRECT_BUFFER: return IndirectTarget;
+	case GL_COPY_READ_BUFFER: return CopyReadTarget;
+	case GL_COPY_WRITE_BUFFER: return CopyWriteTarget;
+	default: return -1;
+	}
+}
+
+static int GetTextureTarget(unsigned int target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return Texture2DTarget;
+	case GL_TEXTURE_2D_ARRAY: return Texture2DArrayTarget;
+	case GL_TEXTURE_3D: return Texture3DTarget;
+	case GL_TEXTURE_CUBE_MAP: return TextureCubeTarget;
+	case GL_TEXTURE_BUFFER: return TextureBufferTarget;
+	default: return -1;
+	}
+}
+
+static IndexedBinding* GetIndexedSlot(unsigned int target, unsigned int slot)
+{
+	if (slot >= GLStateCache::MaxBufferSlots)
+		return nullptr;
+	if (target == GL_UNIFORM_BUFFER)
+		return &s_State.UniformSlots[slot];
+	if (target == GL_SHADER_STORAGE_BUFFER)
+		return &s_State.StorageSlots[slot];
+	return nullptr;
+}
+
+
+void GLStateCache::UseProgram(unsigned int program)
+{
+	EnsureInitialized();
+	if (Update(s_State.Program, program))
+		glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+	EnsureInitialized();
+	if (Update(s_State.VertexArray, vertexArray))
+	{
+		glBindVertexArray(vertexArray);
+		// The element buffer binding is part of the vertex array
+		s_State.Buffers[ElementTarget] = Unknown;
+	}
+}
+
+void GLStateCache::BindBuffer(unsigned int target, unsigned int buffer)
+{
+	EnsureInitialized();
+	const int index = GetBufferTarget(target);
+	if (index < 0)
+	{
+		s_Counters.Issued++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (Update(s_State.Buffers[index], buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLStateCache::BindBufferBase(unsigned int target, unsigned int slot, unsigned int buffer)
+{
+	EnsureInitialized();
+	IndexedBinding* binding = GetIndexedSlot(target, slot);
+	if (binding && binding->Buffer == buffer && binding->Size == 0)
+	{
+		s_Counters.Skipped++;
+		return;
+	}
+
+	glBindBufferBase(target, slot, buffer);
+	s_Counters.Issued++;
+
+	if (binding)
+		*binding = IndexedBinding{ buffer, 0, 0 };
+
+	// Indexed binds also replace the generic binding of the target
+	const int index = GetBufferTarget(target);
+	if (index >= 0)
+		s_State.Buffers[index] = buffer;
+}
+
+void GLStateCache::BindBufferRange(unsigned int target, unsigned int slot, unsigned int buffer, intptr_t offset, intptr_t size)
+{
+	EnsureInitialized();
+	IndexedBinding* binding = GetIndexedSlot(target, slot);
+	if (binding && binding->Buffer == buffer && binding->Offset == offset && binding->Size == size)
+	{
+		s_Counters.Skipped++;
+		return;
+	}
+
+	glBindBufferRange(target, slot, buffer, offset, size);
+	s_Counters.Issued++;
+
+	if (binding)
+		*binding = IndexedBinding{ buffer, offset, size };
+
+	const int index = GetBufferTarget(target);
+	if (index >= 0)
+		s_State.Buffers[index] = buffer;
+}
+
+void GLStateCache::BindTexture(unsigned int unit, unsigned int target, unsigned int texture)
+{
+	EnsureInitialized();
+	const int index = GetTextureTarget(target);
+	if (index >= 0 && unit < MaxTextureUnits && s_State.Textures[unit][index] == texture)
+	{
+		s_Counters.Skipped++;
+		return;
+	}
+
+	if (Update(s_State.ActiveUnit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+
+	glBindTexture(target, texture);
+	s_Counters.Issued++;
+
+	if (index >= 0 && unit < MaxTextureUnits)
+		s_State.Textures[unit][index] = texture;
+}
+
+void GLStateCache::BindFramebuffer(unsigned int target, unsigned int framebuffer)
+{
+	EnsureInitialized();
+	bool changed = false;
+	if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+		changed |= s_State.DrawFramebuffer != framebuffer;
+	if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
+		changed |= s_State.ReadFramebuffer != framebuffer;
+
+	if (!changed)
+	{
+		s_Counters.Skipped++;
+		return;
+	}
+
+	glBindFramebuffer(target, framebuffer);
+	s_Counters.Issued++;
+
+	if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+		s_State.DrawFramebuffer = framebuffer;
+	if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
+		s_State.ReadFramebuffer = framebuffer;
+}
+
+void GLStateCache::Viewport(int x, int y, int width, int height)
+{
+	EnsureInitialized();
+	int* viewport = s_State.Viewport;
+	if (viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)
+	{
+		s_Counters.Skipped++;
+		return;
+	}
+
+	glViewport(x, y, width, height);
+	s_Counters.Issued++;
+
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+
+void GLStateCache::SetDepthTest(bool enabled)
+{
+	EnsureInitialized();
+	if (!Update(s_State.DepthTest, enabled))
+		return;
+
+	if (enabled)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+}
+
+void GLStateCache::SetDepthWrite(bool enabled)
+{
+	EnsureInitialized();
+	if (Update(s_State.DepthWrite, enabled))
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::SetDepthFunc(unsigned int func)
+{
+	EnsureInitialized();
+	if (Update(s_State.DepthFunc, func))
+		glDepthFunc(func);
+}
+
+void GLStateCache::SetColorWrite(bool enabled)
+{
+	EnsureInitialized();
+	if (Update(s_State.ColorWrite, enabled))
+		glColorMask(enabled, enabled, enabled, enabled);
+}
+
+void GLStateCache::SetBlend(bool enabled)
+{
+	EnsureInitialized();
+	if (!Update(s_State.Blend, enabled))
+		return;
+
+	if (enabled)
+		glEnable(GL_BLEND);
+	else
+		glDisable(GL_BLEND);
+}
+
+void GLStateCache::SetBlendFunc(unsigned int source, unsigned int destination)
+{
+	EnsureInitialized();
+	if (s_State.BlendSource == source && s_State.BlendDestination == destination)
+	{
+		s_Counters.Skipped++;
+		return;
+	}
+
+	glBlendFunc(source, destination);
+	s_Counters.Issued++;
+
+	s_State.BlendSource = source;
+	s_State.BlendDestination = destination;
+}
+
+// Bindings unknown since Invalidate are queried once, callers bind what they get back
+static unsigned int Query(unsigned int& cached, GLenum binding)
+{
+	EnsureInitialized();
+	if (cached == Unknown)
+	{
+		GLint value = 0;
+		glGetIntegerv(binding, &value);
+		cached = static_cast<unsigned int>(value);
+	}
+	return cached;
+}
+
+unsigned int GLStateCache::GetProgram()
+{
+	return Query(s_State.Program, GL_CURRENT_PROGRAM);
+}
+
+unsigned int GLStateCache::GetVertexArray()
+{
+	return Query(s_State.VertexArray, GL_VERTEX_ARRAY_BINDING);
+}
+
+unsigned int GLStateCache::GetFramebuffer()
+{
+	return Query(s_State.DrawFramebuffer, GL_DRAW_FRAMEBUFFER_BINDING);
+}
+
+void GLStateCache::ForgetBuffer(unsigned int buffer)
+{
+	for (unsigned int& bound : s_State.Buffers)
+	{
+		if (bound == buffer)
+			bound = 0;
+	}
+
+	for (unsigned int slot = 0; slot < MaxBufferSlots; slot++)
+	{
+		if (s_State.UniformSlots[slot].Buffer == buffer)
+			s_State.UniformSlots[slot] = IndexedBinding{ 0, 0, 0 };
+		if (s_State.StorageSlots[slot].Buffer == buffer)
+			s_State.StorageSlots[slot] = IndexedBinding{ 0, 0, 0 };
+	}
+}
+
+void GLStateCache::ForgetTexture(unsigned int texture)
+{
+	for (auto& unit : s_State.Textures)
+	{
+		for (unsigned int& bound : unit)
+		{
+			if (bound == texture)
+				bound = 0;
+		}
+	}
+}
+
+void GLStateCache::ForgetFramebuffer(unsigned int framebuffer)
+{
+	if (s_State.DrawFramebuffer == framebuffer)
+		s_State.DrawFramebuffer = 0;
+	if (s_State.ReadFramebuffer == framebuffer)
+		s_State.ReadFramebuffer = 0;
+}
+
+void GLStateCache::ForgetVertexArray(unsigned int vertexArray)
+{
+	if (s_State.VertexArray == vertexArray)
+	{
+		s_State.VertexArray = 0;
+		s_State.Buffers[ElementTarget] = Unknown;
+	}
+}
+
+void GLStateCache::ForgetProgram(unsigned int program)
+{
+	// A deleted program stays current until another one is used, so rebind regardless
+	if (s_State.Program == program)
+		s_State.Program = Unknown;
+}
+
+void GLStateCache::Invalidate()
+{
+	s_State.Program = Unknown;
+	s_State.VertexArray = Unknown;
+
+	for (unsigned int& bound : s_State.Buffers)
+		bound = Unknown;
+
+	for (unsigned int slot = 0; slot < MaxBufferSlots; slot++)
+	{
+		s_State.UniformSlots[slot] = IndexedBinding{ Unknown, -1, -1 };
+		s_State.StorageSlots[slot] = IndexedBinding{ Unknown, -1, -1 };
+	}
+
+	s_State.ActiveUnit = Unknown;
+	for (auto& unit : s_State.Textures)
+	{
+		for (unsigned int& bound : unit)
+			bound = Unknown;
+	}
+
+	s_State.DrawFramebuffer = Unknown;
+	s_State.ReadFramebuffer = Unknown;
+	s_State.Viewport[0] = s_State.Viewport[1] = s_State.Viewport[2] = s_State.Viewport[3] = -1;
+
+	s_State.DepthTest = -1;
+	s_State.DepthWrite = -1;
+	s_State.DepthFunc = Unknown;
+	s_State.ColorWrite = -1;
+	s_State.Blend = -1;
+	s_State.BlendSource = Unknown;
+	s_State.BlendDestination = Unknown;
+
+	s_Initialized = true;
+}
+
+const GLStateCache::Counters& GLStateCache::GetCounters()
+{
+	return s_Counters;
+}
+
+void GLStateCache::ResetCounters()
+{
+	s_Counters = Counters();
+}
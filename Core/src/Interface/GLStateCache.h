@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+/*
+	Mirror of the GL state the renderer touches. Every bind and state change goes
+	through here and is dropped when it would not change anything.
+
+	The mirror is only correct as long as nothing calls GL directly, so anything
+	that does (ImGui, third party code) has to be followed by Invalidate().
+	Deleting an object resets its bindings in GL, the Forget* calls do the same
+	for the mirror so a recycled name is not mistaken for a bound one.
+*/
+
+class GLStateCache
+{
+public:
+	struct Counters
+	{
+		unsigned int Issued = 0;
+		unsigned int Skipped = 0;
+	};
+
+	static constexpr unsigned int MaxTextureUnits = 16;
+	static constexpr unsigned int MaxBufferSlots = 16;
+
+	static void UseProgram(unsigned int program);
+	static void BindVertexArray(unsigned int vertexArray);
+	static void BindBuffer(unsigned int target, unsigned int buffer);
+	static void BindBufferBase(unsigned int target, unsigned int slot, unsigned int buffer);
+	static void BindBufferRange(unsigned int target, unsigned int slot, unsigned int buffer, intptr_t offset, intptr_t size);
+	static void BindTexture(unsigned int unit, unsigned int target, unsigned int texture);
+	static void BindFramebuffer(unsigned int target, unsigned int framebuffer);
+	static void Viewport(int x, int y, int width, int height);
+
+	static void SetDepthTest(bool enabled);
+	static void SetDepthWrite(bool enabled);
+	static void SetDepthFunc(unsigned int func);
+	// All four channels of every draw buffer at once
+	static void SetColorWrite(bool enabled);
+	static void SetBlend(bool enabled);
+	static void SetBlendFunc(unsigned int source, unsigned int destination);
+
+	// Current bindings, read back from GL when not known since Invalidate
+	static unsigned int GetProgram();
+	static unsigned int GetVertexArray();
+	static unsigned int GetFramebuffer();
+
+	static void ForgetBuffer(unsigned int buffer);
+	static void ForgetTexture(unsigned int texture);
+	static void ForgetFramebuffer(unsigned int framebuffer);
+	static void ForgetVertexArray(unsigned int vertexArray);
+	static void ForgetProgram(unsigned int program);
+
+	// Marks everything unknown, the next call of each kind goes through
+	static void Invalidate();
+
+	static const Counters& GetCounters();
+	static void ResetCounters();
+};
@@ -0,0 +1,153 @@
+#include "GpuMemory.h"
+#include <algorithm>
+#include <unordered_map>
+
+
+namespace
+{
+	struct Allocation
+	{
+		GpuMemoryCategory Category;
+		uint32_t Owner;
+		size_t Bytes;
+	};
+
+	struct GpuMemoryState
+	{
+		std::unordered_map<uint64_t, Allocation> Allocations;
+		size_t Totals[GpuMemory::CategoryCount] = {};
+		size_t Total = 0;
+		size_t Budget = size_t(1024) << 20;
+
+		// Owner names are interned, allocations refer to them by index
+		std::vector<std::string> OwnerNames;
+		std::vector<size_t> OwnerBytes;
+		std::unordered_map<std::string, uint32_t> OwnerIndices;
+		std::vector<uint32_t> OwnerStack;
+	};
+
+	// Never destroyed, objects deleted during exit still untrack themselves
+	GpuMemoryState& GetState()
+	{
+		static GpuMemoryState* state = new GpuMemoryState();
+		return *state;
+	}
+
+	uint64_t GetKey(GLObjectType type, unsigned int id)
+	{
+		return (static_cast<uint64_t>(type) << 32) | id;
+	}
+
+	uint32_t InternOwner(GpuMemoryState& state, const std::string& name)
+	{
+		auto it = state.OwnerIndices.find(name);
+		if (it != state.OwnerIndices.end())
+			return it->second;
+
+		const uint32_t index = static_cast<uint32_t>(state.OwnerNames.size());
+		state.OwnerNames.push_back(name);
+		state.OwnerBytes.push_back(0);
+		state.OwnerIndices.emplace(name, index);
+		return index;
+	}
+
+	void Remove(GpuMemoryState& state, const Allocation& allocation)
+	{
+		state.Totals[static_cast<size_t>(allocation.Category)] -= allocation.Bytes;
+		state.OwnerBytes[allocation.Owner] -= allocation.Bytes;
+		state.Total -= allocation.Bytes;
+	}
+}
+
+void GpuMemory::Track(GpuMemoryCategory category, GLObjectType type, unsigned int id, size_t bytes, const std::string& owner)
+{
+	if (id == 0)
+		return;
+
+	GpuMemoryState& state = GetState();
+	auto result = state.Allocations.try_emplace(GetKey(type, id), Allocation{ category, 0, 0 });
+	Allocation& allocation = result.first->second;
+
+	if (!result.second)
+		Remove(state, allocation);
+
+	if (!owner.empty())
+		allocation.Owner = InternOwner(state, owner);
+	else if (result.second)
+		allocation.Owner = state.OwnerStack.empty() ? InternOwner(state, "Engine") : state.OwnerStack.back();
+
+	allocation.Category = category;
+	allocation.Bytes = bytes;
+	state.Totals[static_cast<size_t>(category)] += bytes;
+	state.OwnerBytes[allocation.Owner] += bytes;
+	state.Total += bytes;
+}
+
+void GpuMemory::Untrack(GLObjectType type, unsigned int id)
+{
+	GpuMemoryState& state = GetState();
+	auto it = state.Allocations.find(GetKey(type, id));
+	if (it == state.Allocations.end())
+		return;
+
+	Remove(state, it->second);
+	state.Allocations.erase(it);
+}
+
+size_t GpuMemory::GetTotal()
+{
+	return GetState().Total;
+}
+
+size_t GpuMemory::GetTotal(GpuMemoryCategory category)
+{
+	return GetState().Totals[static_cast<size_t>(category)];
+}
+
+void GpuMemory::GetOwners(std::vector<OwnerUsage>& owners)
+{
+	const GpuMemoryState& state = GetState();
+	owners.clear();
+	for (size_t i = 0; i < state.OwnerNames.size(); i++)
+	{
+		if (state.OwnerBytes[i] > 0)
+			owners.push_back(OwnerUsage{ state.OwnerNames[i], state.OwnerBytes[i] });
+	}
+
+	std::sort(owners.begin(), owners.end(), [](const OwnerUsage& a, const OwnerUsage& b) { return a.Bytes > b.Bytes; });
+}
+
+void GpuMemory::SetBudget(size_t bytes)
+{
+	GetState().Budget = bytes;
+}
+
+size_t GpuMemory::GetBudget()
+{
+	return GetState().Budget;
+}
+
+const char* GpuMemory::GetCategoryName(GpuMemoryCategory category)
+{
+	switch (category)
+	{
+	case GpuMemoryCategory::VertexBuffer: return "Vertex Buffers";
+	case GpuMemoryCategory::IndexBuffer: return "Index Buffers";
+	case GpuMemoryCategory::UniformBuffer: return "Uniform Buffers";
+	case GpuMemoryCategory::OtherBuffer: return "Other Buffers";
+	case GpuMemoryCategory::Texture: return "Textures";
+	case GpuMemoryCategory::RenderTarget: return "Render Targets";
+	default: return "Unknown";
+	}
+}
+
+void GpuMemory::PushOwner(const std::string& owner)
+{
+	GpuMemoryState& state = GetState();
+	state.OwnerStack.push_back(InternOwner(state, owner));
+}
+
+void GpuMemory::PopOwner()
+{
+	GetState().OwnerStack.pop_back();
+}
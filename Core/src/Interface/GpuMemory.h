@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GLResource.h"
+
+/*
+	Bookkeeping of the video memory our buffers and textures occupy. Sizes are
+	what we asked GL for, the driver may pad them. Every allocation is keyed by its
+	GL object, so resizing one replaces its old size. Objects drop out as soon as
+	they are released, the few frames they wait in the deletion queue are not
+	counted, so giving memory back shows up right away.
+
+	Allocations are tagged with a category and an owner, the asset they belong
+	to. Owners come from the innermost GpuMemoryScope unless given explicitly;
+	allocations outside of any scope belong to "Engine".
+
+	The budget is not enforced here. Whoever can give memory back (the texture
+	residency in the ResourceRegistry) compares GetTotal against GetBudget.
+*/
+
+enum class GpuMemoryCategory : uint8_t
+{
+	VertexBuffer,
+	IndexBuffer,
+	UniformBuffer,
+	OtherBuffer,
+	Texture,
+	RenderTarget,
+	Count
+};
+
+class GpuMemory
+{
+public:
+	static constexpr size_t CategoryCount = static_cast<size_t>(GpuMemoryCategory::Count);
+
+	struct OwnerUsage
+	{
+		std::string Name;
+		size_t Bytes = 0;
+	};
+
+	// Tracking an object again replaces its size, its owner only when one is passed
+	static void Track(GpuMemoryCategory category, GLObjectType type, unsigned int id, size_t bytes, const std::string& owner = {});
+	static void Untrack(GLObjectType type, unsigned int id);
+
+	static size_t GetTotal();
+	static size_t GetTotal(GpuMemoryCategory category);
+	// Owners with live allocations, largest first
+	static void GetOwners(std::vector<OwnerUsage>& owners);
+
+	static void SetBudget(size_t bytes);
+	static size_t GetBudget();
+	static bool IsOverBudget() { return GetTotal() > GetBudget(); }
+
+	static const char* GetCategoryName(GpuMemoryCategory category);
+
+private:
+	friend class GpuMemoryScope;
+	static void PushOwner(const std::string& owner);
+	static void PopOwner();
+};
+
+// Tags the allocations made during its lifetime with an owner
+class GpuMemoryScope
+{
+public:
+	explicit GpuMemoryScope(const std::string& owner) { GpuMemory::PushOwner(owner); }
+	~GpuMemoryScope() { GpuMemory::PopOwner(); }
+
+	GpuMemoryScope(const GpuMemoryScope&) = delete;
+	GpuMemoryScope& operator=(const GpuMemoryScope&) = delete;
+};
@@ -0,0 +1,137 @@
+#include "ShaderReflection.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+
+// Bytes needed to cache one value of the given uniform type, 0 disables caching
+static unsigned int UniformTypeSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_FLOAT:
+	case GL_INT:
+	case GL_UNSIGNED_INT:
+		return 4;
+	case GL_FLOAT_VEC2:
+	case GL_INT_VEC2:
+	case GL_UNSIGNED_INT_VEC2:
+		return 8;
+	case GL_FLOAT_VEC3:
+	case GL_INT_VEC3:
+	case GL_UNSIGNED_INT_VEC3:
+		return 12;
+	case GL_FLOAT_VEC4:
+	case GL_INT_VEC4:
+	case GL_UNSIGNED_INT_VEC4:
+	case GL_FLOAT_MAT2:
+		return 16;
+	case GL_FLOAT_MAT3:
+		return 36;
+	case GL_FLOAT_MAT4:
+		return 64;
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_BUFFER:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+ShaderReflection ShaderReflection::Reflect(unsigned int program)
+{
+	ShaderReflection reflection;
+
+	GLint uniformCount = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<char> buffer(std::max(maxLength, 1));
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, i, maxLength, &length, &size, &type, buffer.data());
+
+		std::string name(buffer.data(), length);
+		GLint location = glGetUniformLocation(program, name.c_str());
+
+		// Members of uniform blocks have no location, they are set through the block
+		if (location < 0)
+			continue;
+
+		// Arrays are reported as "name[0]"
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			name.resize(name.size() - 3);
+
+		const uint32_t hash = HashUniformName(name);
+		if (reflection.FindUniform(hash) >= 0)
+			std::cerr << "Uniform name hash collision on " << name << ", only the first one is reachable" << std::endl;
+
+		UniformInfo info{};
+		info.Name = name;
+		info.Hash = hash;
+		info.Location = location;
+		info.Type = type;
+		info.Count = size;
+		info.CacheOffset = static_cast<unsigned int>(reflection.Values.size());
+		info.CacheSize = size == 1 ? UniformTypeSize(type) : 0;
+		info.CacheValid = false;
+		info.TypeMismatchReported = false;
+
+		reflection.Values.resize(reflection.Values.size() + info.CacheSize);
+		reflection.Uniforms.push_back(info);
+	}
+
+	GLint blockCount = 0;
+	GLint maxBlockLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockLength);
+
+	buffer.resize(std::max(maxBlockLength, 1));
+	for (GLint i = 0; i < blockCount; i++)
+	{
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(program, i, maxBlockLength, &length, buffer.data());
+
+		UniformBlockInfo block{};
+		block.Name = std::string(buffer.data(), length);
+		block.Hash = HashUniformName(block.Name);
+		block.Index = static_cast<unsigned int>(i);
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.Size);
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &block.Binding);
+
+		reflection.Blocks.push_back(block);
+	}
+
+	return reflection;
+}
+
+int ShaderReflection::FindUniform(uint32_t hash) const
+{
+	for (size_t i = 0; i < Uniforms.size(); i++)
+	{
+		if (Uniforms[i].Hash == hash)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+int ShaderReflection::FindBlock(uint32_t hash) const
+{
+	for (size_t i = 0; i < Blocks.size(); i++)
+	{
+		if (Blocks[i].Hash == hash)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
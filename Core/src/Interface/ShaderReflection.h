@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+	Compile time hashed uniform name (FNV-1a). Lookups by UniformName never touch
+	the string, literals are hashed by the compiler:
+
+		static constexpr UniformName ModelName("uModel");
+*/
+
+constexpr uint32_t HashUniformName(std::string_view name)
+{
+	uint32_t hash = 2166136261u;
+	for (char c : name)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+struct UniformName
+{
+	uint32_t Hash;
+	std::string_view Name;
+
+	constexpr UniformName(const char* name) : Hash(HashUniformName(name)), Name(name) {}
+	UniformName(const std::string& name) : Hash(HashUniformName(name)), Name(name) {}
+};
+
+
+/*
+	Index into the uniform table of one shader program, resolved once after linking.
+	The type is checked against the reflected GL type when the handle is resolved,
+	a mismatch or an inactive uniform gives an invalid handle and setting it is a no-op.
+*/
+
+template<typename T>
+class UniformHandle
+{
+private:
+	int index = -1;
+
+	friend class Shader;
+	explicit UniformHandle(int index) : index(index) {}
+public:
+	UniformHandle() = default;
+
+	bool IsValid() const { return index >= 0; }
+	int GetIndex() const { return index; }
+};
+
+
+struct UniformInfo
+{
+	std::string Name;
+	uint32_t Hash;
+	int Location;
+	unsigned int Type;
+	int Count;
+
+	// Last uploaded value, offset into ShaderReflection::Values
+	unsigned int CacheOffset;
+	unsigned int CacheSize;
+	bool CacheValid;
+	// Type mismatches are reported once per uniform
+	bool TypeMismatchReported;
+};
+
+struct UniformBlockInfo
+{
+	std::string Name;
+	uint32_t Hash;
+	unsigned int Index;
+	int Size;
+	int Binding;
+};
+
+/*
+	Active uniforms and uniform blocks of a linked program. Shared between copies
+	of a Shader, since uniform values live in the program object.
+*/
+
+struct ShaderReflection
+{
+	std::vector<UniformInfo> Uniforms;
+	std::vector<UniformBlockInfo> Blocks;
+	std::vector<unsigned char> Values;
+	bool CacheValues = true;
+
+	static ShaderReflection Reflect(unsigned int program);
+
+	int FindUniform(uint32_t hash) const;
+	int FindBlock(uint32_t hash) const;
+};
@@ -0,0 +1,132 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+
+
+float AABB::GetSurfaceArea() const
+{
+	const glm::vec3 size = Max - Min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+AABB AABB::FromPoints(const std::vector<glm::vec3>& points)
+{
+	if (points.empty())
+		return AABB();
+
+	AABB bounds{ points[0], points[0] };
+	for (const glm::vec3& point : points)
+	{
+		bounds.Min = glm::min(bounds.Min, point);
+		bounds.Max = glm::max(bounds.Max, point);
+	}
+	return bounds;
+}
+
+AABB AABB::Merge(const AABB& a, const AABB& b)
+{
+	return AABB{ glm::min(a.Min, b.Min), glm::max(a.Max, b.Max) };
+}
+
+/*
+ * Arvo's method: the new extents are the old ones projected on the absolute
+ * value of the rotation/scale part, no need to transform all eight corners.
+ */
+AABB AABB::Transformed(const glm::mat4& transform) const
+{
+	const glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.0f));
+	const glm::vec3 extents = GetExtents();
+
+	glm::vec3 worldExtents(0.0f);
+	for (int column = 0; column < 3; column++)
+		worldExtents += glm::abs(glm::vec3(transform[column])) * extents[column];
+
+	return AABB{ center - worldExtents, center + worldExtents };
+}
+
+bool AABB::Contains(const AABB& other) const
+{
+	return glm::all(glm::lessThanEqual(Min, other.Min)) && glm::all(glm::greaterThanEqual(Max, other.Max));
+}
+
+bool AABB::Intersects(const AABB& other) const
+{
+	return glm::all(glm::lessThanEqual(Min, other.Max)) && glm::all(glm::greaterThanEqual(Max, other.Min));
+}
+
+
+BoundingSphere BoundingSphere::FromPoints(const std::vector<glm::vec3>& points)
+{
+	BoundingSphere sphere;
+	sphere.Center = AABB::FromPoints(points).GetCenter();
+
+	float radiusSquared = 0.0f;
+	for (const glm::vec3& point : points)
+	{
+		const glm::vec3 offset = point - sphere.Center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	sphere.Radius = std::sqrt(radiusSquared);
+	return sphere;
+}
+
+BoundingSphere BoundingSphere::Transformed(const glm::mat4& transform) const
+{
+	const float scale = std::max({ glm::length(glm::vec3(transform[0])),
+		glm::length(glm::vec3(transform[1])),
+		glm::length(glm::vec3(transform[2])) });
+
+	return BoundingSphere{ glm::vec3(transform * glm::vec4(Center, 1.0f)), Radius * scale };
+}
+
+
+/*
+ * Gribb/Hartmann plane extraction, rows of the combined matrix. glm is column major
+ * so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+ */
+Frustum Frustum::FromMatrix(const glm::mat4& m)
+{
+	const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	Frustum frustum;
+	frustum.Planes[0] = row3 + row0;
+	frustum.Planes[1] = row3 - row0;
+	frustum.Planes[2] = row3 + row1;
+	frustum.Planes[3] = row3 - row1;
+	frustum.Planes[4] = row3 + row2;
+	frustum.Planes[5] = row3 - row2;
+
+	for (glm::vec4& plane : frustum.Planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	return frustum;
+}
+
+bool Frustum::Intersects(const AABB& bounds) const
+{
+	const glm::vec3 center = bounds.GetCenter();
+	const glm::vec3 extents = bounds.GetExtents();
+
+	for (const glm::vec4& plane : Planes)
+	{
+		const glm::vec3 normal(plane);
+		const float distance = glm::dot(normal, center) + plane.w;
+		const float radius = glm::dot(glm::abs(normal), extents);
+		if (distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const
+{
+	for (const glm::vec4& plane : Planes)
+	{
+		if (glm::dot(glm::vec3(plane), sphere.Center) + plane.w < -sphere.Radius)
+			return false;
+	}
+	return true;
+}
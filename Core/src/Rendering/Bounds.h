@@ -0,0 +1,52 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+
+struct AABB
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+
+	glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+	glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }
+	float GetSurfaceArea() const;
+
+	static AABB FromPoints(const std::vector<glm::vec3>& points);
+	static AABB Merge(const AABB& a, const AABB& b);
+
+	// Bounds of the box after the transform, still axis aligned
+	AABB Transformed(const glm::mat4& transform) const;
+	bool Contains(const AABB& other) const;
+	bool Intersects(const AABB& other) const;
+};
+
+struct BoundingSphere
+{
+	glm::vec3 Center = glm::vec3(0.0f);
+	float Radius = 0.0f;
+
+	// Centered on the box of the points, radius to the farthest point
+	static BoundingSphere FromPoints(const std::vector<glm::vec3>& points);
+
+	BoundingSphere Transformed(const glm::mat4& transform) const;
+};
+
+/*
+ * Planes point inwards (ax + by + cz + d >= 0 inside), order is
+ * left, right, bottom, top, near, far.
+ */
+struct Frustum
+{
+	glm::vec4 Planes[6];
+
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+	bool Intersects(const AABB& bounds) const;
+	bool Intersects(const BoundingSphere& sphere) const;
+};
+
+
+#endif //BOUNDS_H
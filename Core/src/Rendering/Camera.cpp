@@ -19,10 +19,6 @@
 
 Camera::Camera(float w, float h, float fov, bool primary) : primary(primary), up(0, 1, 0)
 {
-
-	float nearPlane = 0.1f; // Near clipping plane
-	float farPlane = 1000.0f; // Far clipping plane
-
 	float aspectRatio = (float)w / (float)h;
 	this->projection = glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
 
@@ -52,9 +48,6 @@ void Camera::UpdateView(Transform& transform)
 
 void Camera::Reset(float width, float height, float fov) {
 
-	float nearPlane = 0.1f; // Near clipping plane
-	float farPlane = 1000.0f; // Far clipping plane
-
 	float aspectRatio = (float)width / (float)height;
 	this->projection = glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
 
@@ -21,6 +21,9 @@ private:
     glm::vec3 front;
     glm::vec3 up;
     bool primary;
+
+    float nearPlane = 0.1f; // Near clipping plane
+    float farPlane = 1000.0f; // Far clipping plane
 public:
     Camera() : up(0, 1, 0) {}
     Camera(bool _primary)  : primary(_primary), up(0, 1, 0) {}
@@ -31,7 +34,7 @@ public:
 
     void SetZoom(float zoom);
 
-    Transform GetTransform() { return transform; }
+    Transform GetTransform() const { return transform; }
 
 
     bool IsPrimary() { return primary; }
@@ -42,6 +45,9 @@ public:
 
     glm::mat4 GetView() const { return view; }
     glm::mat4 GetProjection() const { return projection; }
+
+    float GetNear() const { return nearPlane; }
+    float GetFar() const { return farPlane; }
 };
 
 
@@ -0,0 +1,130 @@
+#include "CascadedShadowMap.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Interface/GpuMemory.h"
+
+
+// Cached cascades are fitted this much larger so the camera can move inside them
+static constexpr float CachePadding = 1.25f;
+
+CascadedShadowMap::CascadedShadowMap(int resolution) : resolution(resolution)
+{
+	FrameBufferSpecification specification;
+	specification.Width = resolution;
+	specification.Height = resolution;
+	specification.Layers = CascadeCount;
+	specification.ColorAttachments = {};
+	specification.DepthAttachment = FrameBufferFormat::Depth32F;
+	specification.DepthCompare = true;
+	GpuMemoryScope memoryScope("Shadow Maps");
+	target = std::make_unique<FrameBuffer>(specification);
+}
+
+void CascadedShadowMap::Invalidate()
+{
+	for (Cascade& cascade : cascades)
+		cascade.Valid = false;
+}
+
+static glm::vec3 GetUp(const glm::vec3& direction)
+{
+	return std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+void CascadedShadowMap::Fit(Cascade& cascade, const glm::vec3& center, float radius) const
+{
+	const glm::vec3 up = GetUp(lightDirection);
+
+	// Snap the center to whole texels of a light space that only depends on the direction
+	const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+	const float texel = 2.0f * radius / static_cast<float>(resolution);
+	glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+	lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+	lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+	const glm::vec3 snapped = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightCenter, 1.0f));
+
+	const glm::vec3 eye = snapped - lightDirection * (radius + casterExtrusion);
+	const glm::mat4 view = glm::lookAt(eye, snapped, up);
+	const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterExtrusion);
+
+	cascade.ViewProjection = projection * view;
+	cascade.Center = center;
+	cascade.Radius = radius;
+}
+
+uint32_t CascadedShadowMap::Update(const Camera& camera, const glm::vec3& lightDirection, uint64_t sceneVersion, uint64_t frame)
+{
+	const glm::vec3 direction = glm::normalize(lightDirection);
+	if (glm::dot(direction, this->lightDirection) < 0.9999f || sceneVersion != this->sceneVersion)
+		Invalidate();
+	this->lightDirection = direction;
+	this->sceneVersion = sceneVersion;
+
+	const float nearPlane = camera.GetNear();
+	const float farPlane = std::min(camera.GetFar(), shadowDistance);
+
+	// Frustum corners at the near and far plane, slices interpolate between them
+	const glm::mat4 inverseViewProjection = glm::inverse(camera.GetProjection() * camera.GetView());
+	glm::vec3 nearCorners[4], farCorners[4];
+	for (int i = 0; i < 4; i++)
+	{
+		const glm::vec2 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+		glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+		nearCorners[i] = glm::vec3(nearPoint) / nearPoint.w;
+		farCorners[i] = glm::vec3(farPoint) / farPoint.w;
+	}
+
+	const float cameraRange = camera.GetFar() - nearPlane;
+	uint32_t dirty = 0;
+	float sliceStart = nearPlane;
+
+	for (int i = 0; i < CascadeCount; i++)
+	{
+		// Blend of logarithmic and uniform splits
+		const float fraction = static_cast<float>(i + 1) / CascadeCount;
+		const float logarithmic = nearPlane * std::pow(farPlane / nearPlane, fraction);
+		const float uniform = nearPlane + (farPlane - nearPlane) * fraction;
+		const float sliceEnd = splitLambda * logarithmic + (1.0f - splitLambda) * uniform;
+
+		glm::vec3 corners[8];
+		glm::vec3 center(0.0f);
+		for (int c = 0; c < 4; c++)
+		{
+			corners[c] = glm::mix(nearCorners[c], farCorners[c], (sliceStart - nearPlane) / cameraRange);
+			corners[c + 4] = glm::mix(nearCorners[c], farCorners[c], (sliceEnd - nearPlane) / cameraRange);
+			center += corners[c] + corners[c + 4];
+		}
+		center /= 8.0f;
+
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+			radius = std::max(radius, glm::distance(center, corner));
+		// Quantized so small numeric changes do not change the texel size
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		Cascade& cascade = cascades[i];
+		cascade.SplitDepth = sliceEnd;
+
+		bool render = true;
+		if (i >= firstCachedCascade)
+		{
+			const bool covered = glm::distance(center, cascade.Center) + radius <= cascade.Radius;
+			render = !cascade.Valid || !covered || frame - cascade.RenderedFrame >= refreshInterval;
+			radius *= CachePadding;
+		}
+
+		if (render)
+		{
+			Fit(cascade, center, radius);
+			cascade.RenderedFrame = frame;
+			cascade.Valid = true;
+			dirty |= 1u << i;
+		}
+
+		sliceStart = sliceEnd;
+	}
+
+	return dirty;
+}
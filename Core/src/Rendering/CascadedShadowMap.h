@@ -0,0 +1,82 @@
+#ifndef CASCADEDSHADOWMAP_H
+#define CASCADEDSHADOWMAP_H
+
+#include <cstdint>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "Interface/FrameBuffer.h"
+#include "Camera.h"
+
+/*
+ * Directional light cascades, one layer of a depth texture array each.
+ *
+ * The camera frustum up to the shadow distance is split with the practical split
+ * scheme and every slice gets a light space orthographic box around its bounding
+ * sphere. The sphere radius does not change when the camera turns and the box
+ * center is snapped to whole texels, so shadow edges do not shimmer.
+ *
+ * Cascades from FirstCachedCascade on are cached: they are fitted with extra room
+ * and only re-rendered when static geometry or the light changed, the camera left
+ * the room, or RefreshInterval frames have passed, which is also when moving
+ * objects show up in them. Near cascades render every frame.
+ */
+class CascadedShadowMap
+{
+public:
+	static constexpr int CascadeCount = 4;
+
+	struct Cascade
+	{
+		// Light view-projection the layer was last rendered with
+		glm::mat4 ViewProjection = glm::mat4(1.0f);
+		glm::vec3 Center = glm::vec3(0.0f);
+		float Radius = 0.0f;
+		// View depth where the cascade ends
+		float SplitDepth = 0.0f;
+		uint64_t RenderedFrame = 0;
+		bool Valid = false;
+	};
+
+private:
+	std::unique_ptr<FrameBuffer> target;
+	int resolution;
+	Cascade cascades[CascadeCount];
+
+	float shadowDistance = 150.0f;
+	float splitLambda = 0.75f;
+	// Distance casters may be behind the slice toward the light and still cast into it
+	float casterExtrusion = 200.0f;
+	int firstCachedCascade = 2;
+	uint64_t refreshInterval = 8;
+
+	glm::vec3 lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	uint64_t sceneVersion = 0;
+
+	void Fit(Cascade& cascade, const glm::vec3& center, float radius) const;
+
+public:
+	explicit CascadedShadowMap(int resolution = 2048);
+	~CascadedShadowMap() = default;
+
+	// Refits the cascades to the camera, returns a bitmask of the ones to re-render.
+	// Those are marked as rendered at frame, the caller has to draw them.
+	uint32_t Update(const Camera& camera, const glm::vec3& lightDirection, uint64_t sceneVersion, uint64_t frame);
+	// Forces every cascade to re-render on the next Update
+	void Invalidate();
+
+	void SetShadowDistance(float distance) { shadowDistance = distance; Invalidate(); }
+	float GetShadowDistance() const { return shadowDistance; }
+	// CascadeCount disables caching
+	void SetFirstCachedCascade(int cascade) { firstCachedCascade = cascade; }
+	int GetFirstCachedCascade() const { return firstCachedCascade; }
+	void SetRefreshInterval(uint64_t frames) { refreshInterval = frames; }
+	uint64_t GetRefreshInterval() const { return refreshInterval; }
+
+	const Cascade& GetCascade(int index) const { return cascades[index]; }
+	FrameBuffer& GetTarget() { return *target; }
+	int GetResolution() const { return resolution; }
+};
+
+
+#endif //CASCADEDSHADOWMAP_H
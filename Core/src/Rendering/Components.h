@@ -30,5 +30,44 @@ struct Name
     std::string name;
 };
 
+// Position comes from the entity's Transform
+struct PointLight
+{
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+    // Distance at which the light has faded out completely
+    float radius = 10.0f;
+};
+
+// Sun style light, only the first one in a scene is used. It points along the
+// Transform rotation with the camera's pitch (x) / yaw (y) convention, in degrees.
+struct DirectionalLight
+{
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+    bool castShadows = true;
+
+    static glm::vec3 GetDirection(const Transform& transform)
+    {
+        const float pitch = glm::radians(transform.rotation.x);
+        const float yaw = glm::radians(transform.rotation.y);
+        return glm::normalize(glm::vec3(cos(yaw) * cos(pitch), sin(pitch), sin(yaw) * cos(pitch)));
+    }
+};
+
+// Marks a model as an occluder for software occlusion culling, picked ahead of
+// the automatically chosen ones. Disabling it keeps the entity from ever occluding.
+struct Occluder
+{
+    bool enabled = true;
+};
+
+// Marks a model that never moves. Cached shadow cascades are only re-rendered
+// when static geometry changes, everything else reaches them on their periodic refresh.
+struct Static
+{
+    bool enabled = true;
+};
+
 
 #endif //COMPONENTS_H
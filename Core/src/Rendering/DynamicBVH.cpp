@@ -0,0 +1,443 @@
+#include "DynamicBVH.h"
+#include <algorithm>
+#include <cmath>
+
+
+int DynamicBVH::AllocateNode()
+{
+	if (freeList == NullNode)
+	{
+		nodes.emplace_back();
+		return static_cast<int>(nodes.size() - 1);
+	}
+
+	const int node = freeList;
+	freeList = nodes[node].Parent;
+	nodes[node] = Node();
+	return node;
+}
+
+void DynamicBVH::FreeNode(int node)
+{
+	nodes[node].Parent = freeList;
+	nodes[node].Height = -1;
+	nodes[node].Entity = entt::null;
+	freeList = node;
+}
+
+AABB DynamicBVH::Fatten(const AABB& box) const
+{
+	return AABB{ box.Min - glm::vec3(margin), box.Max + glm::vec3(margin) };
+}
+
+int DynamicBVH::Insert(const AABB& box, entt::entity entity)
+{
+	const int leaf = AllocateNode();
+	nodes[leaf].Box = Fatten(box);
+	nodes[leaf].Entity = entity;
+	nodes[leaf].Height = 0;
+
+	InsertLeaf(leaf);
+	leafCount++;
+	return leaf;
+}
+
+void DynamicBVH::Remove(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	leafCount--;
+}
+
+bool DynamicBVH::Move(int proxy, const AABB& box)
+{
+	const AABB fat = Fatten(box);
+	const AABB& current = nodes[proxy].Box;
+
+	// Still inside the old fat box, and that box is not far too loose after shrinking
+	if (current.Contains(box) && current.GetSurfaceArea() <= 4.0f * fat.GetSurfaceArea())
+		return false;
+
+	RemoveLeaf(proxy);
+	nodes[proxy].Box = fat;
+	InsertLeaf(proxy);
+	return true;
+}
+
+void DynamicBVH::Clear()
+{
+	nodes.clear();
+	root = NullNode;
+	freeList = NullNode;
+	leafCount = 0;
+}
+
+/*
+ * Branch and bound over the tree (Catto, "Dynamic BVH", GDC 2019). The cost of
+ * making a node the sibling is the area of the new parent plus the area every
+ * ancestor grows by; a subtree is skipped when even a perfect fit below it
+ * cannot beat the best cost so far.
+ */
+int DynamicBVH::FindBestSibling(const AABB& box)
+{
+	const float boxArea = box.GetSurfaceArea();
+
+	int best = root;
+	float bestCost = AABB::Merge(nodes[root].Box, box).GetSurfaceArea();
+
+	searchStack.clear();
+	searchStack.emplace_back(root, 0.0f);
+
+	while (!searchStack.empty())
+	{
+		const auto [index, inheritedCost] = searchStack.back();
+		searchStack.pop_back();
+
+		const Node& node = nodes[index];
+		const float directCost = AABB::Merge(node.Box, box).GetSurfaceArea();
+		const float cost = directCost + inheritedCost;
+
+		if (cost < bestCost)
+		{
+			best = index;
+			bestCost = cost;
+		}
+
+		const float childInheritedCost = inheritedCost + directCost - node.Box.GetSurfaceArea();
+		if (!node.IsLeaf() && boxArea + childInheritedCost < bestCost)
+		{
+			searchStack.emplace_back(node.Child1, childInheritedCost);
+			searchStack.emplace_back(node.Child2, childInheritedCost);
+		}
+	}
+
+	return best;
+}
+
+void DynamicBVH::InsertLeaf(int leaf)
+{
+	if (root == NullNode)
+	{
+		root = leaf;
+		nodes[root].Parent = NullNode;
+		return;
+	}
+
+	const AABB box = nodes[leaf].Box;
+	const int sibling = FindBestSibling(box);
+	const int oldParent = nodes[sibling].Parent;
+
+	const int newParent = AllocateNode();
+	nodes[newParent].Parent = oldParent;
+	nodes[newParent].Box = AABB::Merge(box, nodes[sibling].Box);
+	nodes[newParent].Height = nodes[sibling].Height + 1;
+	nodes[newParent].Child1 = sibling;
+	nodes[newParent].Child2 = leaf;
+	nodes[sibling].Parent = newParent;
+	nodes[leaf].Parent = newParent;
+
+	if (oldParent == NullNode)
+	{
+		root = newParent;
+	}
+	else if (nodes[oldParent].Child1 == sibling)
+	{
+		nodes[oldParent].Child1 = newParent;
+	}
+	else
+	{
+		nodes[oldParent].Child2 = newParent;
+	}
+
+	for (int index = nodes[leaf].Parent; index != NullNode; index = nodes[index].Parent)
+	{
+		Refit(index);
+		Rotate(index);
+	}
+}
+
+void DynamicBVH::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = NullNode;
+		return;
+	}
+
+	const int parent = nodes[leaf].Parent;
+	const int grandParent = nodes[parent].Parent;
+	const int sibling = nodes[parent].Child1 == leaf ? nodes[parent].Child2 : nodes[parent].Child1;
+
+	FreeNode(parent);
+
+	if (grandParent == NullNode)
+	{
+		root = sibling;
+		nodes[sibling].Parent = NullNode;
+		return;
+	}
+
+	if (nodes[grandParent].Child1 == parent)
+		nodes[grandParent].Child1 = sibling;
+	else
+		nodes[grandParent].Child2 = sibling;
+	nodes[sibling].Parent = grandParent;
+
+	for (int index = grandParent; index != NullNode; index = nodes[index].Parent)
+	{
+		Refit(index);
+		Rotate(index);
+	}
+}
+
+void DynamicBVH::Refit(int node)
+{
+	Node& n = nodes[node];
+	n.Box = AABB::Merge(nodes[n.Child1].Box, nodes[n.Child2].Box);
+	n.Height = 1 + std::max(nodes[n.Child1].Height, nodes[n.Child2].Height);
+}
+
+/*
+ * Tries swapping one child of the node with a grandchild from the other side and
+ * keeps the swap that shrinks the affected child's box the most.
+ */
+void DynamicBVH::Rotate(int node)
+{
+	if (nodes[node].Height < 2)
+		return;
+
+	const int b = nodes[node].Child1;
+	const int c = nodes[node].Child2;
+
+	float bestGain = 0.0f;
+	int swapOut = NullNode;
+	int swapIn = NullNode;
+
+	auto consider = [&](int out, int in, int stays, float currentArea)
+	{
+		const float gain = currentArea - AABB::Merge(nodes[out].Box, nodes[stays].Box).GetSurfaceArea();
+		if (gain > bestGain)
+		{
+			bestGain = gain;
+			swapOut = out;
+			swapIn = in;
+		}
+	};
+
+	if (!nodes[c].IsLeaf())
+	{
+		const float area = nodes[c].Box.GetSurfaceArea();
+		consider(b, nodes[c].Child1, nodes[c].Child2, area);
+		consider(b, nodes[c].Child2, nodes[c].Child1, area);
+	}
+
+	if (!nodes[b].IsLeaf())
+	{
+		const float area = nodes[b].Box.GetSurfaceArea();
+		consider(c, nodes[b].Child1, nodes[b].Child2, area);
+		consider(c, nodes[b].Child2, nodes[b].Child1, area);
+	}
+
+	if (swapOut == NullNode)
+		return;
+
+	const int lower = nodes[swapIn].Parent;
+
+	if (nodes[node].Child1 == swapOut)
+		nodes[node].Child1 = swapIn;
+	else
+		nodes[node].Child2 = swapIn;
+	nodes[swapIn].Parent = node;
+
+	if (nodes[lower].Child1 == swapIn)
+		nodes[lower].Child1 = swapOut;
+	else
+		nodes[lower].Child2 = swapOut;
+	nodes[swapOut].Parent = lower;
+
+	Refit(lower);
+	Refit(node);
+}
+
+void DynamicBVH::CollectLeaves(int node, std::vector<entt::entity>& result)
+{
+	stack.clear();
+	stack.push_back(node);
+
+	while (!stack.empty())
+	{
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+
+		if (n.IsLeaf())
+		{
+			result.push_back(n.Entity);
+			continue;
+		}
+		stack.push_back(n.Child1);
+		stack.push_back(n.Child2);
+	}
+}
+
+/*
+ * Every stack entry carries the planes its box still straddles. Planes the box is
+ * fully inside of are dropped for the whole subtree, and once none are left the
+ * subtree is visible without further tests, which keeps the cost near
+ * O(visible + log n) for large scenes.
+ */
+void DynamicBVH::Query(const Frustum& frustum, std::vector<entt::entity>& result)
+{
+	if (root == NullNode)
+		return;
+
+	frustumStack.clear();
+	frustumStack.emplace_back(root, 0x3Fu);
+
+	while (!frustumStack.empty())
+	{
+		const auto [index, parentMask] = frustumStack.back();
+		frustumStack.pop_back();
+
+		const Node& node = nodes[index];
+		const glm::vec3 center = node.Box.GetCenter();
+		const glm::vec3 extents = node.Box.GetExtents();
+
+		unsigned int mask = parentMask;
+		bool outside = false;
+		for (unsigned int plane = 0; plane < 6 && !outside; plane++)
+		{
+			if (!(mask & (1u << plane)))
+				continue;
+
+			const glm::vec4& p = frustum.Planes[plane];
+			const float distance = glm::dot(glm::vec3(p), center) + p.w;
+			const float radius = glm::dot(glm::abs(glm::vec3(p)), extents);
+
+			if (distance + radius < 0.0f)
+				outside = true;
+			else if (distance - radius >= 0.0f)
+				mask &= ~(1u << plane);
+		}
+
+		if (outside)
+			continue;
+
+		if (mask == 0)
+		{
+			CollectLeaves(index, result);
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			result.push_back(node.Entity);
+			continue;
+		}
+
+		frustumStack.emplace_back(node.Child1, mask);
+		frustumStack.emplace_back(node.Child2, mask);
+	}
+}
+
+void DynamicBVH::Query(const AABB& box, std::vector<entt::entity>& result)
+{
+	if (root == NullNode)
+		return;
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.Box.Intersects(box))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			result.push_back(node.Entity);
+			continue;
+		}
+		stack.push_back(node.Child1);
+		stack.push_back(node.Child2);
+	}
+}
+
+void DynamicBVH::Query(const BoundingSphere& sphere, std::vector<entt::entity>& result)
+{
+	if (root == NullNode)
+		return;
+
+	const float radiusSquared = sphere.Radius * sphere.Radius;
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		const glm::vec3 closest = glm::clamp(sphere.Center, node.Box.Min, node.Box.Max);
+		const glm::vec3 offset = closest - sphere.Center;
+		if (glm::dot(offset, offset) > radiusSquared)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			result.push_back(node.Entity);
+			continue;
+		}
+		stack.push_back(node.Child1);
+		stack.push_back(node.Child2);
+	}
+}
+
+// Slab test, returns the entry distance or a negative value on a miss
+static float IntersectRay(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+{
+	const glm::vec3 t0 = (box.Min - origin) * inverseDirection;
+	const glm::vec3 t1 = (box.Max - origin) * inverseDirection;
+	const glm::vec3 tNear = glm::min(t0, t1);
+	const glm::vec3 tFar = glm::max(t0, t1);
+
+	const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+	return enter <= exit ? enter : -1.0f;
+}
+
+void DynamicBVH::RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<RayHit>& result)
+{
+	if (root == NullNode)
+		return;
+
+	const glm::vec3 unit = glm::normalize(direction);
+	const glm::vec3 inverseDirection = 1.0f / unit;
+	const size_t first = result.size();
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		const float distance = IntersectRay(node.Box, origin, inverseDirection, maxDistance);
+		if (distance < 0.0f)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			result.push_back(RayHit{ node.Entity, distance });
+			continue;
+		}
+		stack.push_back(node.Child1);
+		stack.push_back(node.Child2);
+	}
+
+	std::sort(result.begin() + first, result.end(), [](const RayHit& a, const RayHit& b) { return a.Distance < b.Distance; });
+}
@@ -0,0 +1,89 @@
+#ifndef DYNAMICBVH_H
+#define DYNAMICBVH_H
+
+#include <vector>
+#include <entt/entt.hpp>
+
+#include "Bounds.h"
+
+struct RayHit
+{
+	entt::entity Entity;
+	float Distance;
+};
+
+/*
+ * Incrementally maintained AABB tree (as in Box2D). Leaves store a fattened box, so
+ * objects that move a little stay where they are. Insertion looks for the sibling
+ * with the lowest surface area cost (branch and bound over the SAH), and every node
+ * on the way back up is refitted and rotated when swapping a child with a grandchild
+ * makes the tree tighter.
+ *
+ * Proxies are node indices, stable until the leaf is removed.
+ */
+class DynamicBVH
+{
+public:
+	static constexpr int NullNode = -1;
+
+private:
+	struct Node
+	{
+		AABB Box;
+		entt::entity Entity = entt::null;
+		int Parent = NullNode; // next free node while on the free list
+		int Child1 = NullNode;
+		int Child2 = NullNode;
+		int Height = 0; // leaves are 0, free nodes -1
+
+		bool IsLeaf() const { return Child1 == NullNode; }
+	};
+
+	std::vector<Node> nodes;
+
+	// Traversal scratch, kept to avoid allocating per query
+	std::vector<int> stack;
+	std::vector<std::pair<int, float>> searchStack;
+	std::vector<std::pair<int, unsigned int>> frustumStack;
+	int root = NullNode;
+	int freeList = NullNode;
+	size_t leafCount = 0;
+
+	// Added on every side of a leaf box
+	float margin;
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int FindBestSibling(const AABB& box);
+	void Refit(int node);
+	void Rotate(int node);
+	void CollectLeaves(int node, std::vector<entt::entity>& result);
+	AABB Fatten(const AABB& box) const;
+
+public:
+	explicit DynamicBVH(float margin = 0.1f) : margin(margin) {}
+	~DynamicBVH() = default;
+
+	int Insert(const AABB& box, entt::entity entity);
+	void Remove(int proxy);
+	// Returns true when the leaf had to be reinserted
+	bool Move(int proxy, const AABB& box);
+	void Clear();
+
+	// Append every entity whose fat box touches the volume
+	void Query(const Frustum& frustum, std::vector<entt::entity>& result);
+	void Query(const AABB& box, std::vector<entt::entity>& result);
+	void Query(const BoundingSphere& sphere, std::vector<entt::entity>& result);
+	// Hits against the fat boxes, nearest first
+	void RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<RayHit>& result);
+
+	const AABB& GetFatBounds(int proxy) const { return nodes[proxy].Box; }
+	entt::entity GetEntity(int proxy) const { return nodes[proxy].Entity; }
+	int GetHeight() const { return root == NullNode ? 0 : nodes[root].Height; }
+	size_t Size() const { return leafCount; }
+};
+
+
+#endif //DYNAMICBVH_H
@@ -0,0 +1,141 @@
+#include "DynamicResolution.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include "Interface/GLStateCache.h"
+#include "Interface/GpuMemory.h"
+#include "Renderer.h"
+
+
+void DynamicResolution::SetEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled)
+		scale = 1.0f;
+}
+
+void DynamicResolution::UpdateScale(float gpuMilliseconds)
+{
+	gpuTime = gpuTime > 0.0f ? gpuTime + (gpuMilliseconds - gpuTime) * 0.1f : gpuMilliseconds;
+	if (!enabled)
+		return;
+
+	const float budget = 1000.0f / std::max(targetFrameRate, 1.0f) * BudgetFraction;
+	const float desired = std::clamp(scale * std::sqrt(budget / std::max(gpuMilliseconds, 0.01f)), minScale, maxScale);
+
+	// Drop fast when over budget, recover slowly so a single spike does not oscillate
+	const float rate = desired < scale ? 0.5f : 0.1f;
+	const float next = std::round((scale + (desired - scale) * rate) / ScaleStep) * ScaleStep;
+	scale = std::clamp(next, minScale, maxScale);
+}
+
+void DynamicResolution::ReadQueries()
+{
+	while (queriesPending > 0)
+	{
+		GLuint available = 0;
+		glGetQueryObjectuiv(endQueries[queryIndex].Get(), GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(startQueries[queryIndex].Get(), GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(endQueries[queryIndex].Get(), GL_QUERY_RESULT, &end);
+		UpdateScale(static_cast<float>(end - start) * 1e-6f);
+
+		queryIndex = (queryIndex + 1) % QueryCount;
+		queriesPending--;
+	}
+}
+
+glm::ivec2 DynamicResolution::BeginFrame(const FrameBuffer& target)
+{
+	ReadQueries();
+
+	targetSize = glm::ivec2(std::max(1, target.GetWidth()), std::max(1, target.GetHeight()));
+	previousRenderSize = renderSize;
+	renderSize = glm::max(glm::ivec2(glm::round(glm::vec2(targetSize) * scale)), glm::ivec2(1));
+	sourceTexture = target.GetTextureId();
+	upscaled = false;
+
+	GLStateCache::Viewport(0, 0, renderSize.x, renderSize.y);
+
+	measuring = queriesPending < QueryCount;
+	if (measuring)
+	{
+		const size_t slot = (queryIndex + queriesPending) % QueryCount;
+		if (!startQueries[slot])
+		{
+			startQueries[slot] = GLQuery::Create();
+			endQueries[slot] = GLQuery::Create();
+		}
+		glQueryCounter(startQueries[slot].Get(), GL_TIMESTAMP);
+	}
+
+	return renderSize;
+}
+
+void DynamicResolution::EndFrame()
+{
+	if (!measuring)
+		return;
+
+	const size_t slot = (queryIndex + queriesPending) % QueryCount;
+	glQueryCounter(endQueries[slot].Get(), GL_TIMESTAMP);
+	queriesPending++;
+	measuring = false;
+}
+
+void DynamicResolution::Upscale(const FrameBuffer& source, Renderer& renderer)
+{
+	if (filter != UpscaleFilter::Sharpen || renderSize == targetSize)
+		return;
+
+	if (!output)
+	{
+		FrameBufferSpecification specification;
+		specification.Width = targetSize.x;
+		specification.Height = targetSize.y;
+		specification.DepthAttachment = FrameBufferFormat::None;
+		GpuMemoryScope memoryScope("Dynamic Resolution");
+		output = std::make_unique<FrameBuffer>(specification);
+		upscaleShader = Shader("res/shaders/upscale.glsl");
+		sourceUniform = upscaleShader.GetUniform<int>("uSource");
+		sourceScaleUniform = upscaleShader.GetUniform<glm::vec2>("uSourceScale");
+		sourceTexelUniform = upscaleShader.GetUniform<glm::vec2>("uSourceTexel");
+		sharpnessUniform = upscaleShader.GetUniform<float>("uSharpness");
+	}
+	else if (output->GetWidth() != targetSize.x || output->GetHeight() != targetSize.y)
+	{
+		output->Update(targetSize.x, targetSize.y);
+	}
+
+	const unsigned int previousFramebuffer = GLStateCache::GetFramebuffer();
+	output->Bind();
+	GLStateCache::Viewport(0, 0, targetSize.x, targetSize.y);
+	GLStateCache::SetDepthTest(false);
+	GLStateCache::SetColorWrite(true);
+
+	upscaleShader.Bind();
+	upscaleShader.Set(sourceUniform, 0);
+	upscaleShader.Set(sourceScaleUniform, glm::vec2(renderSize) / glm::vec2(targetSize));
+	upscaleShader.Set(sourceTexelUniform, 1.0f / glm::vec2(source.GetWidth(), source.GetHeight()));
+	upscaleShader.Set(sharpnessUniform, sharpness);
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, source.GetTextureId());
+
+	renderer.DrawQuad(upscaleShader);
+
+	GLStateCache::SetDepthTest(true);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	upscaled = true;
+}
+
+unsigned int DynamicResolution::GetOutputTexture() const
+{
+	return upscaled ? output->GetTextureId() : sourceTexture;
+}
+
+glm::vec2 DynamicResolution::GetOutputUV() const
+{
+	return upscaled ? glm::vec2(1.0f) : glm::vec2(renderSize) / glm::vec2(targetSize);
+}
@@ -0,0 +1,114 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "Interface/Abstractions.h"
+#include "Interface/FrameBuffer.h"
+
+class Renderer;
+
+enum class UpscaleFilter : uint8_t
+{
+	// The view samples the rendered rectangle directly, filtered by the texture sampler
+	Bilinear,
+	// Extra fullscreen pass with contrast adaptive sharpening
+	Sharpen
+};
+
+/*
+ * Renders the view into the lower left part of its target and scales it up for
+ * display. GPU time of the scene is measured with a pair of timestamp queries per
+ * frame, read back a few frames later, and the scale follows it so the scene stays
+ * within a share of the target frame time. Cost is proportional to the pixel
+ * count, so the axis scale moves with the square root of the budget ratio, fast
+ * when over budget and slowly back up.
+ */
+class DynamicResolution
+{
+public:
+	// Timestamp pairs in flight, results are read without stalling
+	static constexpr size_t QueryCount = 4;
+	// Share of the frame time the scene may take, the rest is left to the editor UI
+	static constexpr float BudgetFraction = 0.8f;
+	// Scales are quantized to these steps so noise does not resize the view every frame
+	static constexpr float ScaleStep = 1.0f / 64.0f;
+
+private:
+	bool enabled = false;
+	UpscaleFilter filter = UpscaleFilter::Bilinear;
+	float targetFrameRate = 60.0f;
+	float minScale = 0.25f;
+	float maxScale = 1.0f;
+	float sharpness = 0.5f;
+
+	float scale = 1.0f;
+	float gpuTime = 0.0f;
+
+	GLQuery startQueries[QueryCount];
+	GLQuery endQueries[QueryCount];
+	size_t queryIndex = 0;
+	size_t queriesPending = 0;
+	bool measuring = false;
+
+	glm::ivec2 renderSize = glm::ivec2(1);
+	glm::ivec2 previousRenderSize = glm::ivec2(1);
+	glm::ivec2 targetSize = glm::ivec2(1);
+	unsigned int sourceTexture = 0;
+	std::unique_ptr<FrameBuffer> output;
+	Shader upscaleShader;
+	UniformHandle<int> sourceUniform;
+	UniformHandle<glm::vec2> sourceScaleUniform;
+	UniformHandle<glm::vec2> sourceTexelUniform;
+	UniformHandle<float> sharpnessUniform;
+	bool upscaled = false;
+
+	void ReadQueries();
+
+public:
+	DynamicResolution() = default;
+
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	// Picks the render size inside a target of the given size, set it as the viewport before drawing
+	glm::ivec2 BeginFrame(const FrameBuffer& target);
+	void EndFrame();
+	// Sharpened upscale into the output target, a no-op for bilinear or at full scale
+	void Upscale(const FrameBuffer& source, Renderer& renderer);
+
+	// Moves the scale toward what fits the budget, given the scene's GPU time in milliseconds
+	void UpdateScale(float gpuMilliseconds);
+
+	// What the view should display for the last frame: a texture and the top right corner
+	// of the rectangle to show, the bottom left being (0, 0)
+	unsigned int GetOutputTexture() const;
+	glm::vec2 GetOutputUV() const;
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return enabled; }
+	void SetFilter(UpscaleFilter filter) { this->filter = filter; }
+	UpscaleFilter GetFilter() const { return filter; }
+	void SetTargetFrameRate(float frameRate) { targetFrameRate = frameRate; }
+	float GetTargetFrameRate() const { return targetFrameRate; }
+	void SetScaleRange(float minScale, float maxScale) { this->minScale = minScale; this->maxScale = maxScale; }
+	float GetMinScale() const { return minScale; }
+	float GetMaxScale() const { return maxScale; }
+	void SetSharpness(float sharpness) { this->sharpness = sharpness; }
+	float GetSharpness() const { return sharpness; }
+
+	float GetScale() const { return scale; }
+	// Smoothed GPU time of the scene in milliseconds
+	float GetGpuTime() const { return gpuTime; }
+	glm::ivec2 GetRenderSize() const { return renderSize; }
+	// Set when BeginFrame picked another render size than the frame before, from a scale
+	// step or a resize of the target; pass the previous size to Renderer::OnRenderSizeChanged
+	bool IsRenderSizeChanged() const { return renderSize != previousRenderSize; }
+	glm::ivec2 GetPreviousRenderSize() const { return previousRenderSize; }
+};
+
+
+#endif //DYNAMICRESOLUTION_H
@@ -0,0 +1,169 @@
+#include "FrustumCuller.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(__AVX2__)
+#define CULLING_SSE 1
+#include <immintrin.h>
+#endif
+
+
+void FrustumCuller::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+void FrustumCuller::Reserve(size_t count)
+{
+	centerX.reserve(count);
+	centerY.reserve(count);
+	centerZ.reserve(count);
+	extentX.reserve(count);
+	extentY.reserve(count);
+	extentZ.reserve(count);
+}
+
+uint32_t FrustumCuller::Add(const AABB& bounds)
+{
+	const glm::vec3 center = bounds.GetCenter();
+	const glm::vec3 extents = bounds.GetExtents();
+
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+
+	return static_cast<uint32_t>(centerX.size() - 1);
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	size_t done = CullAVX2(frustum, visible);
+	if (done == 0)
+		done = CullSSE(frustum, visible);
+
+	CullScalar(frustum, done, Size(), visible);
+}
+
+void FrustumCuller::CullScalar(const Frustum& frustum, size_t first, size_t last, std::vector<uint32_t>& visible) const
+{
+	for (size_t i = first; i < last; i++)
+	{
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.Planes)
+		{
+			const float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+			const float radius = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] + std::abs(plane.z) * extentZ[i];
+			if (distance + radius < 0.0f)
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside)
+			visible.push_back(static_cast<uint32_t>(i));
+	}
+}
+
+/*
+ * Both kernels return how many boxes they handled, always a multiple of their
+ * width, the scalar loop picks up the rest.
+ */
+size_t FrustumCuller::CullSSE(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+#if defined(CULLING_SSE)
+	const size_t blocks = Size() / 4;
+	const __m128 zero = _mm_setzero_ps();
+
+	for (size_t block = 0; block < blocks; block++)
+	{
+		const size_t base = block * 4;
+		const __m128 cx = _mm_loadu_ps(&centerX[base]);
+		const __m128 cy = _mm_loadu_ps(&centerY[base]);
+		const __m128 cz = _mm_loadu_ps(&centerZ[base]);
+		const __m128 ex = _mm_loadu_ps(&extentX[base]);
+		const __m128 ey = _mm_loadu_ps(&extentY[base]);
+		const __m128 ez = _mm_loadu_ps(&extentZ[base]);
+
+		__m128 outside = zero;
+		for (const glm::vec4& plane : frustum.Planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_set1_ps(plane.w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+
+			__m128 radius = _mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex);
+			radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey));
+			radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		const int mask = ~_mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane))
+				visible.push_back(static_cast<uint32_t>(base + lane));
+		}
+	}
+
+	return blocks * 4;
+#else
+	(void)frustum;
+	(void)visible;
+	return 0;
+#endif
+}
+
+size_t FrustumCuller::CullAVX2(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+#if defined(__AVX2__)
+	const size_t blocks = Size() / 8;
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (size_t block = 0; block < blocks; block++)
+	{
+		const size_t base = block * 8;
+		const __m256 cx = _mm256_loadu_ps(&centerX[base]);
+		const __m256 cy = _mm256_loadu_ps(&centerY[base]);
+		const __m256 cz = _mm256_loadu_ps(&centerZ[base]);
+		const __m256 ex = _mm256_loadu_ps(&extentX[base]);
+		const __m256 ey = _mm256_loadu_ps(&extentY[base]);
+		const __m256 ez = _mm256_loadu_ps(&extentZ[base]);
+
+		__m256 outside = zero;
+		for (const glm::vec4& plane : frustum.Planes)
+		{
+			__m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.x), cx, _mm256_set1_ps(plane.w));
+			distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.y), cy, distance);
+			distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.z), cz, distance);
+
+			__m256 radius = _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex);
+			radius = _mm256_fmadd_ps(_mm256_set1_ps(std::abs(plane.y)), ey, radius);
+			radius = _mm256_fmadd_ps(_mm256_set1_ps(std::abs(plane.z)), ez, radius);
+
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+		}
+
+		const int mask = ~_mm256_movemask_ps(outside);
+		for (int lane = 0; lane < 8; lane++)
+		{
+			if (mask & (1 << lane))
+				visible.push_back(static_cast<uint32_t>(base + lane));
+		}
+	}
+
+	return blocks * 8;
+#else
+	(void)frustum;
+	(void)visible;
+	return 0;
+#endif
+}
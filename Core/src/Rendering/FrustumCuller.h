@@ -0,0 +1,40 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+
+/*
+ * Batch frustum test over world space boxes stored as separate center/extent
+ * arrays, so one plane can be tested against 8 (AVX2) or 4 (SSE) boxes at once.
+ * The AVX2 kernel is only built with OPENRENDERER_AVX2, SSE is the x86-64
+ * baseline and other architectures use the scalar loop.
+ */
+class FrustumCuller
+{
+private:
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void CullScalar(const Frustum& frustum, size_t first, size_t last, std::vector<uint32_t>& visible) const;
+	size_t CullSSE(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+	size_t CullAVX2(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+public:
+	FrustumCuller() = default;
+	~FrustumCuller() = default;
+
+	void Clear();
+	void Reserve(size_t count);
+	uint32_t Add(const AABB& bounds);
+
+	// Appends the indices of all boxes intersecting the frustum, in ascending order
+	void Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	size_t Size() const { return centerX.size(); }
+};
+
+
+#endif //FRUSTUMCULLER_H
@@ -0,0 +1,210 @@
+#include "GpuProfiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+
+GpuProfiler& GpuProfiler::Get()
+{
+	static GpuProfiler instance;
+	return instance;
+}
+
+float GpuProfiler::AddSample(History& history, float sample)
+{
+	if (history.Count == AverageWindow)
+		history.Sum -= history.Samples[history.Head];
+	else
+		history.Count++;
+
+	history.Samples[history.Head] = sample;
+	history.Head = (history.Head + 1) % AverageWindow;
+	history.Sum += sample;
+	return history.Sum / static_cast<float>(history.Count);
+}
+
+uint32_t GpuProfiler::FindScope(const char* name)
+{
+	const uint32_t parent = scopeStack.empty() ? ~0u : scopeStack.back();
+
+	pathBuffer.clear();
+	if (parent != ~0u)
+	{
+		pathBuffer += timings[parent].Path;
+		pathBuffer += '/';
+	}
+	pathBuffer += name;
+
+	auto it = scopeIndices.find(pathBuffer);
+	if (it != scopeIndices.end())
+		return it->second;
+
+	const uint32_t index = static_cast<uint32_t>(timings.size());
+	ScopeTiming timing;
+	timing.Name = name;
+	timing.Path = pathBuffer;
+	timing.Depth = static_cast<int>(scopeStack.size());
+	timings.push_back(timing);
+	histories.emplace_back();
+	scopeIndices.emplace(pathBuffer, index);
+	return index;
+}
+
+uint32_t GpuProfiler::WriteTimestamp(Frame& frame)
+{
+	if (frame.QueriesUsed == frame.Queries.size())
+	{
+		frame.Queries.push_back(GLQuery::Create());
+	}
+
+	const uint32_t index = frame.QueriesUsed++;
+	glQueryCounter(frame.Queries[index].Get(), GL_TIMESTAMP);
+	return index;
+}
+
+void GpuProfiler::BeginFrame()
+{
+	ReadFrames();
+
+	scopeStack.clear();
+	recordStack.clear();
+
+	Frame& frame = frames[writeFrame];
+	recording = enabled && !frame.Pending;
+	if (enabled && frame.Pending)
+		framesSkipped++;
+
+	if (recording)
+	{
+		frame.QueriesUsed = 0;
+		frame.Records.clear();
+	}
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (!recording)
+		return;
+
+	Frame& frame = frames[writeFrame];
+	if (!frame.Records.empty())
+	{
+		frame.Pending = true;
+		writeFrame = (writeFrame + 1) % FrameLatency;
+	}
+	recording = false;
+}
+
+void GpuProfiler::BeginScope(const char* name)
+{
+	const uint32_t scope = FindScope(name);
+	scopeStack.push_back(scope);
+
+	if (!recording)
+		return;
+
+	Frame& frame = frames[writeFrame];
+	recordStack.push_back(static_cast<uint32_t>(frame.Records.size()));
+	frame.Records.push_back({ scope, WriteTimestamp(frame), 0 });
+}
+
+void GpuProfiler::EndScope()
+{
+	if (scopeStack.empty())
+		return;
+	scopeStack.pop_back();
+
+	if (!recording || recordStack.empty())
+		return;
+
+	Frame& frame = frames[writeFrame];
+	frame.Records[recordStack.back()].EndQuery = WriteTimestamp(frame);
+	recordStack.pop_back();
+}
+
+// Timestamps complete in order, so a frame is ready once its last query is
+void GpuProfiler::ReadFrames()
+{
+	while (frames[readFrame].Pending)
+	{
+		Frame& frame = frames[readFrame];
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(frame.Queries[frame.QueriesUsed - 1].Get(), GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		timestamps.resize(frame.QueriesUsed);
+		for (uint32_t i = 0; i < frame.QueriesUsed; i++)
+		{
+			GLuint64 timestamp = 0;
+			glGetQueryObjectui64v(frame.Queries[i].Get(), GL_QUERY_RESULT, &timestamp);
+			timestamps[i] = timestamp;
+		}
+
+		frameOrder.clear();
+		uint64_t frameStart = ~0ull, frameEnd = 0;
+		for (const Record& record : frame.Records)
+		{
+			const uint64_t start = timestamps[record.StartQuery];
+			const uint64_t end = std::max(timestamps[record.EndQuery], start);
+			frameStart = std::min(frameStart, start);
+			frameEnd = std::max(frameEnd, end);
+
+			History& history = histories[record.Scope];
+			if (!history.Touched)
+			{
+				history.Touched = true;
+				history.FrameTotal = 0.0f;
+				frameOrder.push_back(record.Scope);
+			}
+			history.FrameTotal += static_cast<float>(end - start) * 1e-6f;
+		}
+
+		for (uint32_t scope : frameOrder)
+		{
+			History& history = histories[scope];
+			ScopeTiming& timing = timings[scope];
+			timing.LastMs = history.FrameTotal;
+			timing.AverageMs = AddSample(history, history.FrameTotal);
+			timing.MaxMs = *std::max_element(history.Samples, history.Samples + history.Count);
+			timing.Samples++;
+			history.Touched = false;
+		}
+
+		frameTime = AddSample(frameHistory, static_cast<float>(frameEnd - frameStart) * 1e-6f);
+		framesMeasured++;
+
+		frame.Pending = false;
+		readFrame = (readFrame + 1) % FrameLatency;
+	}
+}
+
+void GpuProfiler::Reset()
+{
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		histories[i] = History();
+		timings[i].LastMs = 0.0f;
+		timings[i].AverageMs = 0.0f;
+		timings[i].MaxMs = 0.0f;
+		timings[i].Samples = 0;
+	}
+
+	frameHistory = History();
+	frameTime = 0.0f;
+	framesMeasured = 0;
+	framesSkipped = 0;
+}
+
+void GpuProfiler::GetTimings(std::vector<ScopeTiming>& out) const
+{
+	out.clear();
+	for (uint32_t scope : frameOrder)
+		out.push_back(timings[scope]);
+}
+
+const GpuProfiler::ScopeTiming* GpuProfiler::FindTiming(const std::string& path) const
+{
+	auto it = scopeIndices.find(path);
+	return it != scopeIndices.end() ? &timings[it->second] : nullptr;
+}
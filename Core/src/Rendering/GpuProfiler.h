@@ -0,0 +1,140 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Interface/GLResource.h"
+
+/*
+ * GPU time of named, nestable scopes. Every scope boundary writes a GL_TIMESTAMP
+ * query, so scopes can nest freely (GL_TIME_ELAPSED queries cannot). Queries of a
+ * frame are read back FrameLatency - 1 frames later, once the last one of the frame
+ * is available; if the GPU falls further behind, frames are left unmeasured instead
+ * of waiting on it.
+ *
+ * Scopes are identified by their path, "Scene View/GBuffer" for a GBuffer scope
+ * inside Scene View. Scopes entered several times in a frame add up. Timings are
+ * averaged over the last AverageWindow measured frames.
+ */
+class GpuProfiler
+{
+public:
+	static constexpr size_t FrameLatency = 4;
+	static constexpr size_t AverageWindow = 64;
+
+	struct ScopeTiming
+	{
+		std::string Name;
+		std::string Path;
+		int Depth = 0;
+		float LastMs = 0.0f;
+		float AverageMs = 0.0f;
+		// Largest sample in the window
+		float MaxMs = 0.0f;
+		size_t Samples = 0;
+	};
+
+private:
+	struct Record
+	{
+		uint32_t Scope;
+		uint32_t StartQuery;
+		uint32_t EndQuery;
+	};
+
+	struct Frame
+	{
+		std::vector<GLQuery> Queries;
+		uint32_t QueriesUsed = 0;
+		std::vector<Record> Records;
+		bool Pending = false;
+	};
+
+	struct History
+	{
+		float Samples[AverageWindow] = {};
+		size_t Count = 0;
+		size_t Head = 0;
+		float Sum = 0.0f;
+		float FrameTotal = 0.0f;
+		bool Touched = false;
+	};
+
+	Frame frames[FrameLatency];
+	size_t writeFrame = 0;
+	size_t readFrame = 0;
+	bool enabled = true;
+	bool recording = false;
+
+	std::vector<ScopeTiming> timings;
+	std::vector<History> histories;
+	std::unordered_map<std::string, uint32_t> scopeIndices;
+	// Scopes of the last measured frame, in the order they began
+	std::vector<uint32_t> frameOrder;
+	std::vector<uint32_t> scopeStack;
+	std::vector<uint32_t> recordStack;
+	std::string pathBuffer;
+	std::vector<uint64_t> timestamps;
+
+	History frameHistory;
+	float frameTime = 0.0f;
+	uint64_t framesMeasured = 0;
+	uint64_t framesSkipped = 0;
+
+	GpuProfiler() = default;
+
+	uint32_t FindScope(const char* name);
+	uint32_t WriteTimestamp(Frame& frame);
+	void ReadFrames();
+	static float AddSample(History& history, float sample);
+
+public:
+	~GpuProfiler() = default;
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	static GpuProfiler& Get();
+
+	// Reads back finished frames and starts recording a new one
+	void BeginFrame();
+	void EndFrame();
+
+	void BeginScope(const char* name);
+	void EndScope();
+
+	// Disabling stops issuing queries, frames already in flight are still read
+	void SetEnabled(bool enabled) { this->enabled = enabled; }
+	bool IsEnabled() const { return enabled; }
+
+	// Forgets all samples, e.g. after a benchmark's warm-up frames
+	void Reset();
+
+	// Scopes of the last measured frame in the order they began, parents before children
+	void GetTimings(std::vector<ScopeTiming>& out) const;
+	const ScopeTiming* FindTiming(const std::string& path) const;
+
+	// GPU time from the start of the first scope to the end of the last, averaged
+	float GetFrameTime() const { return frameTime; }
+	uint64_t GetFramesMeasured() const { return framesMeasured; }
+	// Frames not measured because the GPU was FrameLatency frames behind
+	uint64_t GetFramesSkipped() const { return framesSkipped; }
+};
+
+// Times the enclosing block
+class GpuProfileScope
+{
+public:
+	explicit GpuProfileScope(const char* name) { GpuProfiler::Get().BeginScope(name); }
+	~GpuProfileScope() { GpuProfiler::Get().EndScope(); }
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+
+#endif //GPUPROFILER_H
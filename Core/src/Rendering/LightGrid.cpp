@@ -0,0 +1,122 @@
+#include "LightGrid.h"
+#include "System/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+
+LightGrid::LightGrid(JobSystem* jobs)
+	: jobs(jobs), froxelLights(ClusterCount), clusters(ClusterCount, glm::uvec2(0))
+{
+}
+
+glm::vec2 LightGrid::GetSliceParameters() const
+{
+	const float range = std::log(farPlane / nearPlane);
+	return glm::vec2(Slices / range, -Slices * std::log(nearPlane) / range);
+}
+
+// Distance from v to [low, high], zero inside
+static float AxisDistance(float v, float low, float high)
+{
+	return v < low ? low - v : (v > high ? v - high : 0.0f);
+}
+
+void LightGrid::AssignSlice(int slice)
+{
+	const float nearDepth = sliceDepth[slice];
+	const float farDepth = sliceDepth[slice + 1];
+
+	float minX[TilesX], maxX[TilesX], minY[TilesY], maxY[TilesY];
+	for (int x = 0; x < TilesX; x++)
+	{
+		minX[x] = std::min(slopeX[x] * nearDepth, slopeX[x] * farDepth);
+		maxX[x] = std::max(slopeX[x + 1] * nearDepth, slopeX[x + 1] * farDepth);
+	}
+	for (int y = 0; y < TilesY; y++)
+	{
+		minY[y] = std::min(slopeY[y] * nearDepth, slopeY[y] * farDepth);
+		maxY[y] = std::max(slopeY[y + 1] * nearDepth, slopeY[y + 1] * farDepth);
+	}
+
+	for (int i = 0; i < TilesX * TilesY; i++)
+		froxelLights[GetClusterIndex(0, 0, slice) + i].clear();
+
+	for (uint32_t light = 0; light < viewLights.size(); light++)
+	{
+		const glm::vec4& sphere = viewLights[light];
+		const float radiusSq = sphere.w * sphere.w;
+
+		// View space looks down -z
+		const float dz = AxisDistance(-sphere.z, nearDepth, farDepth);
+		const float remainingZ = radiusSq - dz * dz;
+		if (remainingZ < 0.0f)
+			continue;
+
+		for (int x = 0; x < TilesX; x++)
+		{
+			const float dx = AxisDistance(sphere.x, minX[x], maxX[x]);
+			const float remainingX = remainingZ - dx * dx;
+			if (remainingX < 0.0f)
+				continue;
+
+			for (int y = 0; y < TilesY; y++)
+			{
+				const float dy = AxisDistance(sphere.y, minY[y], maxY[y]);
+				if (dy * dy <= remainingX)
+					froxelLights[GetClusterIndex(x, y, slice)].push_back(light);
+			}
+		}
+	}
+}
+
+void LightGrid::Build(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const std::vector<Light>& lights)
+{
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+
+	for (int z = 0; z <= Slices; z++)
+		sliceDepth[z] = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / Slices);
+
+	// Tile edges unprojected onto the near plane give their slope per unit depth
+	const glm::mat4 inverseProjection = glm::inverse(projection);
+	auto slope = [&](float ndcX, float ndcY)
+	{
+		glm::vec4 point = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+		point /= point.w;
+		return glm::vec2(point.x, point.y) / -point.z;
+	};
+	for (int x = 0; x <= TilesX; x++)
+		slopeX[x] = slope(-1.0f + 2.0f * x / TilesX, 0.0f).x;
+	for (int y = 0; y <= TilesY; y++)
+		slopeY[y] = slope(0.0f, -1.0f + 2.0f * y / TilesY).y;
+
+	viewLights.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const glm::vec4 position = view * glm::vec4(glm::vec3(lights[i].PositionRadius), 1.0f);
+		viewLights[i] = glm::vec4(glm::vec3(position), lights[i].PositionRadius.w);
+	}
+
+	auto assign = [this](size_t begin, size_t end)
+	{
+		for (size_t slice = begin; slice < end; slice++)
+			AssignSlice(static_cast<int>(slice));
+	};
+
+	if (jobs && !viewLights.empty())
+		jobs->ParallelFor(Slices, 1, assign);
+	else
+		assign(0, Slices);
+
+	lightIndices.clear();
+	droppedAssignments = 0;
+	for (int i = 0; i < ClusterCount; i++)
+	{
+		const std::vector<uint32_t>& list = froxelLights[i];
+		const size_t count = std::min(list.size(), maxLightIndices - lightIndices.size());
+		droppedAssignments += list.size() - count;
+
+		clusters[i] = glm::uvec2(static_cast<uint32_t>(lightIndices.size()), static_cast<uint32_t>(count));
+		lightIndices.insert(lightIndices.end(), list.begin(), list.begin() + count);
+	}
+}
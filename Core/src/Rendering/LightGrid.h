@@ -0,0 +1,83 @@
+#ifndef LIGHTGRID_H
+#define LIGHTGRID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+/*
+ * Froxel grid for clustered forward shading.
+ *
+ * The view frustum is split into TilesX x TilesY screen tiles and Slices depth
+ * slices spaced exponentially between the near and far plane. Every point light
+ * is assigned to the froxels its sphere touches, the fragment shader finds its
+ * froxel from gl_FragCoord and view depth and only loops over those lights.
+ *
+ * Assignment runs one depth slice per job. A froxel's view space bounds are
+ * separable, x only depends on the tile column and y on the row, so a light walks
+ * just the columns and rows its sphere reaches.
+ */
+class LightGrid
+{
+public:
+	static constexpr int TilesX = 16;
+	static constexpr int TilesY = 9;
+	static constexpr int Slices = 24;
+	static constexpr int ClusterCount = TilesX * TilesY * Slices;
+	// Guaranteed texture buffer size, the default limit of the index list
+	static constexpr size_t MinLightIndices = 65536;
+
+	// World space, laid out as the two texels per light the shader reads
+	struct Light
+	{
+		glm::vec4 PositionRadius;
+		glm::vec4 ColorIntensity;
+	};
+
+private:
+	JobSystem* jobs;
+
+	float nearPlane = 0.1f;
+	float farPlane = 1000.0f;
+	float sliceDepth[Slices + 1] = {};
+	// View space x / y per unit of depth at the tile edges
+	float slopeX[TilesX + 1] = {};
+	float slopeY[TilesY + 1] = {};
+
+	std::vector<glm::vec4> viewLights;
+	// Per froxel light lists, kept between frames for their capacity
+	std::vector<std::vector<uint32_t>> froxelLights;
+
+	std::vector<glm::uvec2> clusters;
+	std::vector<uint32_t> lightIndices;
+	size_t maxLightIndices = MinLightIndices;
+	size_t droppedAssignments = 0;
+
+	void AssignSlice(int slice);
+
+public:
+	explicit LightGrid(JobSystem* jobs = nullptr);
+	~LightGrid() = default;
+
+	void Build(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const std::vector<Light>& lights);
+
+	// Offset into the index list and light count, per froxel
+	const std::vector<glm::uvec2>& GetClusters() const { return clusters; }
+	const std::vector<uint32_t>& GetLightIndices() const { return lightIndices; }
+
+	// Size of the texture buffer the indices go into, assignments past it are dropped
+	void SetMaxLightIndices(size_t count) { maxLightIndices = std::max(count, MinLightIndices); }
+	size_t GetMaxLightIndices() const { return maxLightIndices; }
+	// Froxel light assignments the last Build had no room for
+	size_t GetDroppedAssignments() const { return droppedAssignments; }
+
+	// slice = log(depth) * x + y
+	glm::vec2 GetSliceParameters() const;
+	static int GetClusterIndex(int x, int y, int slice) { return x + TilesX * (y + TilesY * slice); }
+};
+
+
+#endif //LIGHTGRID_H
@@ -4,17 +4,20 @@
 
 #ifndef MATERIAL_H
 #define MATERIAL_H
-#include "Interface/Abstractions.h"
+#include <string>
+#include "ResourcePool.h"
 
 /*
- * Very simplified version of Material
+ * Very simplified version of Material. Lives in the ResourceRegistry, entities
+ * hold a MaterialHandle to it.
  */
 
 struct Material
 {
-    Texture Albedo;
-    Shader Shader;
+    TextureHandle Albedo;
+    ShaderHandle Shader;
     std::string Name;
+    bool Transparent = false;
 };
 
 
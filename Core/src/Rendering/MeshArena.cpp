@@ -0,0 +1,341 @@
+#include "MeshArena.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iterator>
+
+#include "Interface/GLExtensions.h"
+#include "Interface/GLStateCache.h"
+#include "Interface/GpuMemory.h"
+
+
+unsigned int FreeListAllocator::Allocate(unsigned int size)
+{
+	if (size == 0)
+		return 0;
+
+	auto best = freeRanges.end();
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		if (it->second < size || (best != freeRanges.end() && it->second >= best->second))
+			continue;
+		best = it;
+		if (it->second == size)
+			break;
+	}
+
+	if (best == freeRanges.end())
+		return Invalid;
+
+	const unsigned int offset = best->first;
+	const unsigned int remaining = best->second - size;
+	freeRanges.erase(best);
+	if (remaining > 0)
+		freeRanges.emplace(offset + size, remaining);
+	freeSize -= size;
+	return offset;
+}
+
+void FreeListAllocator::Free(unsigned int offset, unsigned int size)
+{
+	if (size == 0)
+		return;
+
+	unsigned int first = offset;
+	unsigned int last = offset + size;
+
+	auto next = freeRanges.lower_bound(offset);
+	if (next != freeRanges.end() && next->first == last)
+	{
+		last += next->second;
+		next = freeRanges.erase(next);
+	}
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == first)
+		{
+			first = previous->first;
+			freeRanges.erase(previous);
+		}
+	}
+
+	freeRanges.emplace(first, last - first);
+	freeSize += size;
+}
+
+void FreeListAllocator::Reset(unsigned int newCapacity, unsigned int used)
+{
+	freeRanges.clear();
+	capacity = newCapacity;
+	freeSize = newCapacity - used;
+	if (freeSize > 0)
+		freeRanges.emplace(used, freeSize);
+}
+
+unsigned int FreeListAllocator::GetLargestFree() const
+{
+	unsigned int largest = 0;
+	for (const auto& range : freeRanges)
+		largest = std::max(largest, range.second);
+	return largest;
+}
+
+
+namespace
+{
+	float GetFragmentation(const FreeListAllocator& allocator)
+	{
+		const unsigned int free = allocator.GetFreeSize();
+		return free > 0 ? 1.0f - static_cast<float>(allocator.GetLargestFree()) / free : 0.0f;
+	}
+
+	GLBuffer CreateStorage(size_t size, GpuMemoryCategory category)
+	{
+		GLBuffer buffer = GLBuffer::Create();
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, buffer.Get());
+		if (GLCapabilities::Get().BufferStorage)
+			glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		else
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+		GpuMemory::Track(category, GLObjectType::Buffer, buffer.Get(), size, "Mesh Arena");
+		return buffer;
+	}
+
+	// Elements moving from Read to Write
+	struct RangeCopy
+	{
+		unsigned int Read;
+		unsigned int Write;
+		unsigned int Length;
+	};
+
+	// Moves the ranges to the front keeping their order, returns the elements they take.
+	// Ranges that are already back to back move with one copy.
+	unsigned int PackRanges(std::vector<MeshArena::Range*>& live, unsigned int MeshArena::Range::* first,
+		unsigned int MeshArena::Range::* count, std::vector<RangeCopy>& copies)
+	{
+		std::sort(live.begin(), live.end(), [first](const MeshArena::Range* a, const MeshArena::Range* b) { return a->*first < b->*first; });
+
+		copies.clear();
+		unsigned int packed = 0;
+		for (size_t i = 0; i < live.size();)
+		{
+			const unsigned int readOffset = live[i]->*first;
+			unsigned int length = 0;
+			do
+			{
+				live[i]->*first = packed + length;
+				length += live[i]->*count;
+				i++;
+			} while (i < live.size() && live[i]->*first == readOffset + length);
+
+			if (length > 0)
+				copies.push_back(RangeCopy{ readOffset, packed, length });
+			packed += length;
+		}
+		return packed;
+	}
+
+	void CopyRanges(const std::vector<RangeCopy>& copies, size_t elementSize, unsigned int source, unsigned int destination)
+	{
+		GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, source);
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, destination);
+		for (const RangeCopy& copy : copies)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				copy.Read * elementSize, copy.Write * elementSize, copy.Length * elementSize);
+		}
+	}
+
+	unsigned int GetVertexSize(const VertexFormat& format)
+	{
+		unsigned int size = 0;
+		for (const VertexLayout& layout : format)
+			size += layout.Stride;
+		return size;
+	}
+}
+
+// Never destroyed, meshes free their geometry during exit
+MeshArena& MeshArena::Get()
+{
+	static MeshArena* arena = new MeshArena();
+	return *arena;
+}
+
+uint32_t MeshArena::FindPool(const VertexFormat& format)
+{
+	for (uint32_t i = 0; i < pools.size(); i++)
+	{
+		if (pools[i].Format == format)
+			return i;
+	}
+
+	Pool pool;
+	pool.Format = format;
+	pools.push_back(std::move(pool));
+
+	const uint32_t index = static_cast<uint32_t>(pools.size() - 1);
+	Rebuild(index, 0, 0);
+	return index;
+}
+
+void MeshArena::Rebuild(uint32_t index, unsigned int extraVertices, unsigned int extraIndices)
+{
+	Pool& pool = pools[index];
+
+	std::vector<Range*> live;
+	size_t liveVertices = 0;
+	size_t liveIndices = 0;
+	for (Range& range : ranges)
+	{
+		if (range.Pool != index)
+			continue;
+		live.push_back(&range);
+		liveVertices += range.VertexCount;
+		liveIndices += range.IndexCount;
+	}
+
+	// Twice what is needed, so neither growing nor compacting happens again right away
+	const unsigned int vertexCapacity = static_cast<unsigned int>(std::max<size_t>(InitialVertexCapacity, 2 * (liveVertices + extraVertices)));
+	const unsigned int indexCapacity = static_cast<unsigned int>(std::max<size_t>(InitialIndexCapacity, 2 * (liveIndices + extraIndices)));
+
+	std::vector<GLBuffer> vertices;
+	for (const VertexLayout& layout : pool.Format)
+		vertices.push_back(CreateStorage(static_cast<size_t>(vertexCapacity) * layout.Stride, GpuMemoryCategory::VertexBuffer));
+	GLBuffer indices = CreateStorage(static_cast<size_t>(indexCapacity) * sizeof(unsigned int), GpuMemoryCategory::IndexBuffer);
+
+	unsigned int packedVertices = 0;
+	unsigned int packedIndices = 0;
+	if (!live.empty())
+	{
+		// Every stream holds a mesh's vertices at the same place, so they all move the same way
+		std::vector<RangeCopy> copies;
+		packedVertices = PackRanges(live, &Range::BaseVertex, &Range::VertexCount, copies);
+		for (size_t i = 0; i < pool.Format.size(); i++)
+			CopyRanges(copies, pool.Format[i].Stride, pool.Vertices[i].Get(), vertices[i].Get());
+
+		packedIndices = PackRanges(live, &Range::FirstIndex, &Range::IndexCount, copies);
+		CopyRanges(copies, sizeof(unsigned int), pool.Indices.Get(), indices.Get());
+	}
+
+	pool.VertexAllocator.Reset(vertexCapacity, packedVertices);
+	pool.IndexAllocator.Reset(indexCapacity, packedIndices);
+	pool.Vertices = std::move(vertices);
+	pool.Indices = std::move(indices);
+
+	// Whatever was waiting to be freed stayed behind in the old buffers
+	pendingFrees.erase(std::remove_if(pendingFrees.begin(), pendingFrees.end(),
+		[index](const PendingFree& pending) { return pending.Freed.Pool == index; }), pendingFrees.end());
+
+	// The element buffer binding is vertex array state
+	pool.Array.Bind();
+	GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.Indices.Get());
+	for (size_t i = 0; i < pool.Format.size(); i++)
+		pool.Array.SetLayout(pool.Vertices[i].Get(), pool.Format[i]);
+	pool.Array.Unbind();
+}
+
+bool MeshArena::ShouldCompact(const Pool& pool) const
+{
+	const FreeListAllocator* allocators[] = { &pool.VertexAllocator, &pool.IndexAllocator };
+	for (const FreeListAllocator* allocator : allocators)
+	{
+		if (allocator->GetFreeSize() >= allocator->GetCapacity() * MinFreeToCompact
+			&& GetFragmentation(*allocator) > MaxFragmentation)
+			return true;
+	}
+	return false;
+}
+
+GeometryHandle MeshArena::Allocate(const VertexFormat& format, const void* const* streams, unsigned int vertexCount,
+	const unsigned int* indices, unsigned int indexCount)
+{
+	const uint32_t index = FindPool(format);
+	Pool& pool = pools[index];
+
+	unsigned int baseVertex = pool.VertexAllocator.Allocate(vertexCount);
+	unsigned int firstIndex = pool.IndexAllocator.Allocate(indexCount);
+	if (baseVertex == FreeListAllocator::Invalid || firstIndex == FreeListAllocator::Invalid)
+	{
+		if (baseVertex != FreeListAllocator::Invalid)
+			pool.VertexAllocator.Free(baseVertex, vertexCount);
+		if (firstIndex != FreeListAllocator::Invalid)
+			pool.IndexAllocator.Free(firstIndex, indexCount);
+
+		Rebuild(index, vertexCount, indexCount);
+		baseVertex = pool.VertexAllocator.Allocate(vertexCount);
+		firstIndex = pool.IndexAllocator.Allocate(indexCount);
+	}
+
+	for (size_t i = 0; i < pool.Format.size(); i++)
+	{
+		const size_t stride = pool.Format[i].Stride;
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, pool.Vertices[i].Get());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, baseVertex * stride, vertexCount * stride, streams[i]);
+	}
+	GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, pool.Indices.Get());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+
+	return ranges.Create(Range{ index, baseVertex, vertexCount, firstIndex, indexCount });
+}
+
+void MeshArena::Free(GeometryHandle handle)
+{
+	const Range* range = ranges.Get(handle);
+	if (!range)
+		return;
+
+	pendingFrees.push_back(PendingFree{ *range, frame });
+	ranges.Destroy(handle);
+}
+
+void MeshArena::Update(uint64_t currentFrame, uint64_t completedFrames)
+{
+	frame = currentFrame;
+
+	size_t retired = 0;
+	for (; retired < pendingFrees.size() && pendingFrees[retired].Frame < completedFrames; retired++)
+	{
+		const Range& freed = pendingFrees[retired].Freed;
+		pools[freed.Pool].VertexAllocator.Free(freed.BaseVertex, freed.VertexCount);
+		pools[freed.Pool].IndexAllocator.Free(freed.FirstIndex, freed.IndexCount);
+	}
+	if (retired > 0)
+		pendingFrees.erase(pendingFrees.begin(), pendingFrees.begin() + retired);
+
+	for (uint32_t i = 0; i < pools.size(); i++)
+	{
+		if (ShouldCompact(pools[i]))
+		{
+			Rebuild(i, 0, 0);
+			compactions++;
+		}
+	}
+}
+
+void MeshArena::Compact()
+{
+	for (uint32_t i = 0; i < pools.size(); i++)
+		Rebuild(i, 0, 0);
+	compactions++;
+}
+
+void MeshArena::GetPoolStats(std::vector<PoolStats>& stats) const
+{
+	stats.assign(pools.size(), PoolStats{});
+	for (const Range& range : ranges)
+		stats[range.Pool].Meshes++;
+
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		const Pool& pool = pools[i];
+		PoolStats& poolStats = stats[i];
+		poolStats.Stride = GetVertexSize(pool.Format);
+		poolStats.VertexCapacity = pool.VertexAllocator.GetCapacity();
+		poolStats.VerticesUsed = pool.VertexAllocator.GetCapacity() - pool.VertexAllocator.GetFreeSize();
+		poolStats.IndexCapacity = pool.IndexAllocator.GetCapacity();
+		poolStats.IndicesUsed = pool.IndexAllocator.GetCapacity() - pool.IndexAllocator.GetFreeSize();
+		poolStats.Fragmentation = std::max(GetFragmentation(pool.VertexAllocator), GetFragmentation(pool.IndexAllocator));
+	}
+}
@@ -0,0 +1,188 @@
+#ifndef MESHARENA_H
+#define MESHARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "Interface/Buffers.h"
+#include "ResourcePool.h"
+
+// Best fit over [0, capacity), freed ranges merge with their free neighbours
+class FreeListAllocator
+{
+public:
+	static constexpr unsigned int Invalid = ~0u;
+
+private:
+	// Offset to size
+	std::map<unsigned int, unsigned int> freeRanges;
+	unsigned int capacity = 0;
+	unsigned int freeSize = 0;
+
+public:
+	FreeListAllocator() = default;
+	explicit FreeListAllocator(unsigned int capacity) { Reset(capacity, 0); }
+
+	// Invalid when no free range is large enough
+	unsigned int Allocate(unsigned int size);
+	void Free(unsigned int offset, unsigned int size);
+	// [0, used) is taken, the rest is one free range
+	void Reset(unsigned int capacity, unsigned int used);
+
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetFreeSize() const { return freeSize; }
+	unsigned int GetLargestFree() const;
+	size_t GetFreeRangeCount() const { return freeRanges.size(); }
+};
+
+struct GeometryTag;
+using GeometryHandle = ResourceHandle<GeometryTag>;
+
+// The vertex streams of a mesh, one interleaved buffer per layout. Positions get a
+// stream of their own so depth only passes fetch nothing else.
+using VertexFormat = std::vector<VertexLayout>;
+
+/*
+ * Vertices and indices of every mesh, kept in a few large buffers instead of
+ * buffers and a vertex array per mesh. Meshes with the same vertex format share a
+ * pool: a vertex buffer per stream, one index buffer and the vertex array reading
+ * them, so drawing different meshes of a pool binds nothing in between. A mesh is
+ * a range of vertices, the same in every stream, and a range of indices in its
+ * pool; its indices stay relative to the mesh and draws pass the first vertex as
+ * base vertex.
+ *
+ * Ranges come from a free list per buffer. Freed ranges are only handed out again
+ * once the frames that may still draw them have completed. The buffers are
+ * immutable where buffer storage is available and never resized: growing and
+ * compacting copy the live ranges to the front of new buffers on the GPU and the
+ * old ones go to the deletion queue, so frames in flight keep reading them.
+ *
+ * Main thread only. Ranges move when a pool is rebuilt, so look them up when
+ * recording draws instead of keeping them across frames.
+ */
+class MeshArena
+{
+public:
+	// Where a mesh's geometry lives, in vertices and indices of its pool
+	struct Range
+	{
+		uint32_t Pool;
+		unsigned int BaseVertex;
+		unsigned int VertexCount;
+		unsigned int FirstIndex;
+		unsigned int IndexCount;
+	};
+
+	struct PoolStats
+	{
+		// Bytes a vertex, all streams together
+		unsigned int Stride = 0;
+		unsigned int Meshes = 0;
+		unsigned int VertexCapacity = 0;
+		unsigned int VerticesUsed = 0;
+		unsigned int IndexCapacity = 0;
+		unsigned int IndicesUsed = 0;
+		// Share of the free space outside the largest free range, of the worse of the two buffers
+		float Fragmentation = 0.0f;
+	};
+
+	static constexpr unsigned int InitialVertexCapacity = 1u << 18;
+	static constexpr unsigned int InitialIndexCapacity = 1u << 20;
+	// Pools are compacted once this much of their free space is scattered in holes...
+	static constexpr float MaxFragmentation = 0.5f;
+	// ...and the free space is worth copying everything for
+	static constexpr float MinFreeToCompact = 0.25f;
+
+private:
+	struct Pool
+	{
+		VertexFormat Format;
+		VertexArray Array;
+		// One per stream of the format
+		std::vector<GLBuffer> Vertices;
+		GLBuffer Indices;
+		FreeListAllocator VertexAllocator;
+		FreeListAllocator IndexAllocator;
+	};
+
+	struct PendingFree
+	{
+		Range Freed;
+		uint64_t Frame;
+	};
+
+	std::vector<Pool> pools;
+	ResourcePool<Range, GeometryTag> ranges;
+	// In frame order
+	std::vector<PendingFree> pendingFrees;
+	uint64_t frame = 0;
+	unsigned int compactions = 0;
+
+	MeshArena() = default;
+
+	uint32_t FindPool(const VertexFormat& format);
+	// Moves the live ranges of the pool into new buffers with room for extra more
+	void Rebuild(uint32_t pool, unsigned int extraVertices, unsigned int extraIndices);
+	bool ShouldCompact(const Pool& pool) const;
+
+public:
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+
+	static MeshArena& Get();
+
+	// Copies the geometry into the pool of its format, one vertex pointer per stream,
+	// indices relative to the first vertex
+	GeometryHandle Allocate(const VertexFormat& format, const void* const* streams, unsigned int vertexCount,
+		const unsigned int* indices, unsigned int indexCount);
+	void Free(GeometryHandle handle);
+
+	// Null for freed handles
+	const Range* GetRange(GeometryHandle handle) const { return ranges.Get(handle); }
+	const VertexArray& GetVertexArray(uint32_t pool) const { return pools[pool].Array; }
+
+	// Hands out the ranges freed by completed frames again and compacts fragmented pools.
+	// Once per frame on the main thread, before anything is drawn.
+	void Update(uint64_t frame, uint64_t completedFrames);
+	// Compacts every pool right away
+	void Compact();
+
+	size_t GetPoolCount() const { return pools.size(); }
+	void GetPoolStats(std::vector<PoolStats>& stats) const;
+	unsigned int GetCompactionCount() const { return compactions; }
+};
+
+// Owns a mesh's geometry in the MeshArena, frees it when destroyed
+class MeshGeometry
+{
+private:
+	GeometryHandle handle;
+
+public:
+	MeshGeometry() = default;
+	explicit MeshGeometry(GeometryHandle handle) : handle(handle) {}
+	~MeshGeometry() { MeshArena::Get().Free(handle); }
+
+	MeshGeometry(const MeshGeometry&) = delete;
+	MeshGeometry& operator=(const MeshGeometry&) = delete;
+
+	MeshGeometry(MeshGeometry&& other) noexcept : handle(other.handle) { other.handle = GeometryHandle(); }
+	MeshGeometry& operator=(MeshGeometry&& other) noexcept
+	{
+		if (this != &other)
+		{
+			MeshArena::Get().Free(handle);
+			handle = other.handle;
+			other.handle = GeometryHandle();
+		}
+		return *this;
+	}
+
+	GeometryHandle Get() const { return handle; }
+	const MeshArena::Range* GetRange() const { return MeshArena::Get().GetRange(handle); }
+};
+
+
+#endif //MESHARENA_H
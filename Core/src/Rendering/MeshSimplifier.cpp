@@ -0,0 +1,356 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+
+namespace
+{
+	struct Quadric
+	{
+		// Symmetric A, b and c of  p'Ap + 2b'p + c, plus the area it was built from
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+		double Weight = 0.0;
+
+		static Quadric FromPlane(const glm::vec3& normal, float distance, float weight)
+		{
+			Quadric q;
+			q.A00 = weight * normal.x * normal.x;
+			q.A01 = weight * normal.x * normal.y;
+			q.A02 = weight * normal.x * normal.z;
+			q.A11 = weight * normal.y * normal.y;
+			q.A12 = weight * normal.y * normal.z;
+			q.A22 = weight * normal.z * normal.z;
+			q.B0 = weight * normal.x * distance;
+			q.B1 = weight * normal.y * distance;
+			q.B2 = weight * normal.z * distance;
+			q.C = weight * distance * distance;
+			q.Weight = weight;
+			return q;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A01 += q.A01; A02 += q.A02;
+			A11 += q.A11; A12 += q.A12; A22 += q.A22;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			Weight += q.Weight;
+		}
+
+		// Mean squared distance of p to the accumulated planes
+		double Evaluate(const glm::vec3& p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			const double rx = A00 * x + A01 * y + A02 * z;
+			const double ry = A01 * x + A11 * y + A12 * z;
+			const double rz = A02 * x + A12 * y + A22 * z;
+			const double error = x * rx + y * ry + z * rz + 2.0 * (B0 * x + B1 * y + B2 * z) + C;
+			return Weight > 0.0 ? std::abs(error) / Weight : 0.0;
+		}
+	};
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold,
+		Border,
+		Locked
+	};
+
+	struct PositionKey
+	{
+		uint32_t X, Y, Z;
+		bool operator==(const PositionKey& other) const { return X == other.X && Y == other.Y && Z == other.Z; }
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			return (key.X * 73856093u) ^ (key.Y * 19349663u) ^ (key.Z * 83492791u);
+		}
+	};
+
+	uint64_t EdgeKey(unsigned int a, unsigned int b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	// Border edges are weighted heavier than faces so outlines hold longer
+	constexpr float BorderWeight = 10.0f;
+	// Largest normal rotation a collapse may cause, as the cosine
+	constexpr float MaxRotationCos = 0.25f;
+}
+
+/*
+ * Collapses run in passes. Each pass rebuilds adjacency, finds the cheapest
+ * target per vertex and applies the cheapest third of them, locking the one ring
+ * of every collapsed vertex so collapses within a pass never interact.
+ */
+std::vector<unsigned int> MeshSimplifier::Simplify(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float maxError, float& error)
+{
+	error = 0.0f;
+	std::vector<unsigned int> result = indices;
+	const size_t vertexCount = positions.size();
+
+	// Vertices at the same position share one group, so seams can be told apart
+	std::vector<unsigned int> group(vertexCount);
+	std::vector<unsigned int> wedges(vertexCount, 0);
+	{
+		std::vector<uint8_t> used(vertexCount, 0);
+		for (unsigned int index : indices)
+			used[index] = 1;
+
+		std::unordered_map<PositionKey, unsigned int, PositionHash> firstAt;
+		firstAt.reserve(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			PositionKey key;
+			std::memcpy(&key, &positions[v], sizeof(PositionKey));
+			group[v] = firstAt.emplace(key, v).first->second;
+			if (used[v])
+				wedges[group[v]]++;
+		}
+	}
+
+	std::unordered_map<uint64_t, unsigned int> edgeCounts;
+	auto countEdges = [&]()
+	{
+		edgeCounts.clear();
+		edgeCounts.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+				edgeCounts[EdgeKey(group[result[i + e]], group[result[i + (e + 1) % 3]])]++;
+		}
+	};
+
+	auto edgeCount = [&](unsigned int a, unsigned int b)
+	{
+		auto it = edgeCounts.find(EdgeKey(group[a], group[b]));
+		return it == edgeCounts.end() ? 0u : it->second;
+	};
+
+	std::vector<Quadric> quadrics(vertexCount);
+	countEdges();
+	for (size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = positions[result[i]];
+		const glm::vec3& p1 = positions[result[i + 1]];
+		const glm::vec3& p2 = positions[result[i + 2]];
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+		normal /= length;
+
+		const Quadric face = Quadric::FromPlane(normal, -glm::dot(normal, p0), length * 0.5f);
+		for (int e = 0; e < 3; e++)
+			quadrics[group[result[i + e]]].Add(face);
+
+		for (int e = 0; e < 3; e++)
+		{
+			const unsigned int a = result[i + e];
+			const unsigned int b = result[i + (e + 1) % 3];
+			if (edgeCount(a, b) != 1)
+				continue;
+
+			const glm::vec3 edge = positions[b] - positions[a];
+			const glm::vec3 borderNormal = glm::cross(edge, normal);
+			const float borderLength = glm::length(borderNormal);
+			if (borderLength <= 0.0f)
+				continue;
+
+			const glm::vec3 planeNormal = borderNormal / borderLength;
+			const Quadric border = Quadric::FromPlane(planeNormal, -glm::dot(planeNormal, positions[a]), glm::dot(edge, edge) * BorderWeight);
+			quadrics[group[a]].Add(border);
+			quadrics[group[b]].Add(border);
+		}
+	}
+
+	std::vector<VertexKind> kinds(vertexCount);
+	std::vector<unsigned int> borderEdges(vertexCount);
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned int> bestTarget(vertexCount);
+	std::vector<float> bestCost(vertexCount);
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> collapse(vertexCount);
+	std::vector<uint8_t> passLocked(vertexCount);
+
+	const double maxCost = double(maxError) * double(maxError);
+
+	// A collapse must not fold any surviving triangle around the moved vertex
+	auto flips = [&](unsigned int v, unsigned int target)
+	{
+		for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+		{
+			const unsigned int* triangle = &result[adjacency[a] * 3];
+			if (triangle[0] == target || triangle[1] == target || triangle[2] == target)
+				continue;
+
+			glm::vec3 before[3], after[3];
+			for (int e = 0; e < 3; e++)
+			{
+				before[e] = positions[triangle[e]];
+				after[e] = triangle[e] == v ? positions[target] : before[e];
+			}
+
+			const glm::vec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+			const glm::vec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(oldNormal, newNormal) <= MaxRotationCos * glm::length(oldNormal) * glm::length(newNormal))
+				return true;
+		}
+		return false;
+	};
+
+	targetIndexCount -= targetIndexCount % 3;
+
+	while (result.size() > targetIndexCount)
+	{
+		const size_t triangleCount = result.size() / 3;
+
+		if (result.size() != indices.size())
+			countEdges();
+
+		std::fill(borderEdges.begin(), borderEdges.end(), 0);
+		std::fill(kinds.begin(), kinds.end(), VertexKind::Manifold);
+		for (const auto& edge : edgeCounts)
+		{
+			const unsigned int a = static_cast<unsigned int>(edge.first >> 32);
+			const unsigned int b = static_cast<unsigned int>(edge.first & 0xffffffffu);
+			if (edge.second == 1)
+			{
+				borderEdges[a]++;
+				borderEdges[b]++;
+			}
+			else if (edge.second > 2)
+			{
+				kinds[a] = VertexKind::Locked;
+				kinds[b] = VertexKind::Locked;
+			}
+		}
+		for (unsigned int g = 0; g < vertexCount; g++)
+		{
+			if (kinds[g] == VertexKind::Locked)
+				continue;
+			if (wedges[g] > 1)
+				kinds[g] = VertexKind::Locked;
+			else if (borderEdges[g] == 2)
+				kinds[g] = VertexKind::Border;
+			else if (borderEdges[g] != 0)
+				kinds[g] = VertexKind::Locked;
+		}
+
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (unsigned int index : result)
+			adjacencyOffsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		{
+			std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		std::fill(bestCost.begin(), bestCost.end(), std::numeric_limits<float>::max());
+		auto consider = [&](unsigned int v, unsigned int target)
+		{
+			const VertexKind kind = kinds[group[v]];
+			if (kind == VertexKind::Locked || group[v] == group[target])
+				return;
+			if (kind == VertexKind::Border && edgeCount(v, target) != 1)
+				return;
+
+			Quadric combined = quadrics[group[v]];
+			combined.Add(quadrics[group[target]]);
+			const float cost = static_cast<float>(combined.Evaluate(positions[target]));
+			if (cost < bestCost[v])
+			{
+				bestCost[v] = cost;
+				bestTarget[v] = target;
+			}
+		};
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				consider(result[i + e], result[i + (e + 1) % 3]);
+				consider(result[i + (e + 1) % 3], result[i + e]);
+			}
+		}
+
+		order.clear();
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			if (bestCost[v] <= maxCost)
+				order.push_back(v);
+		}
+		if (order.empty())
+			break;
+
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return bestCost[a] < bestCost[b]; });
+
+		for (unsigned int v = 0; v < vertexCount; v++)
+			collapse[v] = v;
+		std::fill(passLocked.begin(), passLocked.end(), 0);
+
+		const size_t needed = triangleCount - targetIndexCount / 3;
+		const size_t limit = std::max<size_t>(order.size() / 3, 1);
+		size_t removed = 0;
+		size_t collapsed = 0;
+
+		for (size_t i = 0; i < limit && removed < needed; i++)
+		{
+			const unsigned int v = order[i];
+			const unsigned int target = bestTarget[v];
+			if (passLocked[v] || passLocked[target] || flips(v, target))
+				continue;
+
+			collapse[v] = target;
+			passLocked[target] = 1;
+			for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+			{
+				const unsigned int* triangle = &result[adjacency[a] * 3];
+				for (int e = 0; e < 3; e++)
+					passLocked[triangle[e]] = 1;
+				if (triangle[0] == target || triangle[1] == target || triangle[2] == target)
+					removed++;
+			}
+
+			quadrics[group[target]].Add(quadrics[group[v]]);
+			error = std::max(error, bestCost[v]);
+			collapsed++;
+		}
+
+		if (collapsed == 0)
+			break;
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const unsigned int a = collapse[result[i]];
+			const unsigned int b = collapse[result[i + 1]];
+			const unsigned int c = collapse[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	error = std::sqrt(error);
+	return result;
+}
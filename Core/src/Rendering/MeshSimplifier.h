@@ -0,0 +1,28 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+ * Quadric error edge collapse over an indexed triangle list.
+ *
+ * Only the index list changes, vertices are never moved or created, so every
+ * level of a chain shares the mesh's vertex buffer. A vertex collapses onto one
+ * of its neighbours; the cost is the area weighted squared distance of the
+ * neighbour to the planes of both vertices' triangles.
+ *
+ * Vertices sharing a position with another vertex sit on a UV or normal seam and
+ * are never removed, neither are vertices of non manifold edges. Open borders
+ * only collapse along the border, so outlines keep their shape.
+ */
+struct MeshSimplifier
+{
+	// Returns at least targetIndexCount indices unless every collapse left is above
+	// maxError. error receives the largest collapse distance, in mesh units.
+	static std::vector<unsigned int> Simplify(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices,
+		size_t targetIndexCount, float maxError, float& error);
+};
+
+
+#endif //MESHSIMPLIFIER_H
@@ -3,17 +3,24 @@
 //
 
 #include "Model.h"
+#include "MeshSimplifier.h"
+#include "ResourceRegistry.h"
+#include "Interface/GpuMemory.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #define ASSIMP_LOAD_FLAGS (aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices | aiProcess_FixInfacingNormals)
 
 
-static VertexData ParseMesh(aiMesh* mesh, const aiScene* scene) {
+static VertexData ParseMesh(aiMesh* mesh, const aiScene* scene, AABB& bounds, BoundingSphere& sphere) {
 
     VertexData vertexData;
 
@@ -38,36 +45,156 @@ static VertexData ParseMesh(aiMesh* mesh, const aiScene* scene) {
 
     }
 
+    bounds = AABB::FromPoints(vertexData.Positions);
+    sphere = BoundingSphere::FromPoints(vertexData.Positions);
+
     return vertexData;
 }
 
-static Mesh GenerateMesh(VertexData& data, Material material, const std::string& name)
+/*
+ * Every level is simplified from the previous one to half its triangles. The chain
+ * stops once a level no longer gets meaningfully smaller, which happens when the
+ * rest of the mesh is seams and borders.
+ *
+ * The simplifier only measures a level against the one it was made from, so the
+ * errors of the steps add up to a bound on the deviation from the full mesh. The
+ * whole chain shares one error budget, every step gets what the previous left.
+ */
+static std::vector<MeshLod> GenerateLods(VertexData& data, const BoundingSphere& sphere, std::vector<unsigned int>& indices)
+{
+    std::vector<MeshLod> lods;
+    lods.push_back(MeshLod{0, static_cast<unsigned int>(data.Indices.size()), 0.0f});
+    indices = data.Indices;
+
+    std::vector<unsigned int> current = data.Indices;
+    const float maxError = sphere.Radius * 0.25f;
+    float totalError = 0.0f;
+
+    while (lods.size() < Model::MaxLodCount && current.size() / 3 > Model::MinLodTriangles && totalError < maxError)
+    {
+        float error = 0.0f;
+        std::vector<unsigned int> simplified = MeshSimplifier::Simplify(data.Positions, current, current.size() / 2, maxError - totalError, error);
+        if (simplified.empty() || simplified.size() > current.size() * 85 / 100)
+            break;
+
+        totalError += error;
+        lods.push_back(MeshLod{static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(simplified.size()), totalError});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        current = std::move(simplified);
+    }
+
+    return lods;
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+static glm::vec2 EncodeOctahedral(const glm::vec3& n)
+{
+    glm::vec2 p = glm::vec2(n.x, n.y) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    if (n.z < 0.0f)
+    {
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return p;
+}
+
+// Two vertex streams: positions alone, so depth only passes fetch nothing else, and the
+// octahedral normal interleaved with the half float uv.
+// Quantized positions are 16 bit fractions of the bounds, decode maps them back.
+static VertexFormat EncodeVertices(const VertexData& data, const AABB& bounds,
+    std::vector<uint8_t>& positions, std::vector<uint8_t>& attributes, glm::mat4& decode)
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+    unsigned int positionSize = 3 * sizeof(float);
+    if (Model::QuantizePositions)
+    {
+        // Flat meshes still get a usable scale on their thin axes
+        const glm::vec3 size = bounds.Max - bounds.Min;
+        const float minSize = std::max(std::max(size.x, std::max(size.y, size.z)) / 16.0f, 1e-4f);
+        scale = glm::max(size, glm::vec3(minSize));
+        origin = bounds.GetCenter() - scale * 0.5f;
+        positionSize = 4 * sizeof(uint16_t);
+        decode = glm::scale(glm::translate(glm::mat4(1.0f), origin), scale);
+    }
+
+    const unsigned int attributeSize = 2 * sizeof(uint32_t);
+    VertexFormat format(2);
+    format[0].Stride = positionSize;
+    format[0].Attributes = {
+        { Coordinates, 3, Model::QuantizePositions ? GL_UNSIGNED_SHORT : GL_FLOAT, Model::QuantizePositions, 0 }
+    };
+    format[1].Stride = attributeSize;
+    format[1].Attributes = {
+        { NormalCoords, 2, GL_SHORT, true, 0 },
+        { TexCoords, 2, GL_HALF_FLOAT, false, static_cast<unsigned int>(sizeof(uint32_t)) }
+    };
+
+    positions.resize(data.Positions.size() * positionSize);
+    attributes.resize(data.Positions.size() * attributeSize);
+    for (size_t i = 0; i < data.Positions.size(); i++)
+    {
+        uint8_t* position = positions.data() + i * positionSize;
+        if (Model::QuantizePositions)
+        {
+            const glm::vec3 q = (data.Positions[i] - origin) / scale;
+            const uint64_t packedPosition = glm::packUnorm4x16(glm::vec4(q, 0.0f));
+            std::memcpy(position, &packedPosition, positionSize);
+        }
+        else
+        {
+            std::memcpy(position, &data.Positions[i], positionSize);
+        }
+
+        // Normals transform with the inverse transpose, so the decode scale is folded in here
+        glm::vec3 normal = data.Normals[i] * scale;
+        const float length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        const uint32_t packedNormal = glm::packSnorm2x16(EncodeOctahedral(normal));
+        const uint32_t packedUV = glm::packHalf2x16(data.TexCoords[i]);
+        uint8_t* attribute = attributes.data() + i * attributeSize;
+        std::memcpy(attribute, &packedNormal, sizeof(uint32_t));
+        std::memcpy(attribute + sizeof(uint32_t), &packedUV, sizeof(uint32_t));
+    }
+    return format;
+}
+
+static Mesh GenerateMesh(VertexData& data, const std::string& name, const AABB& bounds, const BoundingSphere& sphere)
 {
-    VertexArray vertexArray;
-    VertexBuffer positionBuffer = VertexBuffer(data.Positions.data(), data.Positions.size()* sizeof(glm::vec3));
-    VertexBuffer normalsBuffer = VertexBuffer(data.Normals.data(), data.Normals.size()* sizeof(glm::vec3));
-    VertexBuffer uvBuffer = VertexBuffer(data.TexCoords.data(), data.TexCoords.size()* sizeof(glm::vec3));
+    std::vector<uint8_t> positions;
+    std::vector<uint8_t> attributes;
+    glm::mat4 positionDecode = glm::mat4(1.0f);
+    const VertexFormat format = EncodeVertices(data, bounds, positions, attributes, positionDecode);
+
+    std::vector<unsigned int> lodIndices;
+    std::vector<MeshLod> lods = GenerateLods(data, sphere, lodIndices);
 
-    IndexBuffer indexBuffer(data.Indices.data(), data.Indices.size());
+    const void* streams[] = { positions.data(), attributes.data() };
+    MeshGeometry geometry(MeshArena::Get().Allocate(format, streams, static_cast<unsigned int>(data.Positions.size()),
+        lodIndices.data(), static_cast<unsigned int>(lodIndices.size())));
 
-    vertexArray.Bind();
-    vertexArray.AddBuffer(positionBuffer, Coordinates, 3);
-    vertexArray.AddBuffer(normalsBuffer, NormalCoords, 3);
-    vertexArray.AddBuffer(uvBuffer, TexCoords, 2);
+    std::shared_ptr<OccluderGeometry> occluder;
+    if (data.Indices.size() / 3 <= Model::MaxOccluderTriangles)
+    {
+        occluder = std::make_shared<OccluderGeometry>();
+        occluder->Positions = data.Positions;
+        occluder->Indices = data.Indices;
+    }
 
-    return Mesh{vertexArray, indexBuffer, material, name};
+    return Mesh{std::move(geometry), name, bounds, sphere, occluder, std::move(lods), positionDecode};
 }
 
 
-static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& meshes)
+static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<MeshHandle>& meshes)
 {
 
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        VertexData vertexData = ParseMesh(mesh, scene);
+        AABB bounds;
+        BoundingSphere sphere;
+        VertexData vertexData = ParseMesh(mesh, scene, bounds, sphere);
 
-        meshes.push_back(GenerateMesh(vertexData, Material{}, mesh->mName.C_Str()));
+        meshes.push_back(ResourceRegistry::Get().AddMesh(GenerateMesh(vertexData, mesh->mName.C_Str(), bounds, sphere)));
     }
 
     //children nodes
@@ -81,9 +208,16 @@ static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& m
 
 void Model::LoadFromFile(const std::string& fileName)
 {
+    ResourceRegistry& registry = ResourceRegistry::Get();
+    entry.reset();
+
+    // Every file is only imported and uploaded once while some Model uses it
+    if ((entry = registry.FindModel(fileName)))
+        return;
+
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(fileName,
-        aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
+        aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -91,10 +225,44 @@ void Model::LoadFromFile(const std::string& fileName)
         return;
     }
 
-    name = scene->mRootNode->mName.C_Str();
+    ModelEntry loaded;
+    loaded.Name = scene->mRootNode->mName.C_Str();
+
+    // Recursively process each node in the scene, the buffers are accounted to the file
+    GpuMemoryScope memoryScope(fileName);
+    ProcessNode(scene->mRootNode, scene, loaded.Meshes);
+
+    for (size_t i = 0; i < loaded.Meshes.size(); i++)
+    {
+        const AABB& meshBounds = registry.GetMesh(loaded.Meshes[i])->bounds;
+        loaded.Bounds = i == 0 ? meshBounds : AABB::Merge(loaded.Bounds, meshBounds);
+    }
 
-    // Recursively process each node in the scene
-    ProcessNode(scene->mRootNode, scene, meshes);
+    entry = registry.AddModel(fileName, std::move(loaded));
+}
+
+const std::vector<MeshHandle>& Model::GetMeshes() const
+{
+    static const std::vector<MeshHandle> none;
+    return entry ? entry->Meshes : none;
+}
+
+const AABB& Model::GetBounds() const
+{
+    static const AABB none;
+    return entry ? entry->Bounds : none;
+}
+
+bool Model::HasOccluderGeometry() const
+{
+    const ResourceRegistry& registry = ResourceRegistry::Get();
+    for (MeshHandle handle : GetMeshes())
+    {
+        const Mesh* mesh = registry.GetMesh(handle);
+        if (mesh && mesh->occluder)
+            return true;
+    }
+    return false;
 }
 
 
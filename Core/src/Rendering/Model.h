@@ -8,24 +8,71 @@
 #include "Interface/Abstractions.h"
 #include "Camera.h"
 #include <vector>
+#include <memory>
 
-#include "Material.h"
+#include "ResourcePool.h"
+#include "Bounds.h"
+#include "MeshArena.h"
+#include "OcclusionCuller.h"
 
 
+// Range of the mesh indices drawn at one level of detail
+struct MeshLod
+{
+    unsigned int FirstIndex;
+    unsigned int IndexCount;
+    // Upper bound of the deviation from the full mesh, object space: the errors of
+    // every simplification step up to this level added together
+    float Error;
+};
+
 struct Mesh
 {
-    VertexArray vertexArray;
-    IndexBuffer indexBuffer;
-    Material material;
+    // Vertices and indices in the MeshArena, shared buffers and vertex array with
+    // every mesh of the same vertex format
+    MeshGeometry geometry;
     std::string name;
+
+    // Object space
+    AABB bounds;
+    BoundingSphere sphere;
+
+    // CPU copy for the occlusion culler, only kept for low poly meshes
+    std::shared_ptr<const OccluderGeometry> occluder;
+
+    // Level 0 is the full mesh, every level after it has about half the triangles.
+    // All of them live in the geometry's indices back to back.
+    std::vector<MeshLod> lods;
+
+    // Maps the stored positions to object space. Quantized positions are [0, 1] of
+    // the bounds, so this goes into the model matrix of every draw of the mesh.
+    glm::mat4 positionDecode = glm::mat4(1.0f);
+};
+
+// What a model file turned into. The ResourceRegistry destroys the meshes once
+// the last Model holding the entry lets go of it.
+struct ModelEntry
+{
+    std::string Name;
+    std::vector<MeshHandle> Meshes;
+    AABB Bounds;
 };
 
+// Entity component, the meshes live in the ResourceRegistry and are shared by
+// every Model loaded from the same file
 class Model {
 private:
-    std::vector<Mesh> meshes;
-    std::string name;
+    std::shared_ptr<const ModelEntry> entry;
     std::string filename;
 public:
+    // Meshes above this are too expensive to rasterize on the CPU every frame
+    static constexpr size_t MaxOccluderTriangles = 2048;
+    static constexpr size_t MaxLodCount = 6;
+    // Meshes this small are not worth simplifying further
+    static constexpr size_t MinLodTriangles = 128;
+    // 16 bit positions relative to the mesh bounds instead of floats, 8 instead of 12 bytes a position
+    static constexpr bool QuantizePositions = true;
+
     Model() = default;
     Model(const std::string& fileName) : filename(fileName){
         LoadFromFile(fileName);
@@ -34,9 +81,12 @@ public:
 
     void LoadFromFile(const std::string& fileName);
 
-    std::string GetName() const { return name; }
+    std::string GetName() const { return entry ? entry->Name : std::string(); }
     std::string GetFileName() const { return filename; }
-    const std::vector<Mesh>& GetMeshes() const { return meshes; }
+    const std::vector<MeshHandle>& GetMeshes() const;
+    // Union of the mesh bounds, object space
+    const AABB& GetBounds() const;
+    bool HasOccluderGeometry() const;
 };
 
 
@@ -0,0 +1,307 @@
+#include "OcclusionCuller.h"
+#include "System/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+OcclusionCuller::OcclusionCuller(JobSystem* jobs)
+	: jobs(jobs), depth(Width * Height, 1.0f), tileDepth(TilesX * TilesY, 1.0f)
+{
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	occluders.clear();
+	triangleCount = 0;
+}
+
+void OcclusionCuller::AddOccluder(const OccluderGeometry& geometry, const glm::mat4& model)
+{
+	occluders.push_back(Occluder{ &geometry, model });
+}
+
+static glm::vec3 ToScreen(const glm::vec4& clip)
+{
+	const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+	return glm::vec3((ndc.x * 0.5f + 0.5f) * OcclusionCuller::Width,
+		(ndc.y * 0.5f + 0.5f) * OcclusionCuller::Height,
+		ndc.z * 0.5f + 0.5f);
+}
+
+// Sutherland-Hodgman against the near plane (z >= -w), a triangle becomes at most a quad
+static int ClipNear(const glm::vec4 input[3], glm::vec4 output[4])
+{
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& a = input[i];
+		const glm::vec4& b = input[(i + 1) % 3];
+		const float da = a.z + a.w;
+		const float db = b.z + b.w;
+
+		if (da >= 0.0f)
+			output[count++] = a;
+		if ((da >= 0.0f) != (db >= 0.0f))
+			output[count++] = a + (b - a) * (da / (da - db));
+	}
+	return count;
+}
+
+void OcclusionCuller::SetupOccluder(size_t index)
+{
+	const Occluder& occluder = occluders[index];
+	const OccluderGeometry& geometry = *occluder.Geometry;
+	std::vector<ScreenTriangle>& triangles = occluderTriangles[index];
+	triangles.clear();
+
+	const glm::mat4 transform = viewProjection * occluder.Model;
+
+	for (size_t i = 0; i + 2 < geometry.Indices.size(); i += 3)
+	{
+		glm::vec4 clip[3];
+		for (int v = 0; v < 3; v++)
+			clip[v] = transform * glm::vec4(geometry.Positions[geometry.Indices[i + v]], 1.0f);
+
+		// Entirely outside one side of the frustum
+		bool rejected = false;
+		for (int axis = 0; axis < 3 && !rejected; axis++)
+		{
+			rejected = (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w)
+				|| (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w);
+		}
+		if (rejected)
+			continue;
+
+		glm::vec4 polygon[4];
+		const int count = ClipNear(clip, polygon);
+
+		for (int fan = 1; fan + 1 < count; fan++)
+		{
+			ScreenTriangle triangle;
+			triangle.V[0] = ToScreen(polygon[0]);
+			triangle.V[1] = ToScreen(polygon[fan]);
+			triangle.V[2] = ToScreen(polygon[fan + 1]);
+
+			const glm::vec3 e1 = triangle.V[1] - triangle.V[0];
+			const glm::vec3 e2 = triangle.V[2] - triangle.V[0];
+			const float area = e1.x * e2.y - e1.y * e2.x;
+			if (std::abs(area) < 1e-6f)
+				continue;
+
+			// Both windings are rasterized, normalize to counter clockwise
+			if (area < 0.0f)
+				std::swap(triangle.V[1], triangle.V[2]);
+
+			triangle.MinY = std::min({ triangle.V[0].y, triangle.V[1].y, triangle.V[2].y });
+			triangle.MaxY = std::max({ triangle.V[0].y, triangle.V[1].y, triangle.V[2].y });
+			triangles.push_back(triangle);
+		}
+	}
+}
+
+/*
+ * Half-space rasterization at pixel centers. Edge functions and depth are planes
+ * in screen space, so a row is walked by adding constant steps, four pixels per
+ * step with SSE.
+ */
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, int firstRow, int lastRow)
+{
+	const glm::vec3& v0 = triangle.V[0];
+	const glm::vec3& v1 = triangle.V[1];
+	const glm::vec3& v2 = triangle.V[2];
+
+	const int minX = std::max(0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+	const int maxX = std::min(Width - 1, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+	const int minY = std::max(firstRow, static_cast<int>(std::floor(triangle.MinY)));
+	const int maxY = std::min(lastRow - 1, static_cast<int>(std::ceil(triangle.MaxY)));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// E(x, y) = A * x + B * y + C, positive inside for counter clockwise triangles
+	const float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v2.x * v1.y;
+	const float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v0.x * v2.y;
+	const float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v1.x * v0.y;
+
+	const float area = a0 * v0.x + b0 * v0.y + c0;
+	const float inverseArea = 1.0f / area;
+
+	// z = zA * x + zB * y + zC, from the barycentric weights E0/area, E1/area, E2/area
+	const float zA = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * inverseArea;
+	const float zB = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * inverseArea;
+	const float zC = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * inverseArea;
+
+	const int startX = minX & ~3;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		const float py = static_cast<float>(y) + 0.5f;
+		float* row = &depth[y * Width];
+
+#if defined(OCCLUSION_SSE)
+		const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (int x = startX; x <= maxX; x += 4)
+		{
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+			const __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+			const __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+			const __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), _mm_set1_ps(zB * py + zC));
+			const __m128 current = _mm_loadu_ps(row + x);
+			const __m128 nearest = _mm_min_ps(current, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+		}
+#else
+		for (int x = startX; x <= maxX; x++)
+		{
+			const float px = static_cast<float>(x) + 0.5f;
+			if (a0 * px + b0 * py + c0 < 0.0f || a1 * px + b1 * py + c1 < 0.0f || a2 * px + b2 * py + c2 < 0.0f)
+				continue;
+
+			const float z = zA * px + zB * py + zC;
+			row[x] = std::min(row[x], z);
+		}
+#endif
+	}
+}
+
+void OcclusionCuller::RasterizeBand(int firstRow, int lastRow)
+{
+	std::fill(depth.begin() + firstRow * Width, depth.begin() + lastRow * Width, 1.0f);
+
+	for (const std::vector<ScreenTriangle>& triangles : occluderTriangles)
+	{
+		for (const ScreenTriangle& triangle : triangles)
+		{
+			if (triangle.MaxY < static_cast<float>(firstRow) || triangle.MinY >= static_cast<float>(lastRow))
+				continue;
+			RasterizeTriangle(triangle, firstRow, lastRow);
+		}
+	}
+
+	for (int tileY = firstRow / TileSize; tileY < lastRow / TileSize; tileY++)
+	{
+		for (int tileX = 0; tileX < TilesX; tileX++)
+		{
+			float farthest = 0.0f;
+			for (int y = tileY * TileSize; y < (tileY + 1) * TileSize; y++)
+			{
+				const float* row = &depth[y * Width + tileX * TileSize];
+				for (int x = 0; x < TileSize; x++)
+					farthest = std::max(farthest, row[x]);
+			}
+			tileDepth[tileY * TilesX + tileX] = farthest;
+		}
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	occluderTriangles.resize(std::max(occluderTriangles.size(), occluders.size()));
+
+	auto setup = [this](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			SetupOccluder(i);
+	};
+
+	auto raster = [this](size_t begin, size_t end)
+	{
+		for (size_t band = begin; band < end; band++)
+			RasterizeBand(static_cast<int>(band) * BandHeight, static_cast<int>(band + 1) * BandHeight);
+	};
+
+	// Occluders beyond this frame's count keep stale triangles, drop them
+	for (size_t i = occluders.size(); i < occluderTriangles.size(); i++)
+		occluderTriangles[i].clear();
+
+	const size_t bands = Height / BandHeight;
+	if (jobs)
+	{
+		jobs->ParallelFor(occluders.size(), 1, setup);
+		jobs->ParallelFor(bands, 1, raster);
+	}
+	else
+	{
+		setup(0, occluders.size());
+		raster(0, bands);
+	}
+
+	for (size_t i = 0; i < occluders.size(); i++)
+		triangleCount += occluderTriangles[i].size();
+}
+
+bool OcclusionCuller::IsVisible(const AABB& bounds) const
+{
+	float minX = static_cast<float>(Width), minY = static_cast<float>(Height), nearest = 1.0f;
+	float maxX = 0.0f, maxY = 0.0f;
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		const glm::vec3 point((corner & 1) ? bounds.Max.x : bounds.Min.x,
+			(corner & 2) ? bounds.Max.y : bounds.Min.y,
+			(corner & 4) ? bounds.Max.z : bounds.Min.z);
+
+		const glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+
+		// Crossing the near plane, assume it covers the view
+		if (clip.z < -clip.w || clip.w <= 0.0f)
+			return true;
+
+		const glm::vec3 screen = ToScreen(clip);
+		minX = std::min(minX, screen.x);
+		maxX = std::max(maxX, screen.x);
+		minY = std::min(minY, screen.y);
+		maxY = std::max(maxY, screen.y);
+		nearest = std::min(nearest, screen.z);
+	}
+
+	// Off screen is the frustum culler's call
+	if (maxX < 0.0f || maxY < 0.0f || minX >= Width || minY >= Height)
+		return true;
+
+	const int firstTileX = std::max(0, static_cast<int>(minX) / TileSize);
+	const int lastTileX = std::min(TilesX - 1, static_cast<int>(maxX) / TileSize);
+	const int firstTileY = std::max(0, static_cast<int>(minY) / TileSize);
+	const int lastTileY = std::min(TilesY - 1, static_cast<int>(maxY) / TileSize);
+
+	for (int y = firstTileY; y <= lastTileY; y++)
+	{
+		for (int x = firstTileX; x <= lastTileX; x++)
+		{
+			if (nearest <= tileDepth[y * TilesX + x])
+				return true;
+		}
+	}
+	return false;
+}
+
+void OcclusionCuller::TestVisibility(const std::vector<AABB>& bounds, std::vector<uint8_t>& visible) const
+{
+	visible.resize(bounds.size());
+
+	auto test = [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			visible[i] = IsVisible(bounds[i]) ? 1 : 0;
+	};
+
+	if (jobs)
+		jobs->ParallelFor(bounds.size(), 256, test);
+	else
+		test(0, bounds.size());
+}
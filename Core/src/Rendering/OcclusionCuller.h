@@ -0,0 +1,86 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+class JobSystem;
+
+// CPU copy of a mesh kept around for rasterizing it as an occluder
+struct OccluderGeometry
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<unsigned int> Indices;
+};
+
+/*
+ * Software occlusion culling, CPU only.
+ *
+ * Occluders are transformed and clipped against the near plane per occluder, then
+ * rasterized into a small depth buffer in horizontal bands, one band per job, four
+ * pixels at a time with SSE. Every 8x8 tile keeps the farthest depth written in
+ * it. An occludee is hidden when the nearest point of its box is behind the
+ * farthest occluder depth in every tile its screen rectangle touches.
+ *
+ * Depth is NDC z remapped to [0, 1], which interpolates linearly in screen space.
+ */
+class OcclusionCuller
+{
+public:
+	static constexpr int Width = 320;
+	static constexpr int Height = 192;
+	static constexpr int TileSize = 8;
+	static constexpr int TilesX = Width / TileSize;
+	static constexpr int TilesY = Height / TileSize;
+	// Rows per rasterization job, a multiple of the tile size
+	static constexpr int BandHeight = 16;
+
+private:
+	struct ScreenTriangle
+	{
+		glm::vec3 V[3]; // pixels, depth
+		float MinY, MaxY;
+	};
+
+	struct Occluder
+	{
+		const OccluderGeometry* Geometry;
+		glm::mat4 Model;
+	};
+
+	JobSystem* jobs;
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+
+	std::vector<Occluder> occluders;
+	std::vector<std::vector<ScreenTriangle>> occluderTriangles;
+	std::vector<float> depth;
+	std::vector<float> tileDepth;
+	size_t triangleCount = 0;
+
+	void SetupOccluder(size_t index);
+	void RasterizeBand(int firstRow, int lastRow);
+	void RasterizeTriangle(const ScreenTriangle& triangle, int firstRow, int lastRow);
+
+public:
+	explicit OcclusionCuller(JobSystem* jobs = nullptr);
+	~OcclusionCuller() = default;
+
+	void Begin(const glm::mat4& viewProjection);
+	// The geometry has to stay alive until Rasterize returns
+	void AddOccluder(const OccluderGeometry& geometry, const glm::mat4& model);
+	void Rasterize();
+
+	bool IsVisible(const AABB& bounds) const;
+	void TestVisibility(const std::vector<AABB>& bounds, std::vector<uint8_t>& visible) const;
+
+	size_t GetOccluderCount() const { return occluders.size(); }
+	size_t GetTriangleCount() const { return triangleCount; }
+	const std::vector<float>& GetDepthBuffer() const { return depth; }
+	float GetTileDepth(int x, int y) const { return tileDepth[y * TilesX + x]; }
+};
+
+
+#endif //OCCLUSIONCULLER_H
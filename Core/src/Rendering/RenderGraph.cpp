@@ -0,0 +1,602 @@
+#include "RenderGraph.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+#include "Interface/GLStateCache.h"
+#include "Interface/GpuMemory.h"
+#include "GpuProfiler.h"
+
+
+void RenderGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+	compiled = false;
+	frame++;
+}
+
+RenderGraphResource RenderGraph::AddResource(Resource resource)
+{
+	resources.push_back(std::move(resource));
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportTexture(const std::string& name, unsigned int texture, const RenderGraphTextureDesc& desc)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Type = ResourceType::Texture;
+	resource.Desc = desc;
+	resource.Imported = true;
+	resource.Id = texture;
+	resource.Viewport = glm::ivec4(0, 0, desc.Width, desc.Height);
+	return AddResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::ImportFramebuffer(const std::string& name, unsigned int framebuffer, const glm::ivec4& viewport)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Type = ResourceType::Framebuffer;
+	resource.Desc = RenderGraphTextureDesc{ viewport.z, viewport.w, FrameBufferFormat::None };
+	resource.Imported = true;
+	resource.Id = framebuffer;
+	resource.Viewport = viewport;
+	return AddResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::ImportBuffer(const std::string& name, unsigned int buffer)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Type = ResourceType::Buffer;
+	resource.Imported = true;
+	resource.Id = buffer;
+	return AddResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::Builder::Create(const std::string& name, const RenderGraphTextureDesc& desc)
+{
+	Resource resource;
+	resource.Name = name;
+	resource.Type = ResourceType::Texture;
+	resource.Desc = desc;
+	resource.Viewport = glm::ivec4(0, 0, desc.Width, desc.Height);
+	return graph.AddResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::Builder::Read(RenderGraphResource resource)
+{
+	graph.passes[pass].Reads.push_back(resource);
+	return resource;
+}
+
+RenderGraphResource RenderGraph::Builder::Write(RenderGraphResource resource, LoadOp load, const glm::vec4& clearColor)
+{
+	graph.passes[pass].Writes.push_back(Attachment{ resource, load, clearColor });
+	return resource;
+}
+
+void RenderGraph::Builder::SetSideEffect()
+{
+	graph.passes[pass].SideEffect = true;
+}
+
+unsigned int RenderGraph::Context::GetTexture(RenderGraphResource resource) const
+{
+	const Resource& entry = graph.resources[resource];
+	if (entry.Imported)
+		return entry.Id;
+	return entry.PoolIndex >= 0 ? graph.pool[entry.PoolIndex].Texture.Get() : 0;
+}
+
+const RenderGraphTextureDesc& RenderGraph::Context::GetDesc(RenderGraphResource resource) const
+{
+	return graph.resources[resource].Desc;
+}
+
+void RenderGraph::AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = execute;
+	passes.push_back(std::move(pass));
+
+	Builder builder(*this, static_cast<uint32_t>(passes.size() - 1));
+	setup(builder);
+	compiled = false;
+}
+
+void RenderGraph::AddBlitPass(const std::string& name, RenderGraphResource src, RenderGraphResource dst)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Blit = true;
+	pass.Reads.push_back(src);
+	pass.Writes.push_back(Attachment{ dst, LoadOp::DontCare, glm::vec4(0.0f) });
+	passes.push_back(std::move(pass));
+	compiled = false;
+}
+
+/*
+ * Sampling a texture that is attached to the framebuffer being drawn is undefined,
+ * so such a read goes to a copy made right before the pass instead.
+ */
+void RenderGraph::InsertFeedbackCopies()
+{
+	std::vector<Pass> ordered;
+	ordered.reserve(passes.size());
+
+	for (Pass& pass : passes)
+	{
+		for (RenderGraphResource& read : pass.Reads)
+		{
+			if (pass.Blit || resources[read].Type != ResourceType::Texture)
+				continue;
+
+			const bool written = std::any_of(pass.Writes.begin(), pass.Writes.end(),
+				[read](const Attachment& write) { return write.Resource == read; });
+			if (!written)
+				continue;
+
+			Resource copy;
+			copy.Name = resources[read].Name + "Copy";
+			copy.Type = ResourceType::Texture;
+			copy.Desc = resources[read].Desc;
+			copy.Viewport = glm::ivec4(0, 0, copy.Desc.Width, copy.Desc.Height);
+			const RenderGraphResource copyId = AddResource(std::move(copy));
+
+			Pass blit;
+			blit.Name = "Copy " + resources[read].Name;
+			blit.Blit = true;
+			blit.Reads.push_back(read);
+			blit.Writes.push_back(Attachment{ copyId, LoadOp::DontCare, glm::vec4(0.0f) });
+			ordered.push_back(std::move(blit));
+
+			read = copyId;
+		}
+
+		ordered.push_back(std::move(pass));
+	}
+
+	passes = std::move(ordered);
+}
+
+/*
+ * Every pass holds one reference per resource it writes, every resource one per
+ * pass reading it. Imported resources are read by whoever owns them. Resources
+ * nobody reads release their writers, and a writer left without references is
+ * culled and releases what it read in turn.
+ */
+void RenderGraph::CullPasses()
+{
+	std::vector<std::vector<uint32_t>> writers(resources.size());
+	std::vector<RenderGraphResource> unread;
+
+	for (Resource& resource : resources)
+		resource.Readers = resource.Imported ? 1 : 0;
+
+	for (uint32_t i = 0; i < passes.size(); i++)
+	{
+		Pass& pass = passes[i];
+		pass.Culled = false;
+		pass.References = static_cast<unsigned int>(pass.Writes.size()) + (pass.SideEffect ? 1 : 0);
+
+		for (RenderGraphResource read : pass.Reads)
+			resources[read].Readers++;
+		for (const Attachment& write : pass.Writes)
+			writers[write.Resource].push_back(i);
+	}
+
+	auto cull = [&](Pass& pass)
+	{
+		pass.Culled = true;
+		for (RenderGraphResource read : pass.Reads)
+		{
+			if (--resources[read].Readers == 0)
+				unread.push_back(read);
+		}
+	};
+
+	// Seed before culling anything, cull only pushes resources on their transition to zero
+	for (RenderGraphResource i = 0; i < resources.size(); i++)
+	{
+		if (resources[i].Readers == 0)
+			unread.push_back(i);
+	}
+
+	for (Pass& pass : passes)
+	{
+		if (pass.References == 0)
+			cull(pass);
+	}
+
+	while (!unread.empty())
+	{
+		const RenderGraphResource resource = unread.back();
+		unread.pop_back();
+
+		for (uint32_t writer : writers[resource])
+		{
+			Pass& pass = passes[writer];
+			if (!pass.Culled && --pass.References == 0)
+				cull(pass);
+		}
+	}
+}
+
+int RenderGraph::AcquireTexture(const RenderGraphTextureDesc& desc)
+{
+	for (size_t i = 0; i < pool.size(); i++)
+	{
+		if (!pool[i].InUse && pool[i].Desc == desc)
+		{
+			pool[i].InUse = true;
+			pool[i].LastUsedFrame = frame;
+			return static_cast<int>(i);
+		}
+	}
+
+	PooledTexture texture;
+	texture.Desc = desc;
+	texture.InUse = true;
+	texture.LastUsedFrame = frame;
+
+	const AttachmentFormat format = GetAttachmentFormat(desc.Format);
+	const int filter = IsDepthFormat(desc.Format) ? GL_NEAREST : GL_LINEAR;
+	texture.Texture = GLTexture::Create();
+	GLStateCache::BindTexture(0, GL_TEXTURE_2D, texture.Texture.Get());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, format.InternalFormat, desc.Width, desc.Height, 0, format.Format, format.Type, nullptr);
+
+	const size_t bytes = static_cast<size_t>(desc.Width) * desc.Height * GetFormatSize(desc.Format);
+	GpuMemory::Track(GpuMemoryCategory::RenderTarget, GLObjectType::Texture, texture.Texture.Get(), bytes, "Render Graph");
+
+	pool.push_back(std::move(texture));
+	return static_cast<int>(pool.size() - 1);
+}
+
+/*
+ * Walks the live passes in order, a transient gets a pool texture at its first
+ * pass and gives it back after its last one, where the next transient with the
+ * same size and format picks it up.
+ */
+void RenderGraph::AssignTextures()
+{
+	for (Resource& resource : resources)
+	{
+		resource.FirstPass = -1;
+		resource.LastPass = -1;
+		resource.PoolIndex = -1;
+	}
+
+	auto touch = [this](RenderGraphResource resource, int pass)
+	{
+		Resource& entry = resources[resource];
+		if (entry.FirstPass < 0)
+			entry.FirstPass = pass;
+		entry.LastPass = pass;
+	};
+
+	for (int i = 0; i < static_cast<int>(passes.size()); i++)
+	{
+		if (passes[i].Culled)
+			continue;
+		for (RenderGraphResource read : passes[i].Reads)
+			touch(read, i);
+		for (const Attachment& write : passes[i].Writes)
+			touch(write.Resource, i);
+	}
+
+	for (PooledTexture& texture : pool)
+		texture.InUse = false;
+
+	std::vector<bool> written(resources.size(), false);
+	for (int i = 0; i < static_cast<int>(passes.size()); i++)
+	{
+		Pass& pass = passes[i];
+		if (pass.Culled)
+			continue;
+
+		for (Resource& resource : resources)
+		{
+			if (!resource.Imported && resource.Type == ResourceType::Texture && resource.FirstPass == i)
+			{
+				resource.PoolIndex = AcquireTexture(resource.Desc);
+				stats.TransientTextures++;
+			}
+		}
+
+		for (Attachment& write : pass.Writes)
+		{
+			const Resource& resource = resources[write.Resource];
+			if (!resource.Imported && !written[write.Resource] && write.Load == LoadOp::Load && !pass.Blit)
+				write.Load = LoadOp::Clear;
+			written[write.Resource] = true;
+
+			if (write.Load == LoadOp::Clear)
+				stats.Clears++;
+		}
+
+		for (const Resource& resource : resources)
+		{
+			if (resource.PoolIndex >= 0 && resource.LastPass == i)
+				pool[resource.PoolIndex].InUse = false;
+		}
+	}
+
+	std::vector<bool> used(pool.size(), false);
+	for (const Resource& resource : resources)
+	{
+		if (resource.PoolIndex >= 0 && !used[resource.PoolIndex])
+		{
+			used[resource.PoolIndex] = true;
+			stats.PhysicalTextures++;
+		}
+	}
+}
+
+void RenderGraph::Compile()
+{
+	stats = Stats();
+
+	InsertFeedbackCopies();
+	CullPasses();
+	AssignTextures();
+
+	stats.Passes = static_cast<unsigned int>(passes.size());
+	for (const Pass& pass : passes)
+	{
+		if (pass.Culled)
+			stats.PassesCulled++;
+		else if (pass.Blit)
+			stats.Blits++;
+	}
+
+	stats.PooledTextures = static_cast<unsigned int>(pool.size());
+	for (const PooledTexture& texture : pool)
+		stats.PooledBytes += static_cast<size_t>(texture.Desc.Width) * texture.Desc.Height * GetFormatSize(texture.Desc.Format);
+
+	compiled = true;
+}
+
+unsigned int RenderGraph::GetFramebuffer(const std::vector<unsigned int>& colors, unsigned int depth, FrameBufferFormat depthFormat)
+{
+	std::vector<unsigned int> key = colors;
+	key.push_back(depth);
+
+	auto it = framebuffers.find(key);
+	if (it != framebuffers.end())
+		return it->second.Get();
+
+	GLFramebuffer framebuffer = GLFramebuffer::Create();
+	const unsigned int id = framebuffer.Get();
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, id);
+
+	std::vector<unsigned int> drawBuffers;
+	for (size_t i = 0; i < colors.size(); i++)
+	{
+		const unsigned int attachment = GL_COLOR_ATTACHMENT0 + static_cast<unsigned int>(i);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, colors[i], 0);
+		drawBuffers.push_back(attachment);
+	}
+
+	if (depth)
+	{
+		const unsigned int attachment = depthFormat == FrameBufferFormat::Depth24Stencil8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, depth, 0);
+	}
+
+	if (drawBuffers.empty())
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	else
+	{
+		glDrawBuffers(static_cast<int>(drawBuffers.size()), drawBuffers.data());
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::RENDERGRAPH:: Pass framebuffer is not complete!" << std::endl;
+
+	framebuffers.emplace(std::move(key), std::move(framebuffer));
+	return id;
+}
+
+void RenderGraph::BindPass(const Pass& pass)
+{
+	std::vector<unsigned int> colors;
+	std::vector<const Attachment*> colorWrites;
+	const Attachment* depthWrite = nullptr;
+	const Resource* target = nullptr;
+	const Resource* sized = nullptr;
+	unsigned int depth = 0;
+	FrameBufferFormat depthFormat = FrameBufferFormat::None;
+
+	Context context(*this);
+	for (const Attachment& write : pass.Writes)
+	{
+		const Resource& resource = resources[write.Resource];
+		if (resource.Type == ResourceType::Framebuffer)
+		{
+			target = &resource;
+		}
+		else if (resource.Type == ResourceType::Texture)
+		{
+			sized = &resource;
+			if (IsDepthFormat(resource.Desc.Format))
+			{
+				depth = context.GetTexture(write.Resource);
+				depthFormat = resource.Desc.Format;
+				depthWrite = &write;
+			}
+			else
+			{
+				colors.push_back(context.GetTexture(write.Resource));
+				colorWrites.push_back(&write);
+			}
+		}
+	}
+
+	if (target)
+	{
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, target->Id);
+		GLStateCache::Viewport(target->Viewport.x, target->Viewport.y, target->Viewport.z, target->Viewport.w);
+	}
+	else if (sized)
+	{
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(colors, depth, depthFormat));
+		GLStateCache::Viewport(0, 0, sized->Desc.Width, sized->Desc.Height);
+	}
+	else
+	{
+		return;
+	}
+
+	// Write masks apply to clears too
+	const float clearDepth = 1.0f;
+	for (const Attachment& write : pass.Writes)
+	{
+		if (write.Load != LoadOp::Clear)
+			continue;
+
+		GLStateCache::SetColorWrite(true);
+		GLStateCache::SetDepthWrite(true);
+
+		if (resources[write.Resource].Type == ResourceType::Framebuffer)
+		{
+			glClearBufferfv(GL_COLOR, 0, &write.ClearColor[0]);
+			glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+		}
+		else if (&write == depthWrite && depthFormat == FrameBufferFormat::Depth24Stencil8)
+		{
+			glClearBufferfi(GL_DEPTH_STENCIL, 0, clearDepth, 0);
+		}
+		else if (&write == depthWrite)
+		{
+			glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+		}
+		else
+		{
+			const auto index = std::find(colorWrites.begin(), colorWrites.end(), &write) - colorWrites.begin();
+			glClearBufferfv(GL_COLOR, static_cast<int>(index), &write.ClearColor[0]);
+		}
+	}
+}
+
+void RenderGraph::ExecuteBlit(const Pass& pass)
+{
+	const Resource& src = resources[pass.Reads[0]];
+	const Resource& dst = resources[pass.Writes[0].Resource];
+	Context context(*this);
+
+	const bool depth = src.Type == ResourceType::Texture && IsDepthFormat(src.Desc.Format);
+	auto framebuffer = [&](const Resource& resource, RenderGraphResource id)
+	{
+		if (resource.Type == ResourceType::Framebuffer)
+			return resource.Id;
+
+		const unsigned int texture = context.GetTexture(id);
+		return depth
+			? GetFramebuffer({}, texture, resource.Desc.Format)
+			: GetFramebuffer({ texture }, 0, FrameBufferFormat::None);
+	};
+
+	GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer(src, pass.Reads[0]));
+	GLStateCache::BindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer(dst, pass.Writes[0].Resource));
+
+	const glm::ivec4& from = src.Viewport;
+	const glm::ivec4& to = dst.Viewport;
+	const bool scaled = from.z != to.z || from.w != to.w;
+
+	if (depth)
+		GLStateCache::SetDepthWrite(true);
+	else
+		GLStateCache::SetColorWrite(true);
+
+	glBlitFramebuffer(from.x, from.y, from.x + from.z, from.y + from.w, to.x, to.y, to.x + to.z, to.y + to.w,
+		depth ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT, scaled && !depth ? GL_LINEAR : GL_NEAREST);
+}
+
+void RenderGraph::Execute()
+{
+	if (!compiled)
+		Compile();
+
+	const unsigned int previousFramebuffer = GLStateCache::GetFramebuffer();
+	GLint viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	Context context(*this);
+	for (const Pass& pass : passes)
+	{
+		if (pass.Culled)
+			continue;
+
+		if (pass.Blit)
+		{
+			GpuProfileScope scope(pass.Name.c_str());
+			ExecuteBlit(pass);
+			continue;
+		}
+
+		GpuProfileScope scope(pass.Name.c_str());
+		BindPass(pass);
+		if (pass.Execute)
+			pass.Execute(context);
+	}
+
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	GLStateCache::Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	RetireTextures();
+}
+
+void RenderGraph::ForgetTexture(unsigned int texture)
+{
+	for (auto it = framebuffers.begin(); it != framebuffers.end();)
+	{
+		if (std::find(it->first.begin(), it->first.end(), texture) == it->first.end())
+		{
+			++it;
+			continue;
+		}
+
+		it = framebuffers.erase(it);
+	}
+}
+
+void RenderGraph::RetireSize(const glm::ivec2& size)
+{
+	for (size_t i = 0; i < pool.size();)
+	{
+		if (pool[i].InUse || pool[i].Desc.Width != size.x || pool[i].Desc.Height != size.y)
+		{
+			i++;
+			continue;
+		}
+
+		ForgetTexture(pool[i].Texture.Get());
+		pool.erase(pool.begin() + i);
+	}
+}
+
+// Textures no pass has used for RetireFrames frames go back to the driver
+void RenderGraph::RetireTextures()
+{
+	for (size_t i = 0; i < pool.size();)
+	{
+		if (frame - pool[i].LastUsedFrame <= RetireFrames)
+		{
+			i++;
+			continue;
+		}
+
+		ForgetTexture(pool[i].Texture.Get());
+		pool.erase(pool.begin() + i);
+	}
+}
@@ -0,0 +1,209 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Interface/FrameBuffer.h"
+
+using RenderGraphResource = uint32_t;
+
+struct RenderGraphTextureDesc
+{
+	int Width = 0;
+	int Height = 0;
+	FrameBufferFormat Format = FrameBufferFormat::RGBA8;
+
+	bool operator==(const RenderGraphTextureDesc& other) const
+	{
+		return Width == other.Width && Height == other.Height && Format == other.Format;
+	}
+};
+
+// What happens to an attachment's contents when its pass binds it
+enum class LoadOp : uint8_t
+{
+	Load,
+	Clear,
+	// The pass overwrites every pixel it cares about
+	DontCare
+};
+
+/*
+ * Frame graph rebuilt every frame. Passes declare the textures, framebuffers and
+ * buffers they read and write in a setup callback, Compile then:
+ *
+ *  - culls passes whose outputs nobody reads, walking back from imported
+ *    resources and passes marked with a side effect,
+ *  - puts a copy in front of passes that sample a texture they also render to,
+ *  - computes the first and last pass using every transient texture and hands
+ *    them textures from a pool, so transients whose lifetimes do not overlap
+ *    share one GL texture,
+ *  - turns the first Load of a transient into a clear, since an aliased texture
+ *    holds whatever its previous owner left.
+ *
+ * Execute binds a framebuffer with each pass's written textures as attachments,
+ * applies the clears and runs the pass. Pool textures unused for a while are
+ * deleted, so a pass that stops running stops costing memory.
+ */
+class RenderGraph
+{
+public:
+	static constexpr RenderGraphResource InvalidResource = ~0u;
+	// Pool textures idle for this many frames are deleted
+	static constexpr uint64_t RetireFrames = 60;
+
+	struct Stats
+	{
+		unsigned int Passes = 0;
+		unsigned int PassesCulled = 0;
+		unsigned int TransientTextures = 0;
+		// GL textures backing the transients this frame, lower when they alias
+		unsigned int PhysicalTextures = 0;
+		unsigned int PooledTextures = 0;
+		size_t PooledBytes = 0;
+		unsigned int Clears = 0;
+		unsigned int Blits = 0;
+	};
+
+	class Builder
+	{
+	private:
+		RenderGraph& graph;
+		uint32_t pass;
+
+	public:
+		Builder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+		RenderGraphResource Create(const std::string& name, const RenderGraphTextureDesc& desc);
+		RenderGraphResource Read(RenderGraphResource resource);
+		// Textures become attachments, colors in call order
+		RenderGraphResource Write(RenderGraphResource resource, LoadOp load = LoadOp::Load, const glm::vec4& clearColor = glm::vec4(0.0f));
+		// Keeps the pass even though nothing reads what it writes
+		void SetSideEffect();
+	};
+
+	class Context
+	{
+	private:
+		const RenderGraph& graph;
+
+	public:
+		explicit Context(const RenderGraph& graph) : graph(graph) {}
+
+		unsigned int GetTexture(RenderGraphResource resource) const;
+		const RenderGraphTextureDesc& GetDesc(RenderGraphResource resource) const;
+	};
+
+	using SetupFunction = std::function<void(Builder&)>;
+	using ExecuteFunction = std::function<void(const Context&)>;
+
+private:
+	enum class ResourceType : uint8_t
+	{
+		Texture,
+		Framebuffer,
+		Buffer
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		ResourceType Type = ResourceType::Texture;
+		RenderGraphTextureDesc Desc;
+		bool Imported = false;
+		// GL name: the texture, framebuffer or buffer
+		unsigned int Id = 0;
+		glm::ivec4 Viewport = glm::ivec4(0);
+
+		// Filled by Compile
+		unsigned int Readers = 0;
+		int FirstPass = -1;
+		int LastPass = -1;
+		int PoolIndex = -1;
+	};
+
+	struct Attachment
+	{
+		RenderGraphResource Resource;
+		LoadOp Load;
+		glm::vec4 ClearColor;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFunction Execute;
+		std::vector<RenderGraphResource> Reads;
+		std::vector<Attachment> Writes;
+		bool SideEffect = false;
+		// Inserted by Compile, copies Reads[0] into Writes[0]
+		bool Blit = false;
+
+		unsigned int References = 0;
+		bool Culled = false;
+	};
+
+	struct PooledTexture
+	{
+		GLTexture Texture;
+		RenderGraphTextureDesc Desc;
+		uint64_t LastUsedFrame = 0;
+		bool InUse = false;
+	};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<PooledTexture> pool;
+	// Framebuffer per set of attachment textures, depth last
+	std::map<std::vector<unsigned int>, GLFramebuffer> framebuffers;
+	uint64_t frame = 0;
+	bool compiled = false;
+	Stats stats;
+
+	RenderGraphResource AddResource(Resource resource);
+	void InsertFeedbackCopies();
+	void CullPasses();
+	void AssignTextures();
+	int AcquireTexture(const RenderGraphTextureDesc& desc);
+	void RetireTextures();
+	void BindPass(const Pass& pass);
+	void ExecuteBlit(const Pass& pass);
+	unsigned int GetFramebuffer(const std::vector<unsigned int>& colors, unsigned int depth, FrameBufferFormat depthFormat);
+	void ForgetTexture(unsigned int texture);
+
+public:
+	RenderGraph() = default;
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Drops last frame's passes and resources, pooled textures stay
+	void Reset();
+	// Deletes idle pool textures of this size now instead of after RetireFrames, for a
+	// size no pass asks for anymore like the render size before a resolution change
+	void RetireSize(const glm::ivec2& size);
+
+	RenderGraphResource ImportTexture(const std::string& name, unsigned int texture, const RenderGraphTextureDesc& desc);
+	// A framebuffer passes render into as a whole, like the view the renderer was called on
+	RenderGraphResource ImportFramebuffer(const std::string& name, unsigned int framebuffer, const glm::ivec4& viewport);
+	// Only orders passes, buffers are bound by the passes themselves
+	RenderGraphResource ImportBuffer(const std::string& name, unsigned int buffer);
+
+	void AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute);
+	// Copies src into dst with glBlitFramebuffer, linear when the sizes differ
+	void AddBlitPass(const std::string& name, RenderGraphResource src, RenderGraphResource dst);
+
+	void Compile();
+	// Leaves the framebuffer and viewport as they were before
+	void Execute();
+
+	const Stats& GetStats() const { return stats; }
+};
+
+
+#endif //RENDERGRAPH_H
@@ -0,0 +1,108 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+
+static uint64_t QuantizeDepth(float depth, unsigned int bits)
+{
+	const uint64_t maxValue = (1ull << bits) - 1;
+	float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+	return static_cast<uint64_t>(clamped * static_cast<float>(maxValue));
+}
+
+static uint64_t Field(unsigned int value, unsigned int bits)
+{
+	return static_cast<uint64_t>(value) & ((1ull << bits) - 1);
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, bool translucent, unsigned int shader, unsigned int texture, unsigned int vertexArray, float depth)
+{
+	uint64_t key = Field(static_cast<unsigned int>(pass), 2) << 62;
+
+	if (!translucent)
+	{
+		key |= Field(shader, 12) << 49;
+		key |= Field(texture, 16) << 33;
+		key |= Field(vertexArray, 16) << 17;
+		key |= QuantizeDepth(depth, 17);
+	}
+	else
+	{
+		const uint64_t maxDepth = (1ull << 24) - 1;
+		key |= 1ull << 61;
+		key |= (maxDepth - QuantizeDepth(depth, 24)) << 37;
+		key |= Field(shader, 12) << 25;
+		key |= Field(texture, 16) << 9;
+		key |= Field(vertexArray, 9);
+	}
+
+	return key;
+}
+
+void RenderQueue::Push(const DrawPacket& packet)
+{
+	entries.push_back({ packet.Key, static_cast<uint32_t>(packets.size()) });
+	packets.push_back(packet);
+}
+
+void RenderQueue::Append(const std::vector<DrawPacket>& batch)
+{
+	const uint32_t first = static_cast<uint32_t>(packets.size());
+	entries.reserve(entries.size() + batch.size());
+	for (size_t i = 0; i < batch.size(); i++)
+		entries.push_back({ batch[i].Key, first + static_cast<uint32_t>(i) });
+	packets.insert(packets.end(), batch.begin(), batch.end());
+}
+
+void RenderQueue::Clear()
+{
+	// Keeps capacity, so a steady scene does not allocate after the first frame
+	packets.clear();
+	entries.clear();
+}
+
+/*
+ * LSD radix sort, 8 bits per pass. All histograms are built in a single sweep and
+ * passes where every key has the same digit are skipped, which is the common case
+ * for the high bits (pass/translucency) and for scenes with few shaders.
+ */
+void RenderQueue::Sort()
+{
+	const size_t count = entries.size();
+	if (count < 2)
+		return;
+
+	size_t histograms[8][256] = {};
+	for (const SortEntry& entry : entries)
+	{
+		for (unsigned int pass = 0; pass < 8; pass++)
+			histograms[pass][(entry.Key >> (pass * 8)) & 0xFF]++;
+	}
+
+	scratch.resize(count);
+	SortEntry* src = entries.data();
+	SortEntry* dst = scratch.data();
+
+	for (unsigned int pass = 0; pass < 8; pass++)
+	{
+		size_t* histogram = histograms[pass];
+
+		if (histogram[(src[0].Key >> (pass * 8)) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			size_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dst[histogram[(src[i].Key >> (pass * 8)) & 0xFF]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	if (src != entries.data())
+		entries.swap(scratch);
+}
@@ -0,0 +1,70 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ResourcePool.h"
+
+/*
+ * Sort key layout (most significant bits first)
+ *
+ *  Opaque      : pass(2) | translucent(1)=0 | shader(12) | texture(16) | vao(16) | depth(17)
+ *  Translucent : pass(2) | translucent(1)=1 | ~depth(24) | shader(12) | texture(16) | vao(9)
+ *
+ * Opaque packets are grouped by state and drawn front-to-back inside a group,
+ * translucent packets are drawn strictly back-to-front.
+ * Ids are truncated to their field width, so two different objects may share a
+ * key slot; submission compares the real ids, so this only affects grouping.
+ */
+
+enum class RenderPass : uint8_t
+{
+	Main = 0
+};
+
+struct DrawPacket
+{
+	uint64_t Key;
+	MeshHandle MeshRef;
+	MaterialHandle MaterialRef;
+	glm::mat4 Model;
+	// Index into the mesh's lods
+	uint8_t Lod;
+};
+
+class RenderQueue
+{
+private:
+	struct SortEntry
+	{
+		uint64_t Key;
+		uint32_t Index;
+	};
+
+	std::vector<DrawPacket> packets;
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+
+public:
+	RenderQueue() = default;
+	~RenderQueue() = default;
+
+	static uint64_t MakeKey(RenderPass pass, bool translucent, unsigned int shader, unsigned int texture, unsigned int vertexArray, float depth);
+	static bool IsTranslucent(uint64_t key) { return (key >> 61) & 1; }
+
+	void Push(const DrawPacket& packet);
+	void Append(const std::vector<DrawPacket>& batch);
+	void Clear();
+	void Sort();
+
+	size_t Size() const { return packets.size(); }
+	bool Empty() const { return packets.empty(); }
+
+	// Packet at position i in sorted order, valid after Sort()
+	const DrawPacket& operator[](size_t i) const { return packets[entries[i].Index]; }
+};
+
+
+#endif //RENDERQUEUE_H
@@ -1,7 +1,13 @@
 #include "Renderer.h"
 #include <glad/glad.h>
 #include "Interface/Exception.h"
+#include "Interface/GLExtensions.h"
+#include "Interface/GLStateCache.h"
+#include "System/FramePacer.h"
+#include "System/JobSystem.h"
+#include "GpuProfiler.h"
 #include "GLFW/glfw3.h"
+#include <algorithm>
 #include <iostream>
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -10,7 +16,7 @@
 
 
 Renderer::Renderer()
-	: sceneLight()
+	: occlusionCuller(&JobSystem::Get()), lightGrid(&JobSystem::Get())
 {
 
 	float quadVertices[] = {
@@ -34,14 +40,28 @@ Renderer::Renderer()
 	};
 
 	quadIB = IndexBuffer(quadIndices, 6);
-	VertexBuffer uvBuffer =VertexBuffer(quadUV, sizeof(quadUV));
-	VertexBuffer vertBuffer = VertexBuffer(quadVertices, sizeof(quadVertices));
+	quadUVBuffer = VertexBuffer(quadUV, sizeof(quadUV));
+	quadVertexBuffer = VertexBuffer(quadVertices, sizeof(quadVertices));
 
-	quadVA.AddBuffer(vertBuffer, Coordinates, 2);
-	quadVA.AddBuffer(uvBuffer, TexCoords, 2);
+	quadVA.AddBuffer(quadVertexBuffer, Coordinates, 2);
+	quadVA.AddBuffer(quadUVBuffer, TexCoords, 2);
 	glEnable(GL_POLYGON_OFFSET_FILL);
 	glPolygonOffset(1.0f, 1.0f); // Adjust the values as needed
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::SetDepthTest(true);
+
+	uniformStream = StreamingBuffer(GL_UNIFORM_BUFFER, UniformStreamSize, FramePacer::MaxFramesInFlight);
+	instanceStream = StreamingBuffer(GL_ARRAY_BUFFER, InstanceStreamSize, FramePacer::MaxFramesInFlight);
+	const GLCapabilities& capabilities = GLCapabilities::Get();
+	if (capabilities.MultiDrawIndirect && capabilities.DrawParameters)
+	{
+		objectStream = StreamingBuffer(GL_SHADER_STORAGE_BUFFER, ObjectStreamSize, FramePacer::MaxFramesInFlight);
+		indirectStream = StreamingBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectStreamSize, FramePacer::MaxFramesInFlight);
+	}
+
+	defaultMaterial = ResourceRegistry::Get().GetDefaultMaterial();
+
+	lightGrid.SetMaxLightIndices(static_cast<size_t>(GLCapabilities::Get().MaxTextureBufferSize));
+	SetIndirectDraw(true);
 }
 
 
@@ -57,61 +77,1078 @@ void Renderer::DrawQuad(Shader& shader)
 }
 
 
-void Renderer::DrawModel(const Model& model, Material material, const Transform& transform)
+void Renderer::DrawModel(const Model& model, MaterialHandle material, const Transform& transform)
 {
-	std::vector<Mesh> meshes = model.GetMeshes();
+	AppendPackets(model, material, transform.GetModel(), nullptr, candidates, culler);
+}
 
-	for (Mesh mesh : meshes)
-	{
-		mesh.vertexArray.Bind();
-		mesh.indexBuffer.Bind();
+// Safe to run on several threads at once as long as each call writes its own packets, culler and history
+void Renderer::AppendPackets(const Model& model, MaterialHandle materialHandle, const glm::mat4& modelMatrix, std::vector<uint8_t>* lodHistory,
+	std::vector<DrawPacket>& packets, FrustumCuller& packetCuller) const
+{
+	const ResourceRegistry& resources = ResourceRegistry::Get();
+	const glm::vec3 cameraPosition = camera.GetTransform().position;
+	const float depth = glm::distance(cameraPosition, glm::vec3(modelMatrix[3])) / camera.GetFar();
+	const std::vector<MeshHandle>& meshes = model.GetMeshes();
 
+	const Material& material = resources.ResolveMaterial(materialHandle);
+	const unsigned int shaderId = resources.ResolveShader(material.Shader).GetId();
+	const unsigned int textureId = resources.ResolveTexture(material.Albedo).GetId();
 
-		material.Shader.Bind();
-		material.Albedo.Bind();
+	if (lodHistory)
+		lodHistory->resize(meshes.size(), NoLod);
 
-		material.Shader.SetUniformMatrix4fv("uModel", transform.GetModel());
-		material.Shader.SetUniformMatrix4fv("uView", camera.GetView());
-        material.Shader.SetUniformMatrix4fv("uProjection", camera.GetProjection());
-        material.Shader.SetUniform1i("uTexture", static_cast<int>(material.Albedo.GetIndex()));
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const Mesh* meshPtr = resources.GetMesh(meshes[i]);
+		if (!meshPtr)
+			continue;
 
+		const Mesh& mesh = *meshPtr;
+		const unsigned int vertexArray = MeshArena::Get().GetVertexArray(mesh.geometry.GetRange()->Pool).GetRendererID();
+		uint64_t key = RenderQueue::MakeKey(RenderPass::Main, material.Transparent,
+			shaderId, textureId, vertexArray, depth);
 
-		PointLight light = sceneLight.PointLights[0];
-		material.Shader.SetUniform3f("uLightColor", light.Color);
-		material.Shader.SetUniform3f("uLightPos", light.Position);
-		material.Shader.SetUniform1f("uLightIntensity", light.Intensity);
-		material.Shader.SetUniform3f("uAmbientLight", glm::vec3(0.5f, 0.5f, 0.5f));
+		uint8_t lod = 0;
+		if (meshLod)
+		{
+			lod = SelectLod(mesh, modelMatrix, lodHistory ? (*lodHistory)[i] : NoLod);
+			if (lodHistory)
+				(*lodHistory)[i] = lod;
+		}
 
-		glDrawElements(GL_TRIANGLES, mesh.indexBuffer.GetCount(), GL_UNSIGNED_INT, 0);
+		// Culling stays in object space, only the GPU sees the quantized positions
+		packets.push_back(DrawPacket{ key, meshes[i], materialHandle, modelMatrix * mesh.positionDecode, lod });
+		packetCuller.Add(mesh.bounds.Transformed(modelMatrix));
 	}
 }
 
+/*
+ * The error of a level is relative to the bounding sphere, so its size on screen
+ * is the projected sphere radius times that ratio. The coarsest level whose error
+ * stays under the pixel threshold wins; moving away from the previous level needs
+ * the threshold crossed by a margin, so meshes near a boundary do not pop back and
+ * forth.
+ */
+uint8_t Renderer::SelectLod(const Mesh& mesh, const glm::mat4& modelMatrix, uint8_t previous) const
+{
+	const uint8_t levels = static_cast<uint8_t>(mesh.lods.size());
+	if (levels <= 1 || mesh.sphere.Radius <= 0.0f)
+		return 0;
+
+	const BoundingSphere sphere = mesh.sphere.Transformed(modelMatrix);
+	const float distance = glm::distance(camera.GetTransform().position, sphere.Center);
+	if (distance <= sphere.Radius)
+		return 0;
+
+	// Projected radius in pixels, the projection scales y by cot(fov / 2)
+	const float projectedRadius = sphere.Radius / distance * camera.GetProjection()[1][1] * viewportSize.y * 0.5f;
+	const float pixelsPerError = projectedRadius / mesh.sphere.Radius;
+
+	auto pixelError = [&](uint8_t level) { return mesh.lods[level].Error * pixelsPerError; };
+
+	uint8_t level = previous < levels ? previous : 0;
+	const float coarser = previous < levels ? lodPixelError * (1.0f - LodHysteresis) : lodPixelError;
+	const float finer = lodPixelError * (1.0f + LodHysteresis);
+
+	while (level > 0 && pixelError(level) > finer)
+		level--;
+	while (level + 1 < levels && pixelError(level + 1) <= coarser)
+		level++;
+
+	return level;
+}
+
 void Renderer::DrawScene(Scene &scene)
 {
-	for (entt::entity entity : scene.GetEntitiesWithComponent<Model>())
+	for (auto [entity, light, transform] : scene.GetRegistry().view<PointLight, Transform>().each())
+		AddLight(transform.position, light);
+
+	for (auto [entity, light, transform] : scene.GetRegistry().view<DirectionalLight, Transform>().each())
+	{
+		SetDirectionalLight(DirectionalLight::GetDirection(transform), light);
+		break;
+	}
+
+	if (shadows && sunShadows)
+		RenderShadows(scene);
+
+	sceneEntities.clear();
+	if (frustumCulling)
+	{
+		SpatialIndex& spatialIndex = scene.GetSpatialIndex();
+		spatialIndex.Query(frustum, sceneEntities);
+		stats.EntitiesCulled += static_cast<unsigned int>(spatialIndex.Size() - sceneEntities.size());
+	}
+	else
+	{
+		// Packets and occlusion read the Transform, a Model without one is not drawn
+		auto view = scene.GetRegistry().view<Model, Transform>();
+		sceneEntities.assign(view.begin(), view.end());
+	}
+
+	if (occlusionCulling)
+		OccludeEntities(scene);
+
+	GeneratePackets(scene);
+}
+
+/*
+ * The visible entities are cut into contiguous slices with an arena each. Workers
+ * read the components, build model matrices, pick materials and levels and frustum
+ * cull the meshes of their slices; only the merge into the queue is serial. It
+ * goes in slice order, so the queue does not depend on scheduling.
+ */
+void Renderer::GeneratePackets(Scene& scene)
+{
+	const size_t count = sceneEntities.size();
+	if (count == 0)
+		return;
+
+	// Growing the history is the only shared write, done up front
+	size_t historySize = lodHistory.size();
+	for (entt::entity entity : sceneEntities)
+		historySize = std::max(historySize, static_cast<size_t>(entt::entt_traits<entt::entity>::to_entity(entity)) + 1);
+	lodHistory.resize(historySize);
+
+	JobSystem& jobs = JobSystem::Get();
+	const size_t arenaCount = std::min<size_t>(jobs.GetThreadCount() * 4, (count + MinEntitiesPerArena - 1) / MinEntitiesPerArena);
+	if (arenas.size() < arenaCount)
+		arenas.resize(arenaCount);
+
+	// Workers only take the const lookups, the non-const ones may create component storage
+	const entt::registry& registry = scene.GetRegistry();
+
+	auto generate = [&](size_t begin, size_t end)
+	{
+		for (size_t a = begin; a < end; a++)
+		{
+			PacketArena& arena = arenas[a];
+			arena.Packets.clear();
+			arena.Culler.Clear();
+			arena.Visible.clear();
+
+			const size_t last = count * (a + 1) / arenaCount;
+			for (size_t i = count * a / arenaCount; i < last; i++)
+			{
+				const entt::entity entity = sceneEntities[i];
+				const MaterialHandle* material = registry.try_get<MaterialHandle>(entity);
+
+				LodHistory& history = lodHistory[entt::entt_traits<entt::entity>::to_entity(entity)];
+				if (history.Entity != entity)
+				{
+					history.Entity = entity;
+					history.Levels.clear();
+				}
+				history.Frame = frameIndex;
+
+				AppendPackets(registry.get<Model>(entity), material ? *material : defaultMaterial, registry.get<Transform>(entity).GetModel(),
+					&history.Levels, arena.Packets, arena.Culler);
+			}
+
+			arena.Generated = arena.Packets.size();
+			if (!frustumCulling)
+				continue;
+
+			// Indices come back ascending, so the survivors can be compacted in place
+			arena.Culler.Cull(frustum, arena.Visible);
+			size_t kept = 0;
+			for (uint32_t index : arena.Visible)
+				arena.Packets[kept++] = arena.Packets[index];
+			arena.Packets.resize(kept);
+		}
+	};
+
+	if (arenaCount > 1)
+		jobs.ParallelFor(arenaCount, 1, generate);
+	else
+		generate(0, arenaCount);
+
+	for (size_t a = 0; a < arenaCount; a++)
+	{
+		queue.Append(arenas[a].Packets);
+		stats.MeshesCulled += static_cast<unsigned int>(arenas[a].Generated - arenas[a].Packets.size());
+	}
+}
+
+/*
+ * Occluders are picked by how much of the screen their bounds cover, approximated
+ * by radius over distance. Entities with an Occluder component go first, the rest
+ * of the budget is filled automatically from meshes small enough to rasterize.
+ */
+void Renderer::OccludeEntities(Scene& scene)
+{
+	const glm::vec3 cameraPosition = camera.GetTransform().position;
+
+	const size_t count = sceneEntities.size();
+	entityBounds.resize(count);
+	occluderScores.resize(count);
+	occluderCandidates.clear();
+
+	// Bounds and scores in parallel, a negative score marks an entity that cannot occlude
+	const entt::registry& registry = scene.GetRegistry();
+	JobSystem::Get().ParallelFor(count, MinEntitiesPerArena, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const entt::entity entity = sceneEntities[i];
+			const Model& model = registry.get<Model>(entity);
+			const AABB bounds = model.GetBounds().Transformed(registry.get<Transform>(entity).GetModel());
+			entityBounds[i] = bounds;
+			occluderScores[i] = -1.0f;
+
+			const Occluder* occluder = registry.try_get<Occluder>(entity);
+			if ((occluder && !occluder->enabled) || !model.HasOccluderGeometry())
+				continue;
+
+			const float radius = glm::length(bounds.GetExtents());
+			const float distance = std::max(glm::distance(cameraPosition, bounds.GetCenter()), 1e-3f);
+			occluderScores[i] = radius / distance + (occluder ? 1e6f : 0.0f);
+		}
+	});
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (occluderScores[i] >= 0.0f)
+			occluderCandidates.emplace_back(occluderScores[i], i);
+	}
+
+	if (occluderCandidates.empty())
+		return;
+
+	const size_t occluderCount = std::min(occluderCandidates.size(), MaxOccluders);
+	std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + occluderCount, occluderCandidates.end(),
+		[](const auto& a, const auto& b) { return a.first > b.first; });
+
+	occlusionCuller.Begin(viewProjection);
+	for (size_t i = 0; i < occluderCount; i++)
+	{
+		const entt::entity entity = sceneEntities[occluderCandidates[i].second];
+		const glm::mat4 modelMatrix = scene.GetComponent<Transform>(entity).GetModel();
+
+		for (MeshHandle handle : scene.GetComponent<Model>(entity).GetMeshes())
+		{
+			const Mesh* mesh = ResourceRegistry::Get().GetMesh(handle);
+			if (mesh && mesh->occluder)
+				occlusionCuller.AddOccluder(*mesh->occluder, modelMatrix);
+		}
+	}
+	occlusionCuller.Rasterize();
+	occlusionCuller.TestVisibility(entityBounds, entityVisible);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < sceneEntities.size(); i++)
+	{
+		if (entityVisible[i])
+			sceneEntities[kept++] = sceneEntities[i];
+	}
+
+	stats.EntitiesOccluded += static_cast<unsigned int>(sceneEntities.size() - kept);
+	stats.OccluderTriangles += static_cast<unsigned int>(occlusionCuller.GetTriangleCount());
+	sceneEntities.resize(kept);
+}
+
+static const Mesh& GetMesh(const DrawPacket& packet)
+{
+	// Packets are only made for meshes that resolved
+	return *ResourceRegistry::Get().GetMesh(packet.MeshRef);
+}
+
+// Meshes always own their geometry, the range only moves between frames
+static const MeshArena::Range& GetRange(const Mesh& mesh)
+{
+	return *mesh.geometry.GetRange();
+}
+
+static const Material& GetMaterial(const DrawPacket& packet)
+{
+	return ResourceRegistry::Get().ResolveMaterial(packet.MaterialRef);
+}
+
+// Different materials still draw the same when they agree on program, texture and blending
+static bool SameMaterialState(const DrawPacket& a, const DrawPacket& b)
+{
+	if (a.MaterialRef == b.MaterialRef)
+		return true;
+
+	const Material& materialA = GetMaterial(a);
+	const Material& materialB = GetMaterial(b);
+	return materialA.Shader == materialB.Shader
+		&& materialA.Albedo == materialB.Albedo
+		&& materialA.Transparent == materialB.Transparent;
+}
+
+static bool CanInstance(const DrawPacket& a, const DrawPacket& b)
+{
+	return a.MeshRef == b.MeshRef
+		&& a.Lod == b.Lod
+		&& SameMaterialState(a, b);
+}
+
+static const void* IndexOffset(const MeshArena::Range& range, const MeshLod& lod)
+{
+	return reinterpret_cast<const void*>(static_cast<size_t>(range.FirstIndex + lod.FirstIndex) * sizeof(unsigned int));
+}
+
+// Packets that can go into one multi draw: same material state and same arena pool
+static bool CanShareBucket(const DrawPacket& a, const DrawPacket& b)
+{
+	return GetRange(GetMesh(a)).Pool == GetRange(GetMesh(b)).Pool
+		&& SameMaterialState(a, b);
+}
+
+const Shader* Renderer::GetShaderVariant(const Shader& shader, uint8_t variant)
+{
+	// Shaders built from in-memory sources have no file to recompile the variant from
+	if (shader.GetFilePath().empty())
+		return nullptr;
+
+	// The variant bits pick the define set, program ids are reused once a program is deleted
+	std::unordered_map<uint8_t, Shader>& variants = shaderVariants[shader.GetFilePath()];
+	auto it = variants.find(variant);
+	if (it != variants.end())
+		return &it->second;
+
+	std::vector<std::string> defines;
+	if (variant & ShaderVariant::Instanced)
+		defines.push_back("INSTANCED");
+	if (variant & ShaderVariant::Indirect)
+		defines.push_back("INDIRECT");
+	if (variant & ShaderVariant::GBuffer)
+		defines.push_back("GBUFFER");
+	if (variant & ShaderVariant::DeferredLighting)
+		defines.push_back("DEFERRED_LIGHTING");
+
+	Shader compiled = (variant & ShaderVariant::Indirect)
+		? Shader(shader.GetFilePath(), defines, 460)
+		: Shader(shader.GetFilePath(), defines);
+
+	auto inserted = variants.emplace(variant, compiled);
+	return &inserted.first->second;
+}
+
+// Program for a direct draw in the current pass, the material's own one outside of variant passes
+const Shader& Renderer::GetPassShader(const Shader& shader)
+{
+	const Shader* variant = passVariant ? GetShaderVariant(shader, passVariant) : nullptr;
+	return variant ? *variant : shader;
+}
+
+void Renderer::SetIndirectDraw(bool enabled)
+{
+	const GLCapabilities& capabilities = GLCapabilities::Get();
+	indirectDraw = enabled && capabilities.MultiDrawIndirect && capabilities.DrawParameters;
+}
+
+/*
+ * Binds whatever differs from the previous draw. Camera and light come from the
+ * FrameData block and samplers have fixed units, so a shader change is just the bind.
+ */
+void Renderer::ApplyDrawState(const Shader& shader, const Material& material, const Mesh& mesh, SubmitState& state)
+{
+	if (material.Transparent != state.Blending)
+	{
+		state.Blending = material.Transparent;
+		GLStateCache::SetBlend(state.Blending);
+		GLStateCache::SetDepthWrite(!state.Blending);
+		if (state.Blending)
+			GLStateCache::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	if (shader.GetId() != state.Shader)
 	{
-		Model& model = scene.GetComponent<Model>(entity);
-		Transform& transform = scene.GetComponent<Transform>(entity);
+		state.Shader = shader.GetId();
+		shader.Bind();
+		stats.ShaderBinds++;
+	}
 
-		Material material = Material{Texture::DefaultTexture, Shader::DefaultShader, "default"};
+	// Pass programs that replace the material do not sample its texture
+	const Texture& albedo = ResourceRegistry::Get().UseTexture(material.Albedo, FramePacer::Get().GetFrameIndex());
+	if (!passShader && albedo.GetId() != state.Texture)
+	{
+		state.Texture = albedo.GetId();
+		albedo.Bind(AlbedoUnit);
+		stats.TextureBinds++;
+	}
 
-		if (scene.HasComponent<Material>(entity))
-			material = scene.GetComponent<Material>(entity);
+	const VertexArray& vertexArray = MeshArena::Get().GetVertexArray(GetRange(mesh).Pool);
+	if (vertexArray.GetRendererID() != state.VertexArray)
+	{
+		state.VertexArray = vertexArray.GetRendererID();
+		vertexArray.Bind();
+		stats.VertexArrayBinds++;
+	}
+}
+
+void Renderer::DrawPacketsDirect(size_t first, size_t count)
+{
+	for (size_t i = first; i < first + count; i++)
+	{
+		uniformStream.BindRange(ObjectDataBinding, uniformStream.Push(&queue[i].Model, sizeof(glm::mat4)));
+		stats.UniformUploads++;
 
-		DrawModel(model, material, transform);
+		const Mesh& mesh = GetMesh(queue[i]);
+		const MeshArena::Range& range = GetRange(mesh);
+		const MeshLod& lod = mesh.lods[queue[i].Lod];
+		glDrawElementsBaseVertex(GL_TRIANGLES, lod.IndexCount, GL_UNSIGNED_INT, IndexOffset(range, lod), static_cast<GLint>(range.BaseVertex));
+		stats.DrawCalls++;
 	}
 }
 
+/*
+ * GL 3.3 path. Runs of packets sharing mesh and material are collapsed into one
+ * instanced draw, their model matrices are pushed into the instance ring once
+ * per submit.
+ */
+void Renderer::SubmitBatched(SubmitState& state, size_t rangeFirst, size_t rangeEnd)
+{
+	batches.clear();
+	instanceData.clear();
+
+	for (size_t first = rangeFirst; first < rangeEnd;)
+	{
+		size_t end = first + 1;
+		while (end < rangeEnd && CanInstance(queue[first], queue[end]))
+			end++;
+
+		DrawBatch batch{ first, end - first, 0, nullptr };
+		if (batch.Count >= MinInstanceCount)
+			batch.InstancedShader = GetShaderVariant(GetMaterialShader(GetMaterial(queue[first])), ShaderVariant::Instanced | passVariant);
+
+		if (batch.InstancedShader)
+		{
+			batch.InstanceOffset = static_cast<unsigned int>(instanceData.size() * sizeof(glm::mat4));
+			for (size_t i = first; i < end; i++)
+				instanceData.push_back(queue[i].Model);
+		}
+
+		batches.push_back(batch);
+		first = end;
+	}
+
+	// Streamed into the frame's region, batch offsets are relative to the allocation
+	StreamingBuffer::Allocation instances{ 0, 0 };
+	if (!instanceData.empty())
+	{
+		const unsigned int size = static_cast<unsigned int>(instanceData.size() * sizeof(glm::mat4));
+		instanceStream.Reserve(size);
+		instances = instanceStream.Push(instanceData.data(), size);
+	}
+
+	for (const DrawBatch& batch : batches)
+	{
+		const DrawPacket& packet = queue[batch.First];
+		const Mesh& mesh = GetMesh(packet);
+		const Material& material = GetMaterial(packet);
+		const Shader& shader = batch.InstancedShader ? *batch.InstancedShader : GetPassShader(GetMaterialShader(material));
+
+		ApplyDrawState(shader, material, mesh, state);
+
+		if (!batch.InstancedShader)
+		{
+			DrawPacketsDirect(batch.First, batch.Count);
+			continue;
+		}
+
+		const MeshArena::Range& range = GetRange(mesh);
+		MeshArena::Get().GetVertexArray(range.Pool).AddInstanceBuffer(instanceStream.GetId(), InstanceModel, instances.Offset + batch.InstanceOffset);
+
+		const MeshLod& lod = mesh.lods[packet.Lod];
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.IndexCount, GL_UNSIGNED_INT, IndexOffset(range, lod),
+			static_cast<GLsizei>(batch.Count), static_cast<GLint>(range.BaseVertex));
+		stats.DrawCalls++;
+		stats.InstancedDraws++;
+	}
+}
 
-void Renderer::BeginScene(Camera camera)
+/*
+ * GL 4.6 path. Every packet writes its model matrix into the object storage buffer,
+ * runs of one mesh become a single DrawElementsIndirectCommand whose base instance
+ * points at its first matrix, and each bucket goes out with one multi draw.
+ * Buckets are split by MeshArena pool, every mesh of a pool shares its buffers.
+ */
+void Renderer::SubmitIndirect(SubmitState& state, size_t rangeFirst, size_t rangeEnd)
+{
+	buckets.clear();
+	commands.clear();
+	instanceData.clear();
+
+	for (size_t first = rangeFirst; first < rangeEnd;)
+	{
+		DrawBucket bucket{ first, 0, commands.size(), 0 };
+
+		size_t end = first;
+		while (end < rangeEnd && CanShareBucket(queue[first], queue[end]))
+		{
+			size_t runEnd = end + 1;
+			while (runEnd < rangeEnd && CanInstance(queue[end], queue[runEnd]))
+				runEnd++;
+
+			DrawElementsIndirectCommand command{};
+			const Mesh& mesh = GetMesh(queue[end]);
+			const MeshArena::Range& range = GetRange(mesh);
+			const MeshLod& lod = mesh.lods[queue[end].Lod];
+			command.Count = lod.IndexCount;
+			command.FirstIndex = range.FirstIndex + lod.FirstIndex;
+			command.BaseVertex = static_cast<int>(range.BaseVertex);
+			command.InstanceCount = static_cast<unsigned int>(runEnd - end);
+			command.BaseInstance = static_cast<unsigned int>(instanceData.size());
+			commands.push_back(command);
+
+			for (size_t i = end; i < runEnd; i++)
+				instanceData.push_back(queue[i].Model);
+
+			end = runEnd;
+		}
+
+		bucket.PacketCount = end - first;
+		bucket.CommandCount = commands.size() - bucket.FirstCommand;
+		buckets.push_back(bucket);
+		first = end;
+	}
+
+	if (commands.empty())
+		return;
+
+	// Sub-allocated from the frame's region, nothing is reallocated or written while the GPU reads it
+	const unsigned int objectSize = static_cast<unsigned int>(instanceData.size() * sizeof(glm::mat4));
+	const unsigned int commandSize = static_cast<unsigned int>(commands.size() * sizeof(DrawElementsIndirectCommand));
+	objectStream.Reserve(objectSize);
+	indirectStream.Reserve(commandSize);
+	objectStream.BindRange(0, objectStream.Push(instanceData.data(), objectSize));
+	const StreamingBuffer::Allocation commandAllocation = indirectStream.Push(commands.data(), commandSize);
+	GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectStream.GetId());
+
+	for (const DrawBucket& bucket : buckets)
+	{
+		const DrawPacket& packet = queue[bucket.FirstPacket];
+		const Material& material = GetMaterial(packet);
+		const Shader* shader = GetShaderVariant(GetMaterialShader(material), ShaderVariant::Indirect | passVariant);
+
+		if (!shader)
+		{
+			const Shader& direct = GetPassShader(GetMaterialShader(material));
+			ApplyDrawState(direct, material, GetMesh(packet), state);
+			DrawPacketsDirect(bucket.FirstPacket, bucket.PacketCount);
+			continue;
+		}
+
+		ApplyDrawState(*shader, material, GetMesh(packet), state);
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			reinterpret_cast<const void*>(commandAllocation.Offset + bucket.FirstCommand * sizeof(DrawElementsIndirectCommand)),
+			static_cast<GLsizei>(bucket.CommandCount), 0);
+		stats.DrawCalls++;
+		stats.IndirectCommands += static_cast<unsigned int>(bucket.CommandCount);
+	}
+
+	GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/*
+ * Depth only pass per cascade that needs it. Casters come from the spatial index
+ * with the cascade's light frustum, which reaches casterExtrusion units toward the
+ * light past the slice. Meshes use the coarsest level whose error stays under a
+ * shadow map texel.
+ */
+void Renderer::RenderShadows(Scene& scene)
+{
+	// Before the shadow map is created, creating its framebuffer changes the binding
+	const unsigned int previousFramebuffer = GLStateCache::GetFramebuffer();
+	GLint viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	if (!shadowMap)
+	{
+		shadowMap = std::make_unique<CascadedShadowMap>();
+		shadowShader = Shader("res/shaders/shadow.glsl");
+		lightViewProjectionUniform = shadowShader.GetUniform<glm::mat4>("uLightViewProjection");
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	}
+
+	// Moving objects only show up in the cached cascades on their periodic refresh
+	SpatialIndex& spatialIndex = scene.GetSpatialIndex();
+	const uint32_t dirty = shadowMap->Update(camera, sunDirection, spatialIndex.GetStaticVersion(), frameIndex);
+	if (dirty == 0)
+		return;
+
+	GpuProfileScope profileScope("Shadows");
+
+	FrameBuffer& target = shadowMap->GetTarget();
+	GLStateCache::Viewport(0, 0, target.GetWidth(), target.GetHeight());
+	GLStateCache::SetDepthTest(true);
+	GLStateCache::SetDepthWrite(true);
+	GLStateCache::SetBlend(false);
+	shadowShader.Bind();
+	stats.ShaderBinds++;
+
+	const ResourceRegistry& resources = ResourceRegistry::Get();
+	const unsigned int matrixSize = uniformStream.GetAlignedSize(sizeof(glm::mat4));
+
+	for (int i = 0; i < CascadedShadowMap::CascadeCount; i++)
+	{
+		if (!(dirty & (1u << i)))
+			continue;
+
+		const CascadedShadowMap::Cascade& cascade = shadowMap->GetCascade(i);
+		const Frustum casterFrustum = Frustum::FromMatrix(cascade.ViewProjection);
+		const float texel = 2.0f * cascade.Radius / static_cast<float>(shadowMap->GetResolution());
+
+		target.BindLayer(i);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		if (shadowShader.Set(lightViewProjectionUniform, cascade.ViewProjection))
+			stats.UniformUploads++;
+
+		shadowCasters.clear();
+		spatialIndex.Query(casterFrustum, shadowCasters);
+
+		size_t meshCount = 0;
+		for (entt::entity entity : shadowCasters)
+			meshCount += scene.GetComponent<Model>(entity).GetMeshes().size();
+		uniformStream.Reserve(matrixSize * static_cast<unsigned int>(meshCount));
+
+		for (entt::entity entity : shadowCasters)
+		{
+			const glm::mat4 modelMatrix = scene.GetComponent<Transform>(entity).GetModel();
+
+			for (MeshHandle handle : scene.GetComponent<Model>(entity).GetMeshes())
+			{
+				const Mesh* meshPtr = resources.GetMesh(handle);
+				if (!meshPtr || !casterFrustum.Intersects(meshPtr->bounds.Transformed(modelMatrix)))
+					continue;
+
+				const Mesh& mesh = *meshPtr;
+
+				const float scale = mesh.sphere.Radius > 0.0f ? mesh.sphere.Transformed(modelMatrix).Radius / mesh.sphere.Radius : 1.0f;
+				size_t level = 0;
+				while (level + 1 < mesh.lods.size() && mesh.lods[level + 1].Error * scale <= texel)
+					level++;
+				const MeshLod& lod = mesh.lods[level];
+
+				const glm::mat4 drawMatrix = modelMatrix * mesh.positionDecode;
+				uniformStream.BindRange(ObjectDataBinding, uniformStream.Push(&drawMatrix, sizeof(glm::mat4)));
+				const MeshArena::Range& range = GetRange(mesh);
+				MeshArena::Get().GetVertexArray(range.Pool).Bind();
+				glDrawElementsBaseVertex(GL_TRIANGLES, lod.IndexCount, GL_UNSIGNED_INT, IndexOffset(range, lod), static_cast<GLint>(range.BaseVertex));
+				stats.ShadowDrawCalls++;
+			}
+		}
+
+		stats.ShadowCasters += static_cast<unsigned int>(shadowCasters.size());
+		stats.ShadowCascadesRendered++;
+	}
+
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	GLStateCache::Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+/*
+ * Everything shared by all draws of the frame goes into the FrameData, ViewData
+ * and LightData blocks once, instead of loose uniforms on every program. The
+ * blocks are streamed like the per-draw ones, frames in flight keep reading theirs.
+ */
+void Renderer::UploadSceneUniforms()
+{
+	GLint viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	const double time = glfwGetTime();
+	FrameUniforms frame{};
+	frame.Time = static_cast<float>(time);
+	frame.DeltaTime = lastFrameTime > 0.0 ? static_cast<float>(time - lastFrameTime) : 0.0f;
+	frame.Resolution = glm::vec2(static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+	lastFrameTime = time;
+	viewportSize = frame.Resolution;
+
+	ViewUniforms view{};
+	view.View = camera.GetView();
+	view.Projection = camera.GetProjection();
+	view.ViewProjection = view.Projection * view.View;
+	view.CameraPosition = glm::vec4(camera.GetTransform().position, 1.0f);
+	view.InverseViewProjection = glm::inverse(view.ViewProjection);
+
+	uniformStream.BindRange(FrameDataBinding, uniformStream.Push(&frame, sizeof(FrameUniforms)));
+	uniformStream.BindRange(ViewDataBinding, uniformStream.Push(&view, sizeof(ViewUniforms)));
+	stats.UniformUploads += 2;
+}
+
+void Renderer::AddLight(const glm::vec3& position, const PointLight& light)
+{
+	lights.push_back(LightGrid::Light{ glm::vec4(position, light.radius), glm::vec4(light.color, light.intensity) });
+}
+
+void Renderer::SetDirectionalLight(const glm::vec3& direction, const DirectionalLight& light)
+{
+	sunDirection = glm::normalize(direction);
+	sunColor = glm::vec4(light.color, light.intensity);
+	sunShadows = light.castShadows;
+}
+
+/*
+ * Lights are only known once the scene has been walked, so the froxel grid is
+ * built at flush time, right before anything is drawn.
+ */
+void Renderer::UploadLights()
+{
+	lightGrid.Build(camera.GetView(), camera.GetProjection(), camera.GetNear(), camera.GetFar(), lights);
+
+	const std::vector<glm::uvec2>& clusters = lightGrid.GetClusters();
+	const std::vector<uint32_t>& indices = lightGrid.GetLightIndices();
+
+	// The set written here is next written MaxFramesInFlight frames on, when the GPU is done with it
+	const uint64_t frame = FramePacer::Get().GetFrameIndex();
+	lightFlush = frame == lightFrame ? lightFlush + 1 : 0;
+	lightFrame = frame;
+	const size_t slot = static_cast<size_t>(lightFlush) * FramePacer::MaxFramesInFlight + FramePacer::Get().GetFrameSlot();
+	while (lightBuffers.size() <= slot)
+	{
+		// Clusters are fixed, indices are capped by the grid at what GL_MAX_TEXTURE_BUFFER_SIZE allows
+		lightBuffers.push_back(LightBuffers{
+			TextureBuffer(GL_RGBA32F, InitialLightCapacity * sizeof(LightGrid::Light)),
+			TextureBuffer(GL_RG32UI, LightGrid::ClusterCount * sizeof(glm::uvec2)),
+			TextureBuffer(GL_R32UI, static_cast<unsigned int>(std::min(lightGrid.GetMaxLightIndices(), InitialLightIndexCapacity) * sizeof(uint32_t))) });
+	}
+	LightBuffers& buffers = lightBuffers[slot];
+
+	buffers.Lights.UploadData(lights.data(), static_cast<unsigned int>(lights.size() * sizeof(LightGrid::Light)));
+	buffers.Clusters.UploadData(clusters.data(), static_cast<unsigned int>(clusters.size() * sizeof(glm::uvec2)));
+	buffers.Indices.UploadData(indices.data(), static_cast<unsigned int>(indices.size() * sizeof(uint32_t)));
+
+	buffers.Lights.Bind(LightBufferUnit);
+	buffers.Clusters.Bind(ClusterBufferUnit);
+	buffers.Indices.Bind(LightIndexBufferUnit);
+
+	LightUniforms light{};
+	light.AmbientLight = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+	light.ClusterGrid = glm::uvec4(LightGrid::TilesX, LightGrid::TilesY, LightGrid::Slices, static_cast<unsigned int>(lights.size()));
+	light.ClusterDepth = glm::vec4(lightGrid.GetSliceParameters(), 0.0f, 0.0f);
+
+	const bool shadowed = shadows && sunShadows && shadowMap;
+	light.SunDirection = glm::vec4(sunDirection, shadowed ? 1.0f : 0.0f);
+	light.SunColor = sunColor;
+	if (shadowed)
+	{
+		// Clip space to texture space
+		const glm::mat4 bias(0.5f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.5f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.5f, 0.0f,
+			0.5f, 0.5f, 0.5f, 1.0f);
+
+		for (int i = 0; i < CascadedShadowMap::CascadeCount; i++)
+		{
+			const CascadedShadowMap::Cascade& cascade = shadowMap->GetCascade(i);
+			light.CascadeSplits[i] = cascade.SplitDepth;
+			light.ShadowMatrices[i] = bias * cascade.ViewProjection;
+		}
+
+		light.ShadowParams = glm::vec4(0.0005f, 1.5f, 1.0f / shadowMap->GetResolution(), CascadedShadowMap::CascadeCount);
+		GLStateCache::BindTexture(ShadowMapUnit, GL_TEXTURE_2D_ARRAY, shadowMap->GetTarget().GetDepthTextureId());
+	}
+
+	uniformStream.BindRange(LightDataBinding, uniformStream.Push(&light, sizeof(LightUniforms)));
+	stats.UniformUploads++;
+
+	stats.PointLights = static_cast<unsigned int>(lights.size());
+	stats.LightAssignments = static_cast<unsigned int>(indices.size());
+	stats.LightAssignmentsDropped = static_cast<unsigned int>(lightGrid.GetDroppedAssignments());
+}
+
+void Renderer::CullCandidates()
+{
+	const size_t queued = queue.Size();
+	if (!frustumCulling)
+	{
+		for (const DrawPacket& packet : candidates)
+			queue.Push(packet);
+	}
+	else
+	{
+		visible.clear();
+		culler.Cull(frustum, visible);
+
+		for (uint32_t index : visible)
+			queue.Push(candidates[index]);
+	}
+
+	stats.MeshesCulled += static_cast<unsigned int>(candidates.size() - (queue.Size() - queued));
+	for (size_t i = 0; i < queue.Size(); i++)
+	{
+		const DrawPacket& packet = queue[i];
+		stats.TrianglesSubmitted += GetMesh(packet).lods[packet.Lod].IndexCount / 3;
+		if (packet.Lod > 0)
+			stats.MeshesLodReduced++;
+	}
+	candidates.clear();
+	culler.Clear();
+}
+
+// Translucent packets sort after all opaque ones
+size_t Renderer::FindTranslucentStart() const
+{
+	size_t first = 0;
+	while (first < queue.Size() && !RenderQueue::IsTranslucent(queue[first].Key))
+		first++;
+	return first;
+}
+
+/*
+ * With the pre-pass the opaque range is drawn twice: once with the position only
+ * depth program and color writes off, then with the material programs against
+ * the finished depth buffer, so every pixel is shaded once. Whichever pass
+ * writes depth is wrapped in a sample count query, which is the overdraw the
+ * shading pass would have had without the pre-pass.
+ */
+void Renderer::SubmitOpaque(SubmitState& state, size_t first, size_t end)
+{
+	if (first == end)
+		return;
+
+	const bool prepass = depthPrepassMode == DepthPrepassMode::On
+		|| (depthPrepassMode == DepthPrepassMode::Auto && autoPrepass);
+	stats.DepthPrepass = prepass;
+
+	const bool measure = overdrawQueriesPending < OverdrawQueryCount;
+	if (measure)
+	{
+		const size_t slot = (overdrawQueryIndex + overdrawQueriesPending) % OverdrawQueryCount;
+		if (!overdrawQueries[slot])
+			overdrawQueries[slot] = GLQuery::Create();
+		overdrawPixels[slot] = viewportSize.x * viewportSize.y;
+		glBeginQuery(GL_SAMPLES_PASSED, overdrawQueries[slot].Get());
+		overdrawQueriesPending++;
+	}
+
+	if (!prepass)
+	{
+		Submit(state, first, end);
+		if (measure)
+			glEndQuery(GL_SAMPLES_PASSED);
+		return;
+	}
+
+	if (depthShader.GetId() == 0)
+		depthShader = Shader("res/shaders/depth.glsl");
+
+	const uint8_t variant = passVariant;
+	const unsigned int drawCalls = stats.DrawCalls;
+	passShader = &depthShader;
+	passVariant = 0;
+	GLStateCache::SetColorWrite(false);
+
+	Submit(state, first, end);
+
+	GLStateCache::SetColorWrite(true);
+	passShader = nullptr;
+	passVariant = variant;
+	stats.DepthPrepassDraws += stats.DrawCalls - drawCalls;
+	if (measure)
+		glEndQuery(GL_SAMPLES_PASSED);
+
+	// Same packets with their own programs, only where the pre-pass left the nearest depth
+	state = SubmitState();
+	GLStateCache::SetDepthWrite(false);
+	GLStateCache::SetDepthFunc(depthPrepassEqual ? GL_EQUAL : GL_LEQUAL);
+	Submit(state, first, end);
+	GLStateCache::SetDepthFunc(GL_LESS);
+	GLStateCache::SetDepthWrite(true);
+}
+
+// Collects the finished overdraw measurements without waiting on the ones still in flight
+void Renderer::ReadOverdraw()
+{
+	while (overdrawQueriesPending > 0)
+	{
+		const unsigned int query = overdrawQueries[overdrawQueryIndex].Get();
+		GLuint available = 0;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint samples = 0;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+		overdraw = static_cast<float>(samples) / std::max(overdrawPixels[overdrawQueryIndex], 1.0f);
+
+		overdrawQueryIndex = (overdrawQueryIndex + 1) % OverdrawQueryCount;
+		overdrawQueriesPending--;
+	}
+
+	if (overdraw > PrepassEnableOverdraw)
+		autoPrepass = true;
+	else if (overdraw < PrepassDisableOverdraw)
+		autoPrepass = false;
+}
+
+void Renderer::Submit(SubmitState& state, size_t first, size_t end)
+{
+	if (first == end)
+		return;
+
+	if (indirectDraw)
+		SubmitIndirect(state, first, end);
+	else
+		SubmitBatched(state, first, end);
+}
+
+/*
+ * Opaque packets are drawn into transient G-buffer targets with the GBUFFER
+ * variants, then one fullscreen pass lights every covered pixel and copies the
+ * G-buffer depth into the view through gl_FragDepth. The targets only live
+ * between the two passes, so the graph can hand their textures to later passes.
+ */
+void Renderer::AddDeferredPasses(SubmitState& state, const Shader& lightingShader, size_t opaqueEnd, RenderGraphResource view)
+{
+	const int width = std::max(1, static_cast<int>(viewportSize.x));
+	const int height = std::max(1, static_cast<int>(viewportSize.y));
+
+	RenderGraphResource albedo = RenderGraph::InvalidResource;
+	RenderGraphResource normal = RenderGraph::InvalidResource;
+	RenderGraphResource depth = RenderGraph::InvalidResource;
+
+	renderGraph.AddPass("GBuffer", [&](RenderGraph::Builder& builder)
+	{
+		albedo = builder.Write(builder.Create("GBufferAlbedo", { width, height, FrameBufferFormat::RGBA8 }), LoadOp::Clear);
+		normal = builder.Write(builder.Create("GBufferNormal", { width, height, FrameBufferFormat::RGB10A2 }), LoadOp::Clear);
+		depth = builder.Write(builder.Create("GBufferDepth", { width, height, FrameBufferFormat::Depth24 }), LoadOp::Clear);
+	},
+	[this, &state, opaqueEnd](const RenderGraph::Context&)
+	{
+		passVariant = ShaderVariant::GBuffer;
+		SubmitOpaque(state, 0, opaqueEnd);
+		passVariant = 0;
+	});
+
+	renderGraph.AddPass("DeferredLighting", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(albedo);
+		builder.Read(normal);
+		builder.Read(depth);
+		builder.Write(view);
+	},
+	[this, &state, &lightingShader, albedo, normal, depth](const RenderGraph::Context& context)
+	{
+		lightingShader.Bind();
+		stats.ShaderBinds++;
+		GLStateCache::BindTexture(GBufferAlbedoUnit, GL_TEXTURE_2D, context.GetTexture(albedo));
+		GLStateCache::BindTexture(GBufferNormalUnit, GL_TEXTURE_2D, context.GetTexture(normal));
+		GLStateCache::BindTexture(GBufferDepthUnit, GL_TEXTURE_2D, context.GetTexture(depth));
+		stats.TextureBinds += 3;
+
+		GLStateCache::SetDepthFunc(GL_ALWAYS);
+		quadVA.Bind();
+		quadIB.Bind();
+		glDrawElements(GL_TRIANGLES, quadIB.GetCount(), GL_UNSIGNED_INT, nullptr);
+		GLStateCache::SetDepthFunc(GL_LESS);
+		stats.DrawCalls++;
+
+		// The quad replaced program and vertex array, the translucent draws start over
+		state = SubmitState();
+	});
+}
+
+void Renderer::FlushQueue()
+{
+	ReadOverdraw();
+	UploadLights();
+	CullCandidates();
+	queue.Sort();
+
+	// Worst case every packet is drawn directly and streams its own model matrix
+	uniformStream.Reserve(uniformStream.GetAlignedSize(sizeof(glm::mat4)) * static_cast<unsigned int>(queue.Size()));
+
+	SubmitState state;
+	const Shader* lightingShader = renderPath == RenderPath::Deferred
+		? GetShaderVariant(Shader::DefaultShader, ShaderVariant::DeferredLighting)
+		: nullptr;
+
+	const size_t opaqueEnd = FindTranslucentStart();
+
+	// The view is whatever framebuffer the caller bound, its owner consumes it
+	GLint viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	renderGraph.Reset();
+	const RenderGraphResource view = renderGraph.ImportFramebuffer("View", GLStateCache::GetFramebuffer(),
+		glm::ivec4(viewport[0], viewport[1], viewport[2], viewport[3]));
+
+	if (lightingShader)
+	{
+		AddDeferredPasses(state, *lightingShader, opaqueEnd, view);
+	}
+	else
+	{
+		renderGraph.AddPass("Opaque", [view](RenderGraph::Builder& builder) { builder.Write(view); },
+			[this, &state, opaqueEnd](const RenderGraph::Context&) { SubmitOpaque(state, 0, opaqueEnd); });
+	}
+
+	renderGraph.AddPass("Translucent", [view](RenderGraph::Builder& builder) { builder.Write(view); },
+		[this, &state, opaqueEnd](const RenderGraph::Context&) { Submit(state, opaqueEnd, queue.Size()); });
+
+	renderGraph.Compile();
+	renderGraph.Execute();
+
+	const RenderGraph::Stats& graphStats = renderGraph.GetStats();
+	stats.RenderPasses = graphStats.Passes;
+	stats.RenderPassesCulled = graphStats.PassesCulled;
+	stats.TransientTextures = graphStats.TransientTextures;
+	stats.RenderTargetTextures = graphStats.PooledTextures;
+	stats.RenderTargetMemory = static_cast<unsigned int>(graphStats.PooledBytes / 1024);
+	stats.Overdraw = overdraw;
+
+	if (state.Blending)
+	{
+		GLStateCache::SetBlend(false);
+		GLStateCache::SetDepthWrite(true);
+	}
+	GLStateCache::BindVertexArray(0);
+
+	stats.MeshesSubmitted = static_cast<unsigned int>(queue.Size());
+	stats.StateCallsIssued = GLStateCache::GetCounters().Issued;
+	stats.RedundantCallsSkipped = GLStateCache::GetCounters().Skipped;
+
+	queue.Clear();
+}
+
+
+void Renderer::BeginScene(Camera camera, RenderPath path)
 {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glClearColor(0.529f,0.808f,0.922f, 1.0);
 
 	this->camera = camera;
+	renderPath = path;
+	viewProjection = camera.GetProjection() * camera.GetView();
+	frustum = Frustum::FromMatrix(viewProjection);
+	this->stats = RenderStats();
+
+	frameIndex++;
+	if (frameIndex % LodHistoryFrames == 0)
+	{
+		for (LodHistory& history : lodHistory)
+		{
+			if (history.Entity != entt::null && frameIndex - history.Frame > LodHistoryFrames)
+				history = LodHistory();
+		}
+	}
+	GLStateCache::ResetCounters();
+	queue.Clear();
+	candidates.clear();
+	culler.Clear();
+	lights.clear();
+	sunColor = glm::vec4(0.0f);
+	sunShadows = false;
+	const uint64_t streamFrame = FramePacer::Get().GetFrameIndex();
+	uniformStream.BeginFrame(streamFrame);
+	instanceStream.BeginFrame(streamFrame);
+	objectStream.BeginFrame(streamFrame);
+	indirectStream.BeginFrame(streamFrame);
+
+	UploadSceneUniforms();
 }
 
 void Renderer::EndScene()
 {
-	
+	FlushQueue();
+	uniformStream.EndFrame();
+	instanceStream.EndFrame();
+	objectStream.EndFrame();
+	indirectStream.EndFrame();
 }
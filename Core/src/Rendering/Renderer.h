@@ -4,46 +4,350 @@
 #include "Scene.h"
 #include "Camera.h"
 #include <memory>
+#include <unordered_map>
 
 #include "Model.h"
+#include "ResourceRegistry.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "LightGrid.h"
+#include "CascadedShadowMap.h"
+#include "RenderGraph.h"
 
 
-struct PointLight
+struct RenderStats
 {
-	glm::vec3 Position;
-	glm::vec3 Color;
-	float Intensity;
+	unsigned int MeshesSubmitted = 0;
+	unsigned int MeshesCulled = 0;
+	unsigned int EntitiesCulled = 0;
+	unsigned int EntitiesOccluded = 0;
+	unsigned int OccluderTriangles = 0;
+	unsigned int TrianglesSubmitted = 0;
+	unsigned int PointLights = 0;
+	// Entries in the froxel light lists, a light is counted once per froxel it touches
+	unsigned int LightAssignments = 0;
+	// Assignments that did not fit the light index buffer, their froxels miss those lights
+	unsigned int LightAssignmentsDropped = 0;
+	unsigned int ShadowCascadesRendered = 0;
+	unsigned int ShadowCasters = 0;
+	unsigned int ShadowDrawCalls = 0;
+	unsigned int DepthPrepassDraws = 0;
+	unsigned int RenderPasses = 0;
+	unsigned int RenderPassesCulled = 0;
+	unsigned int TransientTextures = 0;
+	// Pooled render target textures and their size in KiB, transients alias onto them
+	unsigned int RenderTargetTextures = 0;
+	unsigned int RenderTargetMemory = 0;
+	// Whether this frame ran the depth pre-pass
+	bool DepthPrepass = false;
+	// Opaque fragments that passed depth testing per pixel, from the latest finished measurement
+	float Overdraw = 0.0f;
+	// Meshes drawn below their full detail
+	unsigned int MeshesLodReduced = 0;
+	unsigned int DrawCalls = 0;
+	unsigned int InstancedDraws = 0;
+	unsigned int IndirectCommands = 0;
+	unsigned int ShaderBinds = 0;
+	unsigned int TextureBinds = 0;
+	unsigned int VertexArrayBinds = 0;
+	unsigned int UniformUploads = 0;
+
+	// GL calls GLStateCache passed on because the state changed
+	unsigned int StateCallsIssued = 0;
+	// GL calls dropped by GLStateCache because the state was already set
+	unsigned int RedundantCallsSkipped = 0;
 };
 
-struct SceneLightInfo
+
+// How a view turns visible geometry into lit pixels
+enum class RenderPath : uint8_t
 {
-	std::vector<PointLight> PointLights;
+	// Every fragment is shaded as it is rasterized
+	Forward,
+	// Opaque geometry writes albedo and normals first, a fullscreen pass lights each pixel once.
+	// Translucent geometry is still drawn forward on top
+	Deferred
 };
 
+// Depth only pass over the opaque geometry before it is shaded
+enum class DepthPrepassMode : uint8_t
+{
+	Off,
+	On,
+	// Turned on while the measured overdraw is high
+	Auto
+};
 
 class Renderer
 {
 public:
 	Renderer();
-	~Renderer() {}
 
-	void SetupShaderUniforms(Material material, Transform transform);
-
-	void BeginScene(Camera camera);
+	void BeginScene(Camera camera, RenderPath path = RenderPath::Forward);
 	void DrawQuad(Shader& shader);
-	void DrawModel(const Model& model, Material material, const Transform& tranform);
+	void DrawModel(const Model& model, MaterialHandle material, const Transform& tranform);
 	void DrawScene(Scene& scene);
 	void EndScene();
 
-	void AddLight(PointLight light) {
-		sceneLight.PointLights.push_back(light);
-	}
+	const RenderStats& GetStats() const { return stats; }
 
-public:
-	SceneLightInfo sceneLight;//example
+	// Multi draw indirect submission, only takes effect on a 4.6 context
+	void SetIndirectDraw(bool enabled);
+	bool IsIndirectDraw() const { return indirectDraw; }
+
+	void SetFrustumCulling(bool enabled) { frustumCulling = enabled; }
+	bool IsFrustumCulling() const { return frustumCulling; }
+
+	// Software occlusion culling of whole entities against the biggest ones on screen
+	void SetOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+	bool IsOcclusionCulling() const { return occlusionCulling; }
 
+	// Picks a simplified level per mesh once its error projects below the threshold
+	void SetMeshLod(bool enabled) { meshLod = enabled; }
+	bool IsMeshLod() const { return meshLod; }
+	void SetLodPixelError(float pixels) { lodPixelError = pixels; }
+	float GetLodPixelError() const { return lodPixelError; }
+
+	// Lights for the current frame, DrawScene adds every PointLight in the scene
+	void AddLight(const glm::vec3& position, const PointLight& light);
+	// Sun for the current frame, DrawScene uses the first DirectionalLight in the scene
+	void SetDirectionalLight(const glm::vec3& direction, const DirectionalLight& light);
+
+	// Cascaded shadows from the directional light, rendered by DrawScene
+	void SetShadows(bool enabled) { shadows = enabled; }
+	bool IsShadows() const { return shadows; }
+	// Created on the first frame with a shadow casting light
+	CascadedShadowMap* GetShadowMap() { return shadowMap.get(); }
+	// Rebuilt by every EndScene, the view passes render into the framebuffer bound at that point
+	const RenderGraph& GetRenderGraph() const { return renderGraph; }
+	// Call when the size the scene is rendered at changes, frees the targets made for the old size
+	void OnRenderSizeChanged(const glm::ivec2& previousSize) { renderGraph.RetireSize(previousSize); }
+
+	// After the pre-pass the opaque geometry is shaded with depth writes off, so
+	// only the visible fragment of each pixel runs the material shader
+	void SetDepthPrepass(DepthPrepassMode mode) { depthPrepassMode = mode; }
+	DepthPrepassMode GetDepthPrepass() const { return depthPrepassMode; }
+	// GL_EQUAL instead of GL_LEQUAL in the shading pass, exact since both programs use invariant positions
+	void SetDepthPrepassEqualTest(bool enabled) { depthPrepassEqual = enabled; }
+	bool IsDepthPrepassEqualTest() const { return depthPrepassEqual; }
+
+public:
 	VertexArray quadVA;
 	IndexBuffer quadIB;
+	VertexBuffer quadVertexBuffer;
+	VertexBuffer quadUVBuffer;
 	Camera camera;
+
+private:
+	// Flags, every combination is compiled from the same source with matching defines
+	enum ShaderVariant : uint8_t
+	{
+		Instanced = 1 << 0,
+		Indirect = 1 << 1,
+		GBuffer = 1 << 2,
+		DeferredLighting = 1 << 3
+	};
+
+	struct SubmitState
+	{
+		unsigned int Shader = 0;
+		unsigned int Texture = 0;
+		unsigned int VertexArray = 0;
+		bool Blending = false;
+	};
+
+	struct DrawBatch
+	{
+		size_t First;
+		size_t Count;
+		unsigned int InstanceOffset;
+		const Shader* InstancedShader;
+	};
+
+	// std140 mirrors of the shared uniform blocks in the shaders
+	struct FrameUniforms
+	{
+		float Time;
+		float DeltaTime;
+		glm::vec2 Resolution;
+	};
+
+	struct ViewUniforms
+	{
+		glm::mat4 View;
+		glm::mat4 Projection;
+		glm::mat4 ViewProjection;
+		glm::vec4 CameraPosition;
+		glm::mat4 InverseViewProjection;
+	};
+
+	struct LightUniforms
+	{
+		glm::vec4 AmbientLight;
+		glm::uvec4 ClusterGrid;  // tiles x, tiles y, slices, light count
+		glm::vec4 ClusterDepth;  // slice = log(depth) * x + y
+		glm::vec4 SunDirection;  // w is 1 when it casts shadows
+		glm::vec4 SunColor;      // w is the intensity, 0 without a sun
+		glm::vec4 CascadeSplits;
+		glm::vec4 ShadowParams;  // depth bias, normal bias, texel size, cascade count
+		glm::mat4 ShadowMatrices[CascadedShadowMap::CascadeCount];
+	};
+
+	// Last level picked per mesh of an entity, for hysteresis
+	struct LodHistory
+	{
+		entt::entity Entity = entt::null;
+		uint64_t Frame = 0;
+		std::vector<uint8_t> Levels;
+	};
+
+	// Packets of one slice of the visible entities, written by whichever worker runs
+	// the slice and merged in slice order. Kept across frames so nothing allocates
+	// once the scene is steady
+	struct PacketArena
+	{
+		std::vector<DrawPacket> Packets;
+		FrustumCuller Culler;
+		std::vector<uint32_t> Visible;
+		size_t Generated = 0;
+	};
+
+	struct DrawBucket
+	{
+		size_t FirstPacket;
+		size_t PacketCount;
+		size_t FirstCommand;
+		size_t CommandCount;
+	};
+
+	// Runs shorter than this are cheaper to draw one by one than to stream
+	static constexpr size_t MinInstanceCount = 2;
+	// Per region of the uniform and instance rings, grown on demand
+	static constexpr unsigned int UniformStreamSize = 1 << 20;
+	static constexpr unsigned int InstanceStreamSize = 1 << 20;
+	// Per region of the indirect path's object and command rings, grown on demand
+	static constexpr unsigned int ObjectStreamSize = 1 << 20;
+	static constexpr unsigned int IndirectStreamSize = 1 << 16;
+	// Starting capacity of the light texture buffers, they grow when a frame needs more
+	static constexpr unsigned int InitialLightCapacity = 1024;
+	static constexpr size_t InitialLightIndexCapacity = 1 << 18;
+	// Occluders rasterized per frame, flagged ones first and then the largest on screen
+	static constexpr size_t MaxOccluders = 32;
+	// A level changes once its projected error is this far past the threshold
+	static constexpr float LodHysteresis = 0.25f;
+	// Auto mode turns the pre-pass on above the first overdraw and off below the second
+	static constexpr float PrepassEnableOverdraw = 1.6f;
+	static constexpr float PrepassDisableOverdraw = 1.25f;
+	// Sample count queries in flight, results are read a few frames late instead of stalling
+	static constexpr size_t OverdrawQueryCount = 4;
+	// Slices smaller than this are not worth handing to another thread
+	static constexpr size_t MinEntitiesPerArena = 256;
+	// Entities not drawn for this many frames forget their levels
+	static constexpr uint64_t LodHistoryFrames = 256;
+	static constexpr uint8_t NoLod = 0xff;
+
+	void FlushQueue();
+	void CullCandidates();
+	void OccludeEntities(Scene& scene);
+	void GeneratePackets(Scene& scene);
+	void UploadSceneUniforms();
+	void UploadLights();
+	void RenderShadows(Scene& scene);
+	void Submit(SubmitState& state, size_t first, size_t end);
+	void SubmitBatched(SubmitState& state, size_t first, size_t end);
+	void SubmitIndirect(SubmitState& state, size_t first, size_t end);
+	void SubmitOpaque(SubmitState& state, size_t first, size_t end);
+	void AddDeferredPasses(SubmitState& state, const Shader& lightingShader, size_t opaqueEnd, RenderGraphResource view);
+	size_t FindTranslucentStart() const;
+	void ReadOverdraw();
+	void ApplyDrawState(const Shader& shader, const Material& material, const Mesh& mesh, SubmitState& state);
+	void DrawPacketsDirect(size_t first, size_t count);
+	void AppendPackets(const Model& model, MaterialHandle materialHandle, const glm::mat4& modelMatrix, std::vector<uint8_t>* lodHistory,
+		std::vector<DrawPacket>& packets, FrustumCuller& packetCuller) const;
+	uint8_t SelectLod(const Mesh& mesh, const glm::mat4& modelMatrix, uint8_t previous) const;
+	const Shader* GetShaderVariant(const Shader& shader, uint8_t variant);
+	const Shader& GetPassShader(const Shader& shader);
+	const Shader& GetMaterialShader(const Material& material) const { return passShader ? *passShader : ResourceRegistry::Get().ResolveShader(material.Shader); }
+
+	RenderQueue queue;
+	RenderStats stats;
+	MaterialHandle defaultMaterial;
+	bool indirectDraw = false;
+	bool frustumCulling = true;
+	bool occlusionCulling = true;
+	bool meshLod = true;
+	float lodPixelError = 1.0f;
+	uint64_t frameIndex = 0;
+	glm::vec2 viewportSize = glm::vec2(1.0f);
+	RenderPath renderPath = RenderPath::Forward;
+	// Variant flags every draw of the current pass is compiled with
+	uint8_t passVariant = 0;
+	// Replaces every material's program during the current pass
+	const Shader* passShader = nullptr;
+	RenderGraph renderGraph;
+	// Indexed by entity index, the stored entity tells a recycled index apart
+	std::vector<LodHistory> lodHistory;
+
+	// Everything drawn this frame, culled in one batch before it is queued
+	std::vector<DrawPacket> candidates;
+	std::vector<uint32_t> visible;
+	std::vector<entt::entity> sceneEntities;
+	std::vector<PacketArena> arenas;
+	FrustumCuller culler;
+	Frustum frustum;
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+
+	OcclusionCuller occlusionCuller;
+	std::vector<AABB> entityBounds;
+	std::vector<uint8_t> entityVisible;
+	std::vector<float> occluderScores;
+	std::vector<std::pair<float, size_t>> occluderCandidates;
+
+	std::vector<DrawBatch> batches;
+	std::vector<DrawBucket> buckets;
+	std::vector<glm::mat4> instanceData;
+	std::vector<DrawElementsIndirectCommand> commands;
+	// Instance matrices of the batched path
+	StreamingBuffer instanceStream;
+	// Model matrices and draw commands of the indirect path, only created where it is supported
+	StreamingBuffer objectStream;
+	StreamingBuffer indirectStream;
+	// FrameData, ViewData, LightData and ObjectData blocks, never written in place
+	StreamingBuffer uniformStream;
+
+	std::vector<LightGrid::Light> lights;
+	LightGrid lightGrid;
+	struct LightBuffers
+	{
+		TextureBuffer Lights;
+		TextureBuffer Clusters;
+		TextureBuffer Indices;
+	};
+	// One set per frame in flight and flush of the frame, each written in place
+	std::vector<LightBuffers> lightBuffers;
+	uint64_t lightFrame = 0;
+	unsigned int lightFlush = 0;
+
+	bool shadows = true;
+	bool sunShadows = false;
+	glm::vec3 sunDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec4 sunColor = glm::vec4(0.0f);
+	std::unique_ptr<CascadedShadowMap> shadowMap;
+	Shader shadowShader;
+	UniformHandle<glm::mat4> lightViewProjectionUniform;
+	std::vector<entt::entity> shadowCasters;
+	Shader depthShader;
+	DepthPrepassMode depthPrepassMode = DepthPrepassMode::Off;
+	bool depthPrepassEqual = false;
+	bool autoPrepass = false;
+	float overdraw = 0.0f;
+	GLQuery overdrawQueries[OverdrawQueryCount];
+	float overdrawPixels[OverdrawQueryCount] = {};
+	size_t overdrawQueryIndex = 0;
+	size_t overdrawQueriesPending = 0;
+	double lastFrameTime = 0.0;
+	// By shader file, then by variant
+	std::unordered_map<std::string, std::unordered_map<uint8_t, Shader>> shaderVariants;
 };
 
@@ -0,0 +1,147 @@
+#ifndef RESOURCEPOOL_H
+#define RESOURCEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * 32 bit reference into a ResourcePool: slot index in the low bits, generation in
+ * the high ones. Destroying a resource bumps its slot's generation, so handles to
+ * it stop resolving instead of silently pointing at whatever reuses the slot.
+ * Zero is never a live handle.
+ */
+template<typename Tag>
+struct ResourceHandle
+{
+	static constexpr uint32_t IndexBits = 20;
+	static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+	static constexpr uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+	uint32_t Value = 0;
+
+	ResourceHandle() = default;
+	ResourceHandle(uint32_t index, uint32_t generation) : Value((generation << IndexBits) | index) {}
+
+	uint32_t GetIndex() const { return Value & IndexMask; }
+	uint32_t GetGeneration() const { return Value >> IndexBits; }
+	bool IsNull() const { return Value == 0; }
+
+	bool operator==(const ResourceHandle& other) const { return Value == other.Value; }
+	bool operator!=(const ResourceHandle& other) const { return Value != other.Value; }
+};
+
+/*
+ * Resources stored densely, so a pass over all of them walks one array. Handles
+ * go through a slot table to the dense index; destroying moves the last resource
+ * into the hole. Pointers from Get stay valid until the next Create or Destroy.
+ */
+template<typename T, typename Tag>
+class ResourcePool
+{
+public:
+	using Handle = ResourceHandle<Tag>;
+
+private:
+	struct Slot
+	{
+		uint32_t Dense = 0;
+		// Generation of the slot's current or next resource, never 0
+		uint32_t Generation = 1;
+	};
+
+	std::vector<T> dense;
+	std::vector<uint32_t> denseSlots;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+
+	const Slot* Find(Handle handle) const
+	{
+		const uint32_t index = handle.GetIndex();
+		if (handle.IsNull() || index >= slots.size() || slots[index].Generation != handle.GetGeneration())
+			return nullptr;
+		return &slots[index];
+	}
+
+public:
+	Handle Create(T resource)
+	{
+		uint32_t index;
+		if (!freeSlots.empty())
+		{
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(slots.size());
+			slots.emplace_back();
+		}
+
+		slots[index].Dense = static_cast<uint32_t>(dense.size());
+		dense.push_back(std::move(resource));
+		denseSlots.push_back(index);
+		return Handle(index, slots[index].Generation);
+	}
+
+	bool Destroy(Handle handle)
+	{
+		const Slot* slot = Find(handle);
+		if (!slot)
+			return false;
+
+		const uint32_t hole = slot->Dense;
+		const uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+		if (hole != last)
+		{
+			dense[hole] = std::move(dense[last]);
+			denseSlots[hole] = denseSlots[last];
+			slots[denseSlots[hole]].Dense = hole;
+		}
+		dense.pop_back();
+		denseSlots.pop_back();
+
+		const uint32_t index = handle.GetIndex();
+		uint32_t& generation = slots[index].Generation;
+		generation = (generation + 1) & Handle::GenerationMask;
+		if (generation == 0)
+			generation = 1;
+		freeSlots.push_back(index);
+		return true;
+	}
+
+	T* Get(Handle handle)
+	{
+		const Slot* slot = Find(handle);
+		return slot ? &dense[slot->Dense] : nullptr;
+	}
+
+	const T* Get(Handle handle) const
+	{
+		const Slot* slot = Find(handle);
+		return slot ? &dense[slot->Dense] : nullptr;
+	}
+
+	bool IsValid(Handle handle) const { return Find(handle) != nullptr; }
+
+	size_t Size() const { return dense.size(); }
+	// Dense storage in no particular order
+	T* begin() { return dense.data(); }
+	T* end() { return dense.data() + dense.size(); }
+	const T* begin() const { return dense.data(); }
+	const T* end() const { return dense.data() + dense.size(); }
+};
+
+struct MeshTag;
+struct TextureTag;
+struct ShaderTag;
+struct MaterialTag;
+
+using MeshHandle = ResourceHandle<MeshTag>;
+using TextureHandle = ResourceHandle<TextureTag>;
+using ShaderHandle = ResourceHandle<ShaderTag>;
+using MaterialHandle = ResourceHandle<MaterialTag>;
+
+
+#endif //RESOURCEPOOL_H
@@ -0,0 +1,207 @@
+#include "ResourceRegistry.h"
+#include <algorithm>
+#include "Interface/GpuMemory.h"
+
+
+ResourceRegistry& ResourceRegistry::Get()
+{
+	static ResourceRegistry instance;
+	return instance;
+}
+
+MeshHandle ResourceRegistry::AddMesh(Mesh mesh)
+{
+	return meshes.Create(std::move(mesh));
+}
+
+TextureHandle ResourceRegistry::AddTexture(const Texture& texture)
+{
+	return textures.Create(texture);
+}
+
+TextureHandle ResourceRegistry::LoadTexture(const std::string& path)
+{
+	auto it = texturePaths.find(path);
+	if (it != texturePaths.end() && textures.IsValid(it->second))
+		return it->second;
+
+	const TextureHandle handle = textures.Create(Texture(path));
+	texturePaths[path] = handle;
+	return handle;
+}
+
+ShaderHandle ResourceRegistry::AddShader(const Shader& shader)
+{
+	return shaders.Create(shader);
+}
+
+ShaderHandle ResourceRegistry::LoadShader(const std::string& path)
+{
+	auto it = shaderPaths.find(path);
+	if (it != shaderPaths.end() && shaders.IsValid(it->second))
+		return it->second;
+
+	const ShaderHandle handle = shaders.Create(Shader(path));
+	shaderPaths[path] = handle;
+	return handle;
+}
+
+MaterialHandle ResourceRegistry::CreateMaterial(Material material)
+{
+	return materials.Create(std::move(material));
+}
+
+void ResourceRegistry::Connect(entt::registry& registry)
+{
+	registry.on_destroy<MaterialHandle>().connect<&ResourceRegistry::OnMaterialDestroyed>(*this);
+}
+
+void ResourceRegistry::Disconnect(entt::registry& registry)
+{
+	registry.on_destroy<MaterialHandle>().disconnect(*this);
+}
+
+void ResourceRegistry::OnMaterialDestroyed(entt::registry& registry, entt::entity entity)
+{
+	materials.Destroy(registry.get<MaterialHandle>(entity));
+}
+
+std::shared_ptr<const ModelEntry> ResourceRegistry::FindModel(const std::string& path) const
+{
+	auto it = modelPaths.find(path);
+	return it != modelPaths.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<const ModelEntry> ResourceRegistry::AddModel(const std::string& path, ModelEntry model)
+{
+	std::shared_ptr<const ModelEntry> entry(new ModelEntry(std::move(model)), [this, path](const ModelEntry* unused)
+	{
+		for (MeshHandle handle : unused->Meshes)
+			DestroyMesh(handle);
+
+		auto it = modelPaths.find(path);
+		if (it != modelPaths.end() && it->second.expired())
+			modelPaths.erase(it);
+		delete unused;
+	});
+	modelPaths[path] = entry;
+	return entry;
+}
+
+const Texture& ResourceRegistry::ResolveTexture(TextureHandle handle) const
+{
+	const Texture* texture = textures.Get(handle);
+	if (texture && texture->IsResident())
+		return *texture;
+	return Texture::DefaultTexture;
+}
+
+const Texture& ResourceRegistry::UseTexture(TextureHandle handle, uint64_t frame) const
+{
+	const Texture* texture = textures.Get(handle);
+	if (!texture)
+		return Texture::DefaultTexture;
+
+	// Evicted textures are marked too, that is what brings them back
+	texture->MarkUsed(frame);
+	return texture->IsResident() ? *texture : Texture::DefaultTexture;
+}
+
+const Shader& ResourceRegistry::ResolveShader(ShaderHandle handle) const
+{
+	if (const Shader* shader = shaders.Get(handle))
+		return *shader;
+	return Shader::DefaultShader;
+}
+
+const Material& ResourceRegistry::ResolveMaterial(MaterialHandle handle) const
+{
+	if (const Material* material = materials.Get(handle))
+		return *material;
+	if (const Material* material = materials.Get(defaultMaterial))
+		return *material;
+
+	// Null handles resolve to the default texture and shader
+	static const Material fallback;
+	return fallback;
+}
+
+TextureHandle ResourceRegistry::GetDefaultTexture()
+{
+	if (!textures.IsValid(defaultTexture))
+		defaultTexture = textures.Create(Texture::DefaultTexture);
+	return defaultTexture;
+}
+
+ShaderHandle ResourceRegistry::GetDefaultShader()
+{
+	if (!shaders.IsValid(defaultShader))
+		defaultShader = shaders.Create(Shader::DefaultShader);
+	return defaultShader;
+}
+
+MaterialHandle ResourceRegistry::GetDefaultMaterial()
+{
+	if (!materials.IsValid(defaultMaterial))
+		defaultMaterial = materials.Create(Material{ GetDefaultTexture(), GetDefaultShader(), "default" });
+	return defaultMaterial;
+}
+
+void ResourceRegistry::UpdateTextureResidency(uint64_t frame)
+{
+	const Texture* fallback = textures.Get(defaultTexture);
+	textureResidency.DemotedThisFrame = 0;
+	textureResidency.RestoredThisFrame = 0;
+
+	// Drawn last frame while reduced: bring back the full texture if it fits
+	for (Texture& texture : textures)
+	{
+		if (textureResidency.RestoredThisFrame >= MaxTextureRestoresPerFrame)
+			break;
+
+		const bool reduced = !texture.IsResident() || texture.GetDroppedLevels() > 0;
+		if (!reduced || !texture.CanEvict() || texture.GetLastUsedFrame() + 1 < frame)
+			continue;
+
+		const size_t growth = texture.GetFullBytes() - texture.GetResidentBytes();
+		if (GpuMemory::GetTotal() + growth > GpuMemory::GetBudget())
+			continue;
+
+		if (texture.Restore())
+			textureResidency.RestoredThisFrame++;
+	}
+
+	// Over budget: least recently drawn first, one level per texture and frame
+	if (GpuMemory::IsOverBudget())
+	{
+		std::vector<Texture*> candidates;
+		for (Texture& texture : textures)
+		{
+			if (&texture != fallback && texture.IsResident() && texture.CanEvict() && frame - std::min(frame, texture.GetLastUsedFrame()) >= TextureIdleFrames)
+				candidates.push_back(&texture);
+		}
+
+		std::sort(candidates.begin(), candidates.end(),
+			[](const Texture* a, const Texture* b) { return a->GetLastUsedFrame() < b->GetLastUsedFrame(); });
+
+		for (Texture* texture : candidates)
+		{
+			if (!GpuMemory::IsOverBudget())
+				break;
+
+			if (!texture->Demote())
+				texture->Evict();
+			textureResidency.DemotedThisFrame++;
+		}
+	}
+
+	textureResidency.Demoted = 0;
+	textureResidency.Evicted = 0;
+	for (const Texture& texture : textures)
+	{
+		if (!texture.IsResident() && texture.CanEvict())
+			textureResidency.Evicted++;
+		else if (texture.GetDroppedLevels() > 0)
+			textureResidency.Demoted++;
+	}
+}
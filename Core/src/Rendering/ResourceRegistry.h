@@ -0,0 +1,131 @@
+#ifndef RESOURCEREGISTRY_H
+#define RESOURCEREGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <entt/entt.hpp>
+
+#include "Interface/Abstractions.h"
+#include "ResourcePool.h"
+#include "Material.h"
+#include "Model.h"
+
+/*
+ * Owns every mesh, texture, shader and material. Components and draw packets
+ * refer to them by handle, so the per-frame loops copy 4 byte handles instead of
+ * objects carrying strings and buffers.
+ *
+ * Textures, shaders and model files are loaded once per path, later loads return
+ * the same handles. A model file's meshes are destroyed with the last Model using
+ * them, loading the file again after that imports it again. Materials are not shared, every CreateMaterial is a new one,
+ * so editing an entity's material does not change another's. Once connected to a
+ * scene's registry, a material is destroyed with the MaterialHandle component
+ * holding it.
+ *
+ * Creating and destroying happens on the main thread; lookups are const and safe
+ * from the job system while nothing is created.
+ *
+ * Textures are also where memory goes back when GpuMemory is over budget: the
+ * least recently drawn ones are demoted a mip at a time, then evicted, and come
+ * back at full size once they are drawn again and fit.
+ */
+class ResourceRegistry
+{
+public:
+	struct TextureResidency
+	{
+		unsigned int Demoted = 0;
+		unsigned int Evicted = 0;
+		// Totals of the last update
+		unsigned int DemotedThisFrame = 0;
+		unsigned int RestoredThisFrame = 0;
+	};
+
+	// Textures drawn within this many frames are never demoted
+	static constexpr uint64_t TextureIdleFrames = 120;
+	// Restores read the file, so they are spread over frames
+	static constexpr unsigned int MaxTextureRestoresPerFrame = 1;
+
+private:
+	ResourcePool<Mesh, MeshTag> meshes;
+	ResourcePool<Texture, TextureTag> textures;
+	ResourcePool<Shader, ShaderTag> shaders;
+	ResourcePool<Material, MaterialTag> materials;
+
+	std::unordered_map<std::string, TextureHandle> texturePaths;
+	std::unordered_map<std::string, ShaderHandle> shaderPaths;
+	// Owned by the Models of the file
+	std::unordered_map<std::string, std::weak_ptr<const ModelEntry>> modelPaths;
+
+	TextureHandle defaultTexture;
+	ShaderHandle defaultShader;
+	MaterialHandle defaultMaterial;
+
+	TextureResidency textureResidency;
+
+	ResourceRegistry() = default;
+
+	void OnMaterialDestroyed(entt::registry& registry, entt::entity entity);
+
+public:
+	ResourceRegistry(const ResourceRegistry&) = delete;
+	ResourceRegistry& operator=(const ResourceRegistry&) = delete;
+
+	static ResourceRegistry& Get();
+
+	MeshHandle AddMesh(Mesh mesh);
+	TextureHandle AddTexture(const Texture& texture);
+	TextureHandle LoadTexture(const std::string& path);
+	ShaderHandle AddShader(const Shader& shader);
+	ShaderHandle LoadShader(const std::string& path);
+	MaterialHandle CreateMaterial(Material material);
+
+	// Null when no Model holds the file
+	std::shared_ptr<const ModelEntry> FindModel(const std::string& path) const;
+	// The entry destroys its meshes when the last holder lets go of it
+	std::shared_ptr<const ModelEntry> AddModel(const std::string& path, ModelEntry model);
+
+	void DestroyMesh(MeshHandle handle) { meshes.Destroy(handle); }
+	void DestroyMaterial(MaterialHandle handle) { materials.Destroy(handle); }
+
+	// Ties resource lifetimes to the components of the registry
+	void Connect(entt::registry& registry);
+	void Disconnect(entt::registry& registry);
+
+	// Null for handles whose resource was destroyed
+	const Mesh* GetMesh(MeshHandle handle) const { return meshes.Get(handle); }
+	Texture* GetTexture(TextureHandle handle) { return textures.Get(handle); }
+	const Texture* GetTexture(TextureHandle handle) const { return textures.Get(handle); }
+	Shader* GetShader(ShaderHandle handle) { return shaders.Get(handle); }
+	const Shader* GetShader(ShaderHandle handle) const { return shaders.Get(handle); }
+	Material* GetMaterial(MaterialHandle handle) { return materials.Get(handle); }
+	const Material* GetMaterial(MaterialHandle handle) const { return materials.Get(handle); }
+
+	// Stale handles and textures that are not resident fall back to the defaults
+	const Texture& ResolveTexture(TextureHandle handle) const;
+	// ResolveTexture for drawing, marks the texture as used in the frame
+	const Texture& UseTexture(TextureHandle handle, uint64_t frame) const;
+	const Shader& ResolveShader(ShaderHandle handle) const;
+	const Material& ResolveMaterial(MaterialHandle handle) const;
+
+	// Wrap Texture::DefaultTexture and Shader::DefaultShader, created on first use
+	TextureHandle GetDefaultTexture();
+	ShaderHandle GetDefaultShader();
+	MaterialHandle GetDefaultMaterial();
+
+	// Demotes and evicts while over the memory budget, restores textures drawn again.
+	// Once per frame on the main thread, while nothing is being drawn.
+	void UpdateTextureResidency(uint64_t frame);
+	const TextureResidency& GetTextureResidency() const { return textureResidency; }
+
+	size_t GetMeshCount() const { return meshes.Size(); }
+	size_t GetTextureCount() const { return textures.Size(); }
+	size_t GetShaderCount() const { return shaders.Size(); }
+	size_t GetMaterialCount() const { return materials.Size(); }
+};
+
+
+#endif //RESOURCEREGISTRY_H
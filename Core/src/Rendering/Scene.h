@@ -16,23 +16,44 @@
 #include "Camera.h"
 #include "System/Input.h"
 #include "Components.h"
+#include "SpatialIndex.h"
+#include "ResourceRegistry.h"
+#include <memory>
 
 
 
 class Scene
 {
 private:
+    // Declared before the registry so it outlives it, and on the heap so the
+    // registry signals keep pointing at it when the scene is moved
+    std::unique_ptr<SpatialIndex> spatialIndex;
     entt::registry registry;
     std::string name;
 public:
-    Scene() : name("Unnamed scene") {}
-    Scene(std::string  name) : name(std::move(name)) {}
-    ~Scene() {}
+    Scene() : Scene("Unnamed scene") {}
+    Scene(std::string  name) : spatialIndex(std::make_unique<SpatialIndex>()), name(std::move(name))
+    {
+        spatialIndex->Connect(registry);
+        ResourceRegistry::Get().Connect(registry);
+    }
+    // The registry's destructor sends no destroy signals, clearing it releases the resources of its components
+    ~Scene() { registry.clear(); }
 
     Scene(const Scene&) = delete;
     Scene& operator=(const Scene&) = delete;
     Scene(Scene&&) noexcept = default;
-    Scene& operator=(Scene&&) noexcept = default;
+    Scene& operator=(Scene&& other) noexcept
+    {
+        if (this != &other)
+        {
+            registry.clear();
+            registry = std::move(other.registry);
+            spatialIndex = std::move(other.spatialIndex);
+            name = std::move(other.name);
+        }
+        return *this;
+    }
 public:
     entt::entity CreateEntity(const std::string& name)
     {
@@ -86,6 +107,13 @@ public:
         return registry.get_or_emplace<T>(entity, std::forward<Args>(args)...);
     }
 
+    // Announces an edit made through a component reference
+    template<typename T>
+    void MarkUpdated(entt::entity entity)
+    {
+        registry.patch<T>(entity);
+    }
+
     template<typename T>
     void RemoveComponent(entt::entity entity)
     {
@@ -127,6 +155,13 @@ public:
     }
 
     std::string GetName() { return name; }
+
+    // Brought up to date with all pending Transform/Model changes
+    SpatialIndex& GetSpatialIndex()
+    {
+        spatialIndex->Update(registry);
+        return *spatialIndex;
+    }
 };
 
 
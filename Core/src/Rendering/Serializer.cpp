@@ -3,6 +3,7 @@
 //
 
 #include "Serializer.h"
+#include "ResourceRegistry.h"
 #include <yaml-cpp/yaml.h>
 #include <Utils.h>
 #include <filesystem>
@@ -19,6 +20,14 @@ std::shared_ptr<Scene> CreateDefaultScene()
     entt::entity cameraEntity = scene->CreateEntity("DefaultCamera");
     scene->AddComponent<Transform>(cameraEntity, defaultCameraPosition, defaultCameraRotation, defaultCameraScale);
     scene->AddComponent<Camera>(cameraEntity, true);
+
+    entt::entity lightEntity = scene->CreateEntity("DefaultLight");
+    scene->AddComponent<Transform>(lightEntity, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+    scene->AddComponent<PointLight>(lightEntity, glm::vec3(1.0f), 1.0f, 100.0f);
+
+    entt::entity sunEntity = scene->CreateEntity("Sun");
+    scene->AddComponent<Transform>(sunEntity, glm::vec3(0.0f), glm::vec3(-50.0f, 45.0f, 0.0f), glm::vec3(1.0f));
+    scene->AddComponent<DirectionalLight>(sunEntity, glm::vec3(1.0f), 0.8f, true);
     return scene;
 }
 
@@ -89,12 +98,67 @@ void Serializer::Serialize(Scene* scene, const std::string& filename)
             emitter << YAML::Key << "Model" << YAML::Value << model.GetFileName();
         }
 
-        if (scene->HasComponent<Material>(entity))
+        if (scene->HasComponent<PointLight>(entity))
+        {
+            PointLight& light = scene->GetComponent<PointLight>(entity);
+            emitter << YAML::Key << "PointLight" << YAML::Value << YAML::BeginMap;
+
+            emitter << YAML::Key << "Color" << YAML::Value;
+            emitter << YAML::Flow << YAML::BeginSeq;
+            emitter << light.color.x;
+            emitter << light.color.y;
+            emitter << light.color.z;
+            emitter << YAML::EndSeq;
+
+            emitter << YAML::Key << "Intensity" << YAML::Value << light.intensity;
+            emitter << YAML::Key << "Radius" << YAML::Value << light.radius;
+            emitter << YAML::EndMap;
+        }
+
+        if (scene->HasComponent<DirectionalLight>(entity))
         {
-            Material& material = scene->GetComponent<Material>(entity);
+            DirectionalLight& light = scene->GetComponent<DirectionalLight>(entity);
+            emitter << YAML::Key << "DirectionalLight" << YAML::Value << YAML::BeginMap;
+
+            emitter << YAML::Key << "Color" << YAML::Value;
+            emitter << YAML::Flow << YAML::BeginSeq;
+            emitter << light.color.x;
+            emitter << light.color.y;
+            emitter << light.color.z;
+            emitter << YAML::EndSeq;
+
+            emitter << YAML::Key << "Intensity" << YAML::Value << light.intensity;
+            emitter << YAML::Key << "CastShadows" << YAML::Value << light.castShadows;
+            emitter << YAML::EndMap;
+        }
+
+        if (scene->HasComponent<Occluder>(entity))
+        {
+            Occluder& occluder = scene->GetComponent<Occluder>(entity);
+            emitter << YAML::Key << "Occluder" << YAML::Value << YAML::BeginMap;
+            emitter << YAML::Key << "Enabled" << YAML::Value << occluder.enabled;
+            emitter << YAML::EndMap;
+        }
+
+        if (scene->HasComponent<Static>(entity))
+        {
+            Static& marker = scene->GetComponent<Static>(entity);
+            emitter << YAML::Key << "Static" << YAML::Value << YAML::BeginMap;
+            emitter << YAML::Key << "Enabled" << YAML::Value << marker.enabled;
+            emitter << YAML::EndMap;
+        }
+
+        if (scene->HasComponent<MaterialHandle>(entity))
+        {
+            ResourceRegistry& resources = ResourceRegistry::Get();
+            const Material& material = resources.ResolveMaterial(scene->GetComponent<MaterialHandle>(entity));
+            Texture* albedo = resources.GetTexture(material.Albedo);
+            Shader* shader = resources.GetShader(material.Shader);
+
             emitter << YAML::Key << "Material" << YAML::Value << YAML::BeginMap;
-            emitter << YAML::Key << "Albedo" << YAML::Value << material.Albedo.GetFilePath();
-            emitter << YAML::Key << "Shader" << YAML::Value << material.Shader.GetName();
+            emitter << YAML::Key << "Albedo" << YAML::Value << (albedo ? albedo->GetFilePath() : std::string());
+            emitter << YAML::Key << "Shader" << YAML::Value << (shader ? shader->GetName() : std::string());
+            emitter << YAML::Key << "Transparent" << YAML::Value << material.Transparent;
             emitter << YAML::EndMap;
         }
 
@@ -190,12 +254,43 @@ std::shared_ptr<Scene> Serializer::Deserialize(const std::string& filename)
             scene->AddComponent<Model>(entity, filename);
         }
 
+        if (node["PointLight"])
+        {
+            glm::vec3 color = DeserializeVec3(node["PointLight"], "Color");
+            float intensity = node["PointLight"]["Intensity"].as<float>();
+            float radius = node["PointLight"]["Radius"].as<float>();
+            scene->AddComponent<PointLight>(entity, color, intensity, radius);
+        }
+
+        if (node["DirectionalLight"])
+        {
+            glm::vec3 color = DeserializeVec3(node["DirectionalLight"], "Color");
+            float intensity = node["DirectionalLight"]["Intensity"].as<float>();
+            bool castShadows = !node["DirectionalLight"]["CastShadows"] || node["DirectionalLight"]["CastShadows"].as<bool>();
+            scene->AddComponent<DirectionalLight>(entity, color, intensity, castShadows);
+        }
+
+        if (node["Occluder"])
+        {
+            bool enabled = !node["Occluder"]["Enabled"] || node["Occluder"]["Enabled"].as<bool>();
+            scene->AddComponent<Occluder>(entity, enabled);
+        }
+
+        if (node["Static"])
+        {
+            bool enabled = !node["Static"]["Enabled"] || node["Static"]["Enabled"].as<bool>();
+            scene->AddComponent<Static>(entity, enabled);
+        }
+
         if (node["Material"])
         {
             std::string albedo = node["Material"]["Albedo"].as<std::string>();
             std::string shader = node["Material"]["Shader"].as<std::string>();
+            bool transparent = node["Material"]["Transparent"] && node["Material"]["Transparent"].as<bool>();
 
-            scene->AddComponent<Material>(entity, Texture(albedo), Shader::DefaultShader, "x");
+            ResourceRegistry& resources = ResourceRegistry::Get();
+            const MaterialHandle material = resources.CreateMaterial(Material{resources.LoadTexture(albedo), resources.GetDefaultShader(), "x", transparent});
+            scene->AddComponent<MaterialHandle>(entity, material);
         }
 
         if (node["Camera"])
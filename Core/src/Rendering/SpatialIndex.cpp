@@ -0,0 +1,91 @@
+#include "SpatialIndex.h"
+#include "Model.h"
+#include "Components.h"
+
+
+void SpatialIndex::Connect(entt::registry& registry)
+{
+	registry.on_construct<Model>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_update<Model>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_destroy<Model>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_construct<Transform>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_update<Transform>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_destroy<Transform>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_construct<Static>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_update<Static>().connect<&SpatialIndex::OnChanged>(*this);
+	registry.on_destroy<Static>().connect<&SpatialIndex::OnChanged>(*this);
+
+	// Pick up whatever already exists
+	for (entt::entity entity : registry.view<Model, Transform>())
+		dirty.push_back(entity);
+}
+
+void SpatialIndex::Disconnect(entt::registry& registry)
+{
+	registry.on_construct<Model>().disconnect(*this);
+	registry.on_update<Model>().disconnect(*this);
+	registry.on_destroy<Model>().disconnect(*this);
+	registry.on_construct<Transform>().disconnect(*this);
+	registry.on_update<Transform>().disconnect(*this);
+	registry.on_destroy<Transform>().disconnect(*this);
+	registry.on_construct<Static>().disconnect(*this);
+	registry.on_update<Static>().disconnect(*this);
+	registry.on_destroy<Static>().disconnect(*this);
+}
+
+void SpatialIndex::OnChanged(entt::registry&, entt::entity entity)
+{
+	dirty.push_back(entity);
+}
+
+/*
+ * Destroy signals fire before the component is gone, so the checks are done here
+ * rather than in the listener.
+ */
+void SpatialIndex::Update(entt::registry& registry)
+{
+	if (!dirty.empty())
+		version++;
+
+	bool staticChanged = false;
+	for (entt::entity entity : dirty)
+	{
+		auto proxy = proxies.find(entity);
+		if (proxy != proxies.end() && proxy->second.Static)
+			staticChanged = true;
+
+		const bool indexed = registry.valid(entity)
+			&& registry.all_of<Model, Transform>(entity)
+			&& !registry.get<Model>(entity).GetMeshes().empty();
+
+		if (!indexed)
+		{
+			if (proxy != proxies.end())
+			{
+				tree.Remove(proxy->second.Node);
+				proxies.erase(proxy);
+			}
+			continue;
+		}
+
+		const Static* marker = registry.try_get<Static>(entity);
+		const bool isStatic = marker && marker->enabled;
+		staticChanged |= isStatic;
+
+		const Model& model = registry.get<Model>(entity);
+		const Transform& transform = registry.get<Transform>(entity);
+		const AABB bounds = model.GetBounds().Transformed(transform.GetModel());
+
+		if (proxy == proxies.end())
+			proxies.emplace(entity, Proxy{ tree.Insert(bounds, entity), isStatic });
+		else
+		{
+			tree.Move(proxy->second.Node, bounds);
+			proxy->second.Static = isStatic;
+		}
+	}
+
+	if (staticChanged)
+		staticVersion++;
+	dirty.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include <entt/entt.hpp>
+
+#include "DynamicBVH.h"
+
+/*
+ * Keeps a DynamicBVH of the world bounds of every entity with a Model and a Transform.
+ * It listens to construct/update/destroy of both components and only touches the
+ * tree for entities that changed, on the next Update. Edits made through a
+ * component reference have to be announced with registry.patch (Scene::MarkUpdated).
+ *
+ * Changes to entities marked Static, or that were before the change, also bump a
+ * separate static version.
+ */
+class SpatialIndex
+{
+private:
+	struct Proxy
+	{
+		int Node;
+		bool Static;
+	};
+
+	DynamicBVH tree;
+	std::unordered_map<entt::entity, Proxy> proxies;
+	std::vector<entt::entity> dirty;
+	uint64_t version = 0;
+	uint64_t staticVersion = 0;
+
+	void OnChanged(entt::registry& registry, entt::entity entity);
+
+public:
+	SpatialIndex() = default;
+	~SpatialIndex() = default;
+
+	SpatialIndex(const SpatialIndex&) = delete;
+	SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+	void Connect(entt::registry& registry);
+	void Disconnect(entt::registry& registry);
+
+	void Update(entt::registry& registry);
+
+	void Query(const Frustum& frustum, std::vector<entt::entity>& result) { tree.Query(frustum, result); }
+	void Query(const AABB& box, std::vector<entt::entity>& result) { tree.Query(box, result); }
+	void Query(const BoundingSphere& sphere, std::vector<entt::entity>& result) { tree.Query(sphere, result); }
+	void RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<RayHit>& result) { tree.RayCast(origin, direction, maxDistance, result); }
+
+	size_t Size() const { return tree.Size(); }
+	int GetHeight() const { return tree.GetHeight(); }
+	// Bumped by every Update that changed something, for caches built from the scene
+	uint64_t GetVersion() const { return version; }
+	// Bumped only when static entities changed
+	uint64_t GetStaticVersion() const { return staticVersion; }
+};
+
+
+#endif //SPATIALINDEX_H
@@ -0,0 +1,63 @@
+#include "FramePacer.h"
+#include <glad/glad.h>
+#include "Interface/GLResource.h"
+#include <algorithm>
+#include <chrono>
+
+
+FramePacer& FramePacer::Get()
+{
+	static FramePacer instance;
+	return instance;
+}
+
+void FramePacer::SetFramesInFlight(unsigned int frames)
+{
+	framesInFlight = std::clamp(frames, 1u, MaxFramesInFlight);
+}
+
+void FramePacer::BeginFrame()
+{
+	const uint64_t depth = lowLatency ? 1 : framesInFlight;
+	const uint64_t target = frameIndex >= depth ? frameIndex - depth + 1 : 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	// Fences signal in order: block up to the frame depth back, then only poll the newer ones
+	while (completedFrames < frameIndex)
+	{
+		void*& fence = fences[completedFrames % MaxFramesInFlight];
+		if (fence)
+		{
+			const bool block = completedFrames < target;
+
+			// The first blocking wait flushes, so the fence is guaranteed to signal
+			GLenum result = glClientWaitSync(static_cast<GLsync>(fence), block ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+			while (block && result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(static_cast<GLsync>(fence), 0, 1000000);
+			if (result == GL_TIMEOUT_EXPIRED)
+				break;
+
+			glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+		completedFrames++;
+	}
+
+	waitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	GLDeletionQueue::Retire(completedFrames);
+}
+
+void FramePacer::EndFrame()
+{
+	// Still set when the frame MaxFramesInFlight back was never waited on, it has signalled by now
+	void*& fence = fences[frameIndex % MaxFramesInFlight];
+	if (fence)
+		glDeleteSync(static_cast<GLsync>(fence));
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	frameIndex++;
+	completedFrames = std::max(completedFrames, frameIndex > MaxFramesInFlight ? frameIndex - MaxFramesInFlight : 0);
+	GLDeletionQueue::SetFrame(frameIndex);
+}
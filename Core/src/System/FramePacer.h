@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+/*
+	Bounds how far the CPU runs ahead of the GPU instead of leaving it to the
+	driver. Every frame ends with a fence and BeginFrame waits for the fence of the
+	frame framesInFlight back, so at most that many frames are ever queued.
+
+	Low latency mode waits for the previous frame instead. Call BeginFrame right
+	before input is polled: the wait happens first, so the input that gets rendered
+	is as fresh as possible.
+
+	Per frame resources are keyed to GetFrameIndex. Anything with
+	MaxFramesInFlight copies indexed by GetFrameSlot is never still read by the GPU.
+	BeginFrame also retires the GL objects released by frames that completed.
+*/
+
+class FramePacer
+{
+public:
+	static constexpr unsigned int MaxFramesInFlight = 4;
+
+private:
+	void* fences[MaxFramesInFlight] = {};
+	uint64_t frameIndex = 0;
+	// Frames before this one are known to be finished on the GPU
+	uint64_t completedFrames = 0;
+	unsigned int framesInFlight = 2;
+	bool lowLatency = false;
+	float waitTime = 0.0f;
+
+	FramePacer() = default;
+
+public:
+	// Fences are not deleted, they go away with the context
+	~FramePacer() = default;
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	static FramePacer& Get();
+
+	// Blocks until the GPU finished the frame framesInFlight back, 1 in low latency mode,
+	// then deletes the GL objects nothing in flight uses anymore
+	void BeginFrame();
+	// Fences the frame, call after the buffers were swapped
+	void EndFrame();
+
+	void SetFramesInFlight(unsigned int frames);
+	unsigned int GetFramesInFlight() const { return framesInFlight; }
+	void SetLowLatency(bool enabled) { lowLatency = enabled; }
+	bool IsLowLatency() const { return lowLatency; }
+
+	uint64_t GetFrameIndex() const { return frameIndex; }
+	uint64_t GetCompletedFrames() const { return completedFrames; }
+	unsigned int GetFrameSlot() const { return static_cast<unsigned int>(frameIndex % MaxFramesInFlight); }
+	// Milliseconds the last BeginFrame spent waiting on the GPU
+	float GetWaitTime() const { return waitTime; }
+};
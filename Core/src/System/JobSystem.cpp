@@ -0,0 +1,113 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+	if (workerCount == 0)
+	{
+		const unsigned int hardware = std::thread::hardware_concurrency();
+		workerCount = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem instance;
+	return instance;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+	if (workers.empty() || count <= grain)
+	{
+		body(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(submitMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task.Body = &body;
+		task.Count = count;
+		task.Grain = grain;
+		task.Next = 0;
+		task.Remaining = count;
+		generation++;
+	}
+	wake.notify_all();
+
+	RunChunks();
+
+	// Clearing the body under the same lock as the final check means a worker waking
+	// up late either got counted as busy before, or sees no task at all
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return task.Remaining == 0 && busy == 0; });
+	task.Body = nullptr;
+}
+
+void JobSystem::RunChunks()
+{
+	for (;;)
+	{
+		const size_t begin = task.Next.fetch_add(task.Grain);
+		if (begin >= task.Count)
+			return;
+
+		const size_t end = std::min(begin + task.Grain, task.Count);
+		(*task.Body)(begin, end);
+
+		if (task.Remaining.fetch_sub(end - begin) == end - begin)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
+
+void JobSystem::WorkerLoop()
+{
+	uint64_t seen = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stop || generation != seen; });
+			if (stop)
+				return;
+
+			seen = generation;
+			if (!task.Body)
+				continue;
+			busy++;
+		}
+
+		RunChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+		}
+		done.notify_all();
+	}
+}
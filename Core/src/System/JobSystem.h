@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Fixed pool of worker threads for data parallel loops. ParallelFor splits
+	[0, count) into chunks of `grain` items, the calling thread works on chunks
+	too and the call returns once every chunk has run. Calls from several threads
+	are serialized.
+*/
+
+class JobSystem
+{
+private:
+	struct Task
+	{
+		const std::function<void(size_t, size_t)>* Body = nullptr;
+		size_t Count = 0;
+		size_t Grain = 1;
+		std::atomic<size_t> Next{ 0 };
+		std::atomic<size_t> Remaining{ 0 };
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex submitMutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	Task task;
+	uint64_t generation = 0;
+	unsigned int busy = 0;
+	bool stop = false;
+
+	void WorkerLoop();
+	void RunChunks();
+
+public:
+	// 0 picks one worker per hardware thread, minus the caller
+	explicit JobSystem(unsigned int workerCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+	// Number of threads a ParallelFor can run on, caller included
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+	static JobSystem& Get();
+};
@@ -6,6 +6,8 @@
 #include "GLFW/glfw3.h"
 #include "Input.h"
 #include "Interface/Abstractions.h"
+#include "Interface/GLExtensions.h"
+#include "Interface/GLStateCache.h"
 
 using namespace Events;
 
@@ -39,8 +41,8 @@ Window::Window(WindowProps props)
 		s_GlfwInitialized = status;
 	}
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, props.ContextMajor);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, props.ContextMinor);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	#ifdef __APPLE__
@@ -48,6 +50,16 @@ Window::Window(WindowProps props)
 	#endif
 
 	m_Handle = glfwCreateWindow(m_Data.Width, m_Data.Height, m_Data.Title.c_str(), NULL, NULL);
+
+	if (!m_Handle && (props.ContextMajor > 3 || props.ContextMinor > 3))
+	{
+		std::cerr << "OpenGL " << props.ContextMajor << "." << props.ContextMinor
+				  << " context not available, falling back to 3.3" << std::endl;
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		m_Handle = glfwCreateWindow(m_Data.Width, m_Data.Height, m_Data.Title.c_str(), NULL, NULL);
+	}
 	glfwShowWindow(m_Handle);
 	glfwMakeContextCurrent(m_Handle);
 	glfwSetWindowUserPointer(m_Handle, &m_Data);
@@ -63,7 +75,7 @@ Window::Window(WindowProps props)
 			data->Height = height;
 
 			WindowResizeEvent e(width, height);
-			glViewport(0, 0, width, height);
+			GLStateCache::Viewport(0, 0, width, height);
 
 			data->EventCallback(e);
 		});
@@ -130,8 +142,18 @@ void Window::Shutdown()
 
 
 void Window::Update()
+{
+	PollEvents();
+	SwapBuffers();
+}
+
+void Window::PollEvents()
 {
 	glfwPollEvents();
+}
+
+void Window::SwapBuffers()
+{
 	glfwSwapBuffers(m_Handle);
 }
 
@@ -145,6 +167,8 @@ void Window::SetupGL()
         exit(EXIT_FAILURE);
     }
 
+	GLCapabilities::Load((GLADloadproc)glfwGetProcAddress);
+	GLStateCache::Invalidate();
 	InitDefaultStructures();
 
     const GLubyte* renderer = glGetString(GL_RENDERER);
@@ -20,8 +20,13 @@ struct WindowProps
 	unsigned int Height;
 	std::string Title;
 
-	WindowProps(int width = 1200, int height = 840, std::string title = "Window")
-		: Width(width), Height(height), Title(title)
+	// Requested core profile version. Anything above 3.3 falls back to 3.3 when
+	// the driver cannot create it (e.g. 4.6 enables multi draw indirect submission)
+	int ContextMajor = 3;
+	int ContextMinor = 3;
+
+	WindowProps(int width = 1200, int height = 840, std::string title = "Window", int contextMajor = 3, int contextMinor = 3)
+		: Width(width), Height(height), Title(title), ContextMajor(contextMajor), ContextMinor(contextMinor)
 	{
 	}
 };
@@ -37,7 +42,10 @@ public:
 	inline unsigned int GetWidth() const { return m_Data.Width; };
 	inline unsigned int GetHeight() const { return m_Data.Height; };
 
+	// PollEvents then SwapBuffers
 	void Update();
+	void PollEvents();
+	void SwapBuffers();
 	void Shutdown();
 	void SetEventCallback(EventCallbackFn fn) { m_Data.EventCallback = fn; }
 	inline GLFWwindow* GetHandle() const { return m_Handle; }
@@ -1,73 +1,254 @@
 
+layout(std140) uniform FrameData
+{
+    float uTime;            // Seconds since startup
+    float uDeltaTime;       // Seconds since the previous frame
+    vec2 uResolution;       // Render target size in pixels
+};
+
+layout(std140) uniform ViewData
+{
+    mat4 uView;             // View matrix
+    mat4 uProjection;       // Projection matrix
+    mat4 uViewProjection;   // Projection * view
+    vec4 uCameraPosition;   // Camera position in world space
+    mat4 uInverseViewProjection; // Clip space back to world space
+};
+
+layout(std140) uniform LightData
+{
+    vec4 uAmbientLight;
+    uvec4 uClusterGrid;     // Tiles x, tiles y, depth slices, light count
+    vec4 uClusterDepth;     // Depth slice = log(view depth) * x + y
+    vec4 uSunDirection;     // Direction the sun light travels, w 1 when it casts shadows
+    vec4 uSunColor;         // rgb color, w intensity, 0 without a sun
+    vec4 uCascadeSplits;    // View depth where each cascade ends
+    vec4 uShadowParams;     // Depth bias, normal bias in texels, texel size, cascade count
+    mat4 uShadowMatrices[4];// World to shadow map texture space, per cascade
+};
+
 #if defined(VERTEX)
 
-layout(location = 0) in vec3 aPosition;   // Vertex position
-layout(location = 3) in vec3 aNormal;     // Vertex normal
+layout(location = 0) in vec3 aPosition;   // Vertex position, quantized meshes store [0, 1] of their bounds
+layout(location = 3) in vec2 aNormal;     // Octahedral vertex normal
 layout(location = 2) in vec2 aTexCoord;  // Texture coordinates
 
+#if defined(DEFERRED_LIGHTING)
+
+out vec2 vTexCoord;     // Screen position in [0, 1]
+
+// Fullscreen quad with positions already in clip space
+void main()
+{
+    gl_Position = vec4(aPosition.xy, 0.0, 1.0);
+    vTexCoord = aPosition.xy * 0.5 + 0.5;
+}
+
+#else
+
+#if defined(INDIRECT)
+layout(std430, binding = 0) readonly buffer ObjectBuffer
+{
+    mat4 uObjects[];                      // Per-draw model matrices, indexed by base instance
+};
+#elif defined(INSTANCED)
+layout(location = 4) in mat4 aModel;      // Per-instance model matrix (locations 4..7)
+#else
+layout(std140) uniform ObjectData
+{
+    mat4 uModel;                          // Model transformation matrix
+};
+#endif
+
 out vec3 vNormal;       // Pass normal to fragment shader
 out vec2 vTexCoord;     // Pass texture coordinates to fragment shader
 out vec3 vFragPos;      // Pass fragment position for lighting
 
-uniform mat4 uModel;     // Model transformation matrix
-uniform mat4 uView;      // View matrix
-uniform mat4 uProjection; // Projection matrix
+// Matches the depth pre-pass bit for bit
+invariant gl_Position;
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main() {
-    mat4 mvp = uProjection * uView * uModel;
+#if defined(INDIRECT)
+    mat4 model = uObjects[gl_BaseInstance + gl_InstanceID];
+#elif defined(INSTANCED)
+    mat4 model = aModel;
+#else
+    mat4 model = uModel;
+#endif
+
+    mat4 mvp = uViewProjection * model;
 
     // Invert the model-view-projection matrix
 
     gl_Position = mvp * vec4(aPosition, 1.0);
 
-    vFragPos = vec3(uModel * vec4(aPosition, 1.0f));
+    vFragPos = vec3(model * vec4(aPosition, 1.0f));
 
-    // Pass the transformed normal
-    vNormal = mat3(transpose(inverse(uModel))) * aNormal;
+    // Pass the transformed normal, the model matrix carries the position decode
+    vNormal = mat3(transpose(inverse(model))) * DecodeOctahedral(aNormal);
 
     // Pass texture coordinates as-is
     vTexCoord = aTexCoord;
 }
 
+#endif
+
 #endif
 #if defined(FRAGMENT)
 
 uniform float uCol;
 
 
-in vec3 vNormal;       // Interpolated normal
 in vec2 vTexCoord;     // Interpolated texture coordinates
+#if !defined(DEFERRED_LIGHTING)
+in vec3 vNormal;       // Interpolated normal
 in vec3 vFragPos;      // Fragment position in world space
+#endif
 
+#if defined(GBUFFER)
+layout(location = 0) out vec4 GAlbedo;     // Texture color
+layout(location = 1) out vec4 GNormal;     // World normal * 0.5 + 0.5
+#else
 out vec4 FragColor;    // Output color
+#endif
 
 uniform sampler2D uTexture;    // Texture sampler
 
-uniform int uNumLights;
-uniform vec3 uLightPos;
-uniform vec3 uLightColor;
-uniform float uLightIntensity;
-uniform vec3 uAmbientLight;
+#if defined(DEFERRED_LIGHTING)
+uniform sampler2D uGBufferAlbedo;
+uniform sampler2D uGBufferNormal;
+uniform sampler2D uGBufferDepth;
+#endif
+
+uniform samplerBuffer uLightBuffer;        // Two texels per light: position + radius, color + intensity
+uniform usamplerBuffer uClusterBuffer;     // Per froxel: first index, light count
+uniform usamplerBuffer uLightIndexBuffer;  // Light indices of all froxels back to back
+uniform sampler2DArrayShadow uShadowMap;   // One depth layer per cascade
 
 
+// Froxel of this fragment, laid out as x + tilesX * (y + tilesY * slice)
+int GetCluster(float depth)
+{
+    int slice = int(log(max(depth, 1e-4)) * uClusterDepth.x + uClusterDepth.y);
+    slice = clamp(slice, 0, int(uClusterGrid.z) - 1);
+
+    ivec2 tile = ivec2(gl_FragCoord.xy / uResolution * vec2(uClusterGrid.xy));
+    tile = clamp(tile, ivec2(0), ivec2(uClusterGrid.xy) - 1);
+
+    return tile.x + int(uClusterGrid.x) * (tile.y + int(uClusterGrid.y) * slice);
+}
+
+// 1 lit, 0 in shadow. Filtered with four hardware 2x2 PCF taps.
+float GetSunShadow(vec3 worldPosition, vec3 normal, float depth)
+{
+    int cascade = 0;
+    int cascades = int(uShadowParams.w);
+    while (cascade < cascades - 1 && depth > uCascadeSplits[cascade])
+        cascade++;
+
+    if (depth > uCascadeSplits[cascades - 1])
+        return 1.0;
+
+    // Pushing the sample point along the normal hides acne on surfaces at grazing angles
+    // The matrix scales world x by 0.5 / radius into its first row, a texel covers 2 * radius / resolution
+    mat4 shadowMatrix = uShadowMatrices[cascade];
+    float texelWorld = uShadowParams.z / length(vec3(shadowMatrix[0][0], shadowMatrix[1][0], shadowMatrix[2][0]));
+    vec3 position = worldPosition + normal * texelWorld * uShadowParams.y;
+    vec4 coord = shadowMatrix * vec4(position, 1.0);
+
+    vec4 lookup = vec4(coord.xy, float(cascade), coord.z - uShadowParams.x);
+    float lit = 0.0;
+    lit += textureOffset(uShadowMap, lookup, ivec2(-1, -1));
+    lit += textureOffset(uShadowMap, lookup, ivec2( 1, -1));
+    lit += textureOffset(uShadowMap, lookup, ivec2(-1,  1));
+    lit += textureOffset(uShadowMap, lookup, ivec2( 1,  1));
+    return lit * 0.25;
+}
+
+// Diffuse light arriving at a surface point from the sun and the froxel's point lights
+vec3 GetDiffuseLight(vec3 worldPosition, vec3 normal)
+{
+    vec3 diffuse = vec3(0.0);
+    float depth = -(uView * vec4(worldPosition, 1.0)).z;
+
+    if (uSunColor.w > 0.0)
+    {
+        float sunStrength = max(0.0, dot(-uSunDirection.xyz, normal));
+        if (sunStrength > 0.0 && uSunDirection.w > 0.0)
+            sunStrength *= GetSunShadow(worldPosition, normal, depth);
+        diffuse += sunStrength * uSunColor.rgb * uSunColor.w;
+    }
+
+    uvec2 cluster = texelFetch(uClusterBuffer, GetCluster(depth)).xy;
+    for (uint i = 0u; i < cluster.y; i++)
+    {
+        int light = int(texelFetch(uLightIndexBuffer, int(cluster.x + i)).x);
+        vec4 positionRadius = texelFetch(uLightBuffer, light * 2);
+        vec4 colorIntensity = texelFetch(uLightBuffer, light * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - worldPosition;
+        float distance = length(toLight);
+
+        // Smooth window that reaches zero at the light radius
+        float falloff = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float diffuseStrength = max(0.0, dot(toLight / max(distance, 1e-4), normal));
+
+        diffuse += diffuseStrength * falloff * falloff * colorIntensity.rgb * colorIntensity.w;
+    }
+
+    return diffuse;
+}
+
+#if defined(GBUFFER)
+
+void main()
+{
+    GAlbedo = texture(uTexture, vTexCoord);
+    GNormal = vec4(normalize(vNormal) * 0.5 + 0.5, 1.0);
+}
+
+#elif defined(DEFERRED_LIGHTING)
+
+// Shades every covered pixel once, position comes back from the depth buffer
 void main()
 {
-    // Calculate light direction (from light to fragment position)
-    vec3 lightDir = normalize(uLightPos - vFragPos);
+    float depth = texture(uGBufferDepth, vTexCoord).r;
+    if (depth >= 1.0)
+        discard;
 
-    // Calculate the diffuse strength (dot product between light direction and surface normal)
-    float diffuseStrength = max(0.0, dot(lightDir, vNormal));
+    vec4 world = uInverseViewProjection * vec4(vec3(vTexCoord, depth) * 2.0 - 1.0, 1.0);
+    vec3 worldPosition = world.xyz / world.w;
+    vec3 normal = normalize(texture(uGBufferNormal, vTexCoord).xyz * 2.0 - 1.0);
+    vec4 texColor = texture(uGBufferAlbedo, vTexCoord);
 
-    // Compute the diffuse lighting contribution
-    vec3 diffuse = diffuseStrength * uLightColor * uLightIntensity;
+    vec3 diffuse = GetDiffuseLight(worldPosition, normal);
+    FragColor = texColor * (vec4(diffuse, 1) + vec4(uAmbientLight.rgb, 1));
 
-    // Sample the texture color
-    vec4 texColor = texture(uTexture, vTexCoord);
+    // Later forward passes depth test against the G-buffer
+    gl_FragDepth = depth;
+}
+
+#else
 
+void main()
+{
+    vec3 diffuse = GetDiffuseLight(vFragPos, normalize(vNormal));
 
+    // Sample the texture color
+    vec4 texColor = texture(uTexture, vTexCoord);
 
     // Combine texture color with diffuse lighting
-    FragColor = texColor * ( vec4(diffuse, 1) + vec4(uAmbientLight, 1));
+    FragColor = texColor * (vec4(diffuse, 1) + vec4(uAmbientLight.rgb, 1));
 }
 
-#endif
\ No newline at end of file
+#endif
+
+#endif
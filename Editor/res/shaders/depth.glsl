@@ -0,0 +1,55 @@
+
+// Depth only program for the pre-pass, reads nothing but the position stream
+
+layout(std140) uniform ViewData
+{
+    mat4 uView;             // View matrix
+    mat4 uProjection;       // Projection matrix
+    mat4 uViewProjection;   // Projection * view
+    vec4 uCameraPosition;   // Camera position in world space
+    mat4 uInverseViewProjection; // Clip space back to world space
+};
+
+#if defined(VERTEX)
+
+layout(location = 0) in vec3 aPosition;   // Vertex position
+
+#if defined(INDIRECT)
+layout(std430, binding = 0) readonly buffer ObjectBuffer
+{
+    mat4 uObjects[];                      // Per-draw model matrices, indexed by base instance
+};
+#elif defined(INSTANCED)
+layout(location = 4) in mat4 aModel;      // Per-instance model matrix (locations 4..7)
+#else
+layout(std140) uniform ObjectData
+{
+    mat4 uModel;                          // Model transformation matrix
+};
+#endif
+
+// Same expression as the main pass, so GL_EQUAL testing sees identical depth
+invariant gl_Position;
+
+void main()
+{
+#if defined(INDIRECT)
+    mat4 model = uObjects[gl_BaseInstance + gl_InstanceID];
+#elif defined(INSTANCED)
+    mat4 model = aModel;
+#else
+    mat4 model = uModel;
+#endif
+
+    mat4 mvp = uViewProjection * model;
+    gl_Position = mvp * vec4(aPosition, 1.0);
+}
+
+#endif
+#if defined(FRAGMENT)
+
+void main()
+{
+}
+
+#endif
@@ -0,0 +1,27 @@
+
+// Depth only program for shadow map passes
+
+#if defined(VERTEX)
+
+layout(location = 0) in vec3 aPosition;   // Vertex position
+
+layout(std140) uniform ObjectData
+{
+    mat4 uModel;                          // Model transformation matrix
+};
+
+uniform mat4 uLightViewProjection;       // Light view-projection of the cascade being rendered
+
+void main()
+{
+    gl_Position = uLightViewProjection * uModel * vec4(aPosition, 1.0);
+}
+
+#endif
+#if defined(FRAGMENT)
+
+void main()
+{
+}
+
+#endif
@@ -0,0 +1,53 @@
+
+// Upscales the rendered part of the view with contrast adaptive sharpening
+
+#if defined(VERTEX)
+
+layout(location = 0) in vec3 aPosition;   // Fullscreen quad, already in clip space
+
+out vec2 vTexCoord;
+
+void main()
+{
+    gl_Position = vec4(aPosition.xy, 0.0, 1.0);
+    vTexCoord = aPosition.xy * 0.5 + 0.5;
+}
+
+#endif
+#if defined(FRAGMENT)
+
+in vec2 vTexCoord;
+out vec4 FragColor;
+
+uniform sampler2D uSource;
+uniform vec2 uSourceScale;     // Rendered part of the source in texture coordinates
+uniform vec2 uSourceTexel;     // 1 / source size
+uniform float uSharpness;      // 0 to 1
+
+vec3 Fetch(vec2 uv)
+{
+    // Never sample past the rendered rectangle
+    return texture(uSource, clamp(uv, 0.5 * uSourceTexel, uSourceScale - 0.5 * uSourceTexel)).rgb;
+}
+
+void main()
+{
+    vec2 uv = vTexCoord * uSourceScale;
+
+    vec3 center = Fetch(uv);
+    vec3 north = Fetch(uv + vec2(0.0, uSourceTexel.y));
+    vec3 south = Fetch(uv - vec2(0.0, uSourceTexel.y));
+    vec3 east = Fetch(uv + vec2(uSourceTexel.x, 0.0));
+    vec3 west = Fetch(uv - vec2(uSourceTexel.x, 0.0));
+
+    // Less sharpening where the neighbourhood already has strong contrast, so edges do not ring
+    vec3 low = min(center, min(min(north, south), min(east, west)));
+    vec3 high = max(center, max(max(north, south), max(east, west)));
+    vec3 amount = sqrt(clamp(min(low, 1.0 - high) / max(high, vec3(1e-4)), 0.0, 1.0));
+    vec3 weight = -amount * mix(0.125, 0.2, uSharpness);
+
+    vec3 color = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+    FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
+
+#endif
@@ -4,6 +4,8 @@
 
 #include "Application.h"
 #include "System/Input.h"
+#include "Interface/GpuMemory.h"
+#include "Rendering/MeshArena.h"
 #include <iostream>
 #include <filesystem>
 #include <glm/glm.hpp>
@@ -37,7 +39,7 @@ std::filesystem::path ResolveScenePath(const std::filesystem::path& relativePath
 
 Application::Application()
     :
-    window({1920, 1080, "OpenRenderer"}),
+    window({1920, 1080, "OpenRenderer", 4, 6}),
     frameStats({0, 0}), selected(entt::null)
 {
 
@@ -68,7 +70,10 @@ Application::Application()
         scene->AddComponent<Camera>(cameraEntity, true);
     }
 
-    frameBuffer = std::make_shared<FrameBuffer>(window.GetWidth(), window.GetHeight());
+    {
+        GpuMemoryScope memoryScope("Scene View");
+        frameBuffer = std::make_shared<FrameBuffer>(window.GetWidth(), window.GetHeight());
+    }
 
     Camera& camera = scene->GetComponent<Camera>(cameraEntity);
     Transform& transform = scene->GetComponent<Transform>(cameraEntity);
@@ -76,8 +81,10 @@ Application::Application()
 
     cameraController = std::make_shared<CameraController>(camera, transform, 0.2);
 
-    renderer = std::make_unique<Renderer>();
-    renderer->AddLight(PointLight{glm::vec3(0), glm::vec3(1), 1});
+    {
+        GpuMemoryScope memoryScope("Renderer");
+        renderer = std::make_unique<Renderer>();
+    }
 
     UI::Init();
 
@@ -95,27 +102,52 @@ void Application::Run()
     while (true)
     {
         frameStats.Begin();
+
+        // Waiting on the GPU before polling keeps the input the frame renders as fresh as possible
+        FramePacer& pacer = FramePacer::Get();
+        pacer.BeginFrame();
+        window.PollEvents();
+        Input::update();
+        cameraController->Update();
+
+        ResourceRegistry::Get().UpdateTextureResidency(pacer.GetFrameIndex());
+        MeshArena::Get().Update(pacer.GetFrameIndex(), pacer.GetCompletedFrames());
+
+        GpuProfiler& profiler = GpuProfiler::Get();
+        profiler.BeginFrame();
         Camera& camera = scene->GetComponent<Camera>(cameraEntity);
 
         frameBuffer->Bind();
-        renderer->BeginScene(camera);
+        profiler.BeginScope("Scene View");
+        sceneViewResolution.BeginFrame(*frameBuffer);
+        if (sceneViewResolution.IsRenderSizeChanged())
+            renderer->OnRenderSizeChanged(sceneViewResolution.GetPreviousRenderSize());
+        renderer->BeginScene(camera, sceneViewPath);
         renderer->DrawScene(*scene.get());
+        renderer->EndScene();
+        sceneViewResolution.EndFrame();
+        {
+            GpuProfileScope upscaleScope("Upscale");
+            sceneViewResolution.Upscale(*frameBuffer, *renderer);
+        }
+        profiler.EndScope();
         frameBuffer->Unbind();
 
         //Drawing UI
+        profiler.BeginScope("UI");
         UI::Begin();
         UI::DrawMainMenuBar();
 
         UI::DrawHierarchyPanel(scene.get(), selected);
-        UI::DrawSceneViewPanel(frameBuffer.get(), camera, selected, scene.get());
-        UI::DrawSettingsPanel(frameStats);
+        UI::DrawSceneViewPanel(frameBuffer.get(), sceneViewResolution, camera, selected, scene.get());
+        UI::DrawSettingsPanel(frameStats, *renderer, sceneViewPath, sceneViewResolution);
 
         UI::End();
+        profiler.EndScope();
+        profiler.EndFrame();
 
-        Input::update();
-        cameraController->Update();
-        // Update window
-        window.Update();
+        window.SwapBuffers();
+        pacer.EndFrame();
 
         frameStats.End();
     }
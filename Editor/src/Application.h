@@ -6,9 +6,12 @@
 #define APPLICATION_H
 
 #include "System/Window.h"
+#include "System/FramePacer.h"
 #include "System/Events/Event.h"
 #include "Rendering/Camera.h"
 #include "Rendering/Renderer.h"
+#include "Rendering/DynamicResolution.h"
+#include "Rendering/GpuProfiler.h"
 #include "Rendering/Scene.h"
 
 #include "Interface/FrameBuffer.h"
@@ -25,6 +28,8 @@ private:
     std::unique_ptr<Renderer> renderer;
     std::shared_ptr<CameraController> cameraController;
     std::shared_ptr<FrameBuffer> frameBuffer;
+    RenderPath sceneViewPath = RenderPath::Forward;
+    DynamicResolution sceneViewResolution;
     entt::entity selected;
     entt::entity cameraEntity;
     Serializer serializer;
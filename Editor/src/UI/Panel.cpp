@@ -7,7 +7,13 @@
 
 #include "../Application.h"
 #include "imgui.h"
+#include "Interface/GLResource.h"
+#include "Interface/GpuMemory.h"
 #include "Rendering/Scene.h"
+#include "Rendering/GpuProfiler.h"
+#include "Rendering/MeshArena.h"
+#include "Rendering/ResourceRegistry.h"
+#include "System/FramePacer.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <entt/entt.hpp>
@@ -29,16 +35,17 @@
 
 namespace UI
 {
-    void DrawSceneViewPanel(FrameBuffer* frameBuffer, Camera& viewCamera, entt::entity selected, Scene* scene)
+    void DrawSceneViewPanel(FrameBuffer* frameBuffer, const DynamicResolution& resolution, Camera& viewCamera, entt::entity selected, Scene* scene)
     {
         ImGui::Begin("Scene View");
         static ImVec2 prevSize(0,0);
 
 
         ImVec2 currentPanelSize = ImGui::GetContentRegionAvail();
-        //Updating camera and framebuffer every frame
+        //Updating camera every frame, the framebuffer only when the panel was resized
         viewCamera.Reset(currentPanelSize.x, currentPanelSize.y);
-        frameBuffer->Update(currentPanelSize.x, currentPanelSize.y);
+        if (frameBuffer->GetWidth() != static_cast<int>(currentPanelSize.x) || frameBuffer->GetHeight() != static_cast<int>(currentPanelSize.y))
+            frameBuffer->Update(currentPanelSize.x, currentPanelSize.y);
 
         // Check if the texture ID is valid
         if (!(frameBuffer && frameBuffer->GetTextureId() != 0))
@@ -47,10 +54,11 @@ namespace UI
             ImGui::End();
         }
 
-        // Render the framebuffer texture
-        ImGui::Image(frameBuffer->GetTextureId(),
+        // Render the framebuffer texture, with dynamic resolution only its rendered corner is stretched over the panel
+        const glm::vec2 uv = resolution.GetOutputUV();
+        ImGui::Image(resolution.GetOutputTexture(),
                      ImVec2(frameBuffer->GetWidth(), frameBuffer->GetHeight()),
-                     ImVec2(0, 1), ImVec2(1, 0)); // Flip texture coordinates (bottom-left to top-left)
+                     ImVec2(0, uv.y), ImVec2(uv.x, 0)); // Flip texture coordinates (bottom-left to top-left)
 
         ImGuizmo::SetDrawlist();
         ImGuizmo::SetOrthographic(false);
@@ -83,6 +91,7 @@ namespace UI
                 transform.position = newPosition;
                 transform.rotation = newRotation;
                 transform.scale = newScale;
+                scene->MarkUpdated<Transform>(selected);
             }
         }
 
@@ -91,13 +100,172 @@ namespace UI
 
 
 
-    void DrawSettingsPanel(FrameStats frameStats) 
+    void DrawSettingsPanel(FrameStats frameStats, Renderer& renderer, RenderPath& sceneViewPath, DynamicResolution& sceneViewResolution)
     {
+        const RenderStats& renderStats = renderer.GetStats();
+
         ImGui::Begin("Render Stats");
 
         ImGui::Text("%s", std::string("Delta Time : " + std::to_string(frameStats.DeltaTime)).c_str());
         ImGui::Text("%s", std::string("FPS : " + std::to_string(1/frameStats.DeltaTime)).c_str());
 
+        FramePacer& pacer = FramePacer::Get();
+        int framesInFlight = static_cast<int>(pacer.GetFramesInFlight());
+        if (ImGui::SliderInt("Frames In Flight", &framesInFlight, 1, FramePacer::MaxFramesInFlight))
+            pacer.SetFramesInFlight(static_cast<unsigned int>(framesInFlight));
+
+        bool lowLatency = pacer.IsLowLatency();
+        if (ImGui::Checkbox("Low Latency", &lowLatency))
+            pacer.SetLowLatency(lowLatency);
+        ImGui::Text("GPU Wait : %.2f ms", pacer.GetWaitTime());
+        ImGui::Text("Pending GL Deletions : %zu", GLDeletionQueue::GetPendingCount());
+
+        const char* renderPaths[] = { "Forward", "Deferred" };
+        int renderPath = static_cast<int>(sceneViewPath);
+        if (ImGui::Combo("Render Path", &renderPath, renderPaths, IM_ARRAYSIZE(renderPaths)))
+            sceneViewPath = static_cast<RenderPath>(renderPath);
+
+        const char* prepassModes[] = { "Off", "On", "Auto" };
+        int prepassMode = static_cast<int>(renderer.GetDepthPrepass());
+        if (ImGui::Combo("Depth Pre-pass", &prepassMode, prepassModes, IM_ARRAYSIZE(prepassModes)))
+            renderer.SetDepthPrepass(static_cast<DepthPrepassMode>(prepassMode));
+
+        bool equalTest = renderer.IsDepthPrepassEqualTest();
+        if (ImGui::Checkbox("Equal Depth Test", &equalTest))
+            renderer.SetDepthPrepassEqualTest(equalTest);
+
+        bool dynamicResolution = sceneViewResolution.IsEnabled();
+        if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolution))
+            sceneViewResolution.SetEnabled(dynamicResolution);
+
+        if (dynamicResolution)
+        {
+            float targetFrameRate = sceneViewResolution.GetTargetFrameRate();
+            if (ImGui::SliderFloat("Target FPS", &targetFrameRate, 15.0f, 240.0f, "%.0f"))
+                sceneViewResolution.SetTargetFrameRate(targetFrameRate);
+
+            float minScale = sceneViewResolution.GetMinScale();
+            if (ImGui::SliderFloat("Min Scale", &minScale, 0.1f, 1.0f))
+                sceneViewResolution.SetScaleRange(minScale, sceneViewResolution.GetMaxScale());
+
+            const char* filters[] = { "Bilinear", "Sharpen" };
+            int filter = static_cast<int>(sceneViewResolution.GetFilter());
+            if (ImGui::Combo("Upscale Filter", &filter, filters, IM_ARRAYSIZE(filters)))
+                sceneViewResolution.SetFilter(static_cast<UpscaleFilter>(filter));
+
+            float sharpness = sceneViewResolution.GetSharpness();
+            if (sceneViewResolution.GetFilter() == UpscaleFilter::Sharpen && ImGui::SliderFloat("Sharpness", &sharpness, 0.0f, 1.0f))
+                sceneViewResolution.SetSharpness(sharpness);
+        }
+
+        const glm::ivec2 renderSize = sceneViewResolution.GetRenderSize();
+        ImGui::Text("Render Scale : %.2f (%d x %d)", sceneViewResolution.GetScale(), renderSize.x, renderSize.y);
+        ImGui::Text("Scene GPU Time : %.2f ms", sceneViewResolution.GetGpuTime());
+
+        GpuProfiler& profiler = GpuProfiler::Get();
+        if (ImGui::CollapsingHeader("GPU Timings", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            bool profiling = profiler.IsEnabled();
+            if (ImGui::Checkbox("Profile GPU", &profiling))
+                profiler.SetEnabled(profiling);
+            ImGui::SameLine();
+            if (ImGui::Button("Reset"))
+                profiler.Reset();
+
+            ImGui::Text("GPU Frame : %.3f ms", profiler.GetFrameTime());
+
+            static std::vector<GpuProfiler::ScopeTiming> timings;
+            profiler.GetTimings(timings);
+            for (const GpuProfiler::ScopeTiming& timing : timings)
+            {
+                ImGui::Text("%*s%s : %.3f ms (max %.3f)", timing.Depth * 2, "", timing.Name.c_str(),
+                            timing.AverageMs, timing.MaxMs);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("GPU Memory", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            constexpr float MiB = 1024.0f * 1024.0f;
+
+            int budget = static_cast<int>(GpuMemory::GetBudget() >> 20);
+            if (ImGui::SliderInt("Budget (MB)", &budget, 64, 8192))
+                GpuMemory::SetBudget(static_cast<size_t>(budget) << 20);
+
+            const float total = GpuMemory::GetTotal() / MiB;
+            const float budgetMiB = GpuMemory::GetBudget() / MiB;
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%.1f / %.0f MB", total, budgetMiB);
+            ImGui::ProgressBar(budgetMiB > 0.0f ? total / budgetMiB : 1.0f, ImVec2(-1.0f, 0.0f), overlay);
+
+            for (size_t i = 0; i < GpuMemory::CategoryCount; i++)
+            {
+                const GpuMemoryCategory category = static_cast<GpuMemoryCategory>(i);
+                ImGui::Text("%s : %.2f MB", GpuMemory::GetCategoryName(category), GpuMemory::GetTotal(category) / MiB);
+            }
+
+            const ResourceRegistry::TextureResidency& residency = ResourceRegistry::Get().GetTextureResidency();
+            ImGui::Text("Textures Demoted : %u, Evicted : %u", residency.Demoted, residency.Evicted);
+
+            if (ImGui::TreeNode("Mesh Arena"))
+            {
+                MeshArena& arena = MeshArena::Get();
+                static std::vector<MeshArena::PoolStats> pools;
+                arena.GetPoolStats(pools);
+                for (size_t i = 0; i < pools.size(); i++)
+                {
+                    const MeshArena::PoolStats& pool = pools[i];
+                    ImGui::Text("Pool %zu (%u byte vertices) : %u meshes", i, pool.Stride, pool.Meshes);
+                    ImGui::Text("  Vertices : %u / %u, Indices : %u / %u", pool.VerticesUsed, pool.VertexCapacity,
+                                pool.IndicesUsed, pool.IndexCapacity);
+                    ImGui::Text("  Fragmentation : %.0f%%", pool.Fragmentation * 100.0f);
+                }
+                ImGui::Text("Compactions : %u", arena.GetCompactionCount());
+                if (ImGui::Button("Compact"))
+                    arena.Compact();
+                ImGui::TreePop();
+            }
+
+            if (ImGui::TreeNode("Largest Owners"))
+            {
+                static std::vector<GpuMemory::OwnerUsage> owners;
+                GpuMemory::GetOwners(owners);
+                for (size_t i = 0; i < owners.size() && i < 16; i++)
+                    ImGui::Text("%s : %.2f MB", owners[i].Name.c_str(), owners[i].Bytes / MiB);
+                ImGui::TreePop();
+            }
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Meshes Submitted : %u", renderStats.MeshesSubmitted);
+        ImGui::Text("Entities Culled : %u", renderStats.EntitiesCulled);
+        ImGui::Text("Entities Occluded : %u", renderStats.EntitiesOccluded);
+        ImGui::Text("Occluder Triangles : %u", renderStats.OccluderTriangles);
+        ImGui::Text("Meshes Culled : %u", renderStats.MeshesCulled);
+        ImGui::Text("Triangles Submitted : %u", renderStats.TrianglesSubmitted);
+        ImGui::Text("Meshes At Reduced LOD : %u", renderStats.MeshesLodReduced);
+        ImGui::Text("Point Lights : %u", renderStats.PointLights);
+        ImGui::Text("Light Assignments : %u", renderStats.LightAssignments);
+        if (renderStats.LightAssignmentsDropped > 0)
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Light Assignments Dropped : %u", renderStats.LightAssignmentsDropped);
+        ImGui::Text("Shadow Cascades Rendered : %u", renderStats.ShadowCascadesRendered);
+        ImGui::Text("Shadow Casters : %u", renderStats.ShadowCasters);
+        ImGui::Text("Shadow Draw Calls : %u", renderStats.ShadowDrawCalls);
+        ImGui::Text("Overdraw : %.2f", renderStats.Overdraw);
+        ImGui::Text("Depth Pre-pass : %s", renderStats.DepthPrepass ? "On" : "Off");
+        ImGui::Text("Depth Pre-pass Draws : %u", renderStats.DepthPrepassDraws);
+        ImGui::Text("Render Passes : %u (%u culled)", renderStats.RenderPasses, renderStats.RenderPassesCulled);
+        ImGui::Text("Transient Textures : %u", renderStats.TransientTextures);
+        ImGui::Text("Render Target Textures : %u (%u KiB)", renderStats.RenderTargetTextures, renderStats.RenderTargetMemory);
+        ImGui::Text("Draw Calls : %u", renderStats.DrawCalls);
+        ImGui::Text("Instanced Draws : %u", renderStats.InstancedDraws);
+        ImGui::Text("Indirect Commands : %u", renderStats.IndirectCommands);
+        ImGui::Text("Shader Binds : %u", renderStats.ShaderBinds);
+        ImGui::Text("Texture Binds : %u", renderStats.TextureBinds);
+        ImGui::Text("Vertex Array Binds : %u", renderStats.VertexArrayBinds);
+        ImGui::Text("Uniform Uploads : %u", renderStats.UniformUploads);
+        ImGui::Text("GL State Calls Issued : %u", renderStats.StateCallsIssued);
+        ImGui::Text("Redundant GL Calls Skipped : %u", renderStats.RedundantCallsSkipped);
+
         ImGui::End();
     }
 
@@ -187,9 +355,12 @@ namespace UI
 
             if (ImGui::TreeNodeEx("Transform"))
             {
-                ImGui::DragFloat3("Position", &transform.position.x, 0.1f);
-                ImGui::DragFloat3("Rotation", &transform.rotation.x, 1.0f);
-                ImGui::DragFloat3("Scale", &transform.scale.x, 0.1f);
+                bool changed = ImGui::DragFloat3("Position", &transform.position.x, 0.1f);
+                changed |= ImGui::DragFloat3("Rotation", &transform.rotation.x, 1.0f);
+                changed |= ImGui::DragFloat3("Scale", &transform.scale.x, 0.1f);
+
+                if (changed)
+                    scene->MarkUpdated<Transform>(selected);
 
                 if (scene->HasComponent<Camera>(selected))
                 {
@@ -225,6 +396,7 @@ namespace UI
                     if (filePath)
                     {
                         model = Model(filePath);
+                        scene->MarkUpdated<Model>(selected);
                     }
                 }
 
@@ -236,18 +408,96 @@ namespace UI
                 ImGui::TreePop();
             }
         }
+
+        if (scene->HasComponent<PointLight>(selected))
+        {
+            PointLight& light = scene->GetComponent<PointLight>(selected);
+
+            if (ImGui::TreeNodeEx("Point Light"))
+            {
+                ImGui::ColorEdit3("Color", &light.color.x);
+                ImGui::DragFloat("Intensity", &light.intensity, 0.05f, 0.0f, 100.0f);
+                ImGui::DragFloat("Radius", &light.radius, 0.1f, 0.01f, 1000.0f);
+
+                if (ImGui::Button("Remove"))
+                {
+                    scene->RemoveComponent<PointLight>(selected);
+                }
+
+                ImGui::TreePop();
+            }
+        }
+
+        if (scene->HasComponent<DirectionalLight>(selected))
+        {
+            DirectionalLight& light = scene->GetComponent<DirectionalLight>(selected);
+
+            if (ImGui::TreeNodeEx("Directional Light"))
+            {
+                ImGui::ColorEdit3("Color", &light.color.x);
+                ImGui::DragFloat("Intensity", &light.intensity, 0.05f, 0.0f, 100.0f);
+                ImGui::Checkbox("Cast Shadows", &light.castShadows);
+
+                if (ImGui::Button("Remove"))
+                {
+                    scene->RemoveComponent<DirectionalLight>(selected);
+                }
+
+                ImGui::TreePop();
+            }
+        }
+
+        if (scene->HasComponent<Occluder>(selected))
+        {
+            Occluder& occluder = scene->GetComponent<Occluder>(selected);
+
+            if (ImGui::TreeNodeEx("Occluder"))
+            {
+                ImGui::Checkbox("Enabled", &occluder.enabled);
+
+                if (scene->HasComponent<Model>(selected) && !scene->GetComponent<Model>(selected).HasOccluderGeometry())
+                    ImGui::Text("Model is too detailed to occlude");
+
+                if (ImGui::Button("Remove"))
+                {
+                    scene->RemoveComponent<Occluder>(selected);
+                }
+
+                ImGui::TreePop();
+            }
+        }
+
+        if (scene->HasComponent<Static>(selected))
+        {
+            Static& marker = scene->GetComponent<Static>(selected);
+
+            if (ImGui::TreeNodeEx("Static"))
+            {
+                if (ImGui::Checkbox("Enabled", &marker.enabled))
+                    scene->MarkUpdated<Static>(selected);
+
+                if (ImGui::Button("Remove"))
+                {
+                    scene->RemoveComponent<Static>(selected);
+                }
+
+                ImGui::TreePop();
+            }
+        }
         
 
-        if (scene->HasComponent<Material>(selected))
+        if (scene->HasComponent<MaterialHandle>(selected))
         {
-            Material& material = scene->GetComponent<Material>(selected);
+            ResourceRegistry& resources = ResourceRegistry::Get();
+            const MaterialHandle materialHandle = scene->GetComponent<MaterialHandle>(selected);
+            Material* material = resources.GetMaterial(materialHandle);
 
-            if (ImGui::TreeNodeEx("Material"))
+            if (material && ImGui::TreeNodeEx("Material"))
             {
-                ImGui::Text("%s", material.Name.c_str());
+                ImGui::Text("%s", material->Name.c_str());
 
                 ImGui::Text("Albedo");
-                ImGui::Image(material.Albedo.GetId(), ImVec2(100, 100));
+                ImGui::Image(resources.ResolveTexture(material->Albedo).GetId(), ImVec2(100, 100));
 
 
                 if (ImGui::Button("Load"))
@@ -259,14 +509,14 @@ namespace UI
 
                     if (filePath)
                     {
-                        material.Albedo = Texture(filePath);
+                        material->Albedo = resources.LoadTexture(filePath);
                     }
                 }
 
 
                 if (ImGui::Button("Remove"))
                 {
-                    scene->RemoveComponent<Material>(selected);
+                    scene->RemoveComponent<MaterialHandle>(selected);
                 }
 
                 ImGui::TreePop();
@@ -299,7 +549,9 @@ namespace UI
 
             if (ImGui::MenuItem("Material"))
             {
-                scene->AddComponent<Material>(selected, Material{Texture::DefaultTexture, Shader::DefaultShader, "default"});
+                ResourceRegistry& resources = ResourceRegistry::Get();
+                if (!scene->HasComponent<MaterialHandle>(selected))
+                    scene->AddComponent<MaterialHandle>(selected, resources.CreateMaterial(Material{resources.GetDefaultTexture(), resources.GetDefaultShader(), "default"}));
             }
 
             if (ImGui::MenuItem("Model"))
@@ -307,6 +559,26 @@ namespace UI
                 scene->AddComponent<Model>(selected);
             }
 
+            if (ImGui::MenuItem("Point Light"))
+            {
+                scene->AddComponent<PointLight>(selected);
+            }
+
+            if (ImGui::MenuItem("Directional Light"))
+            {
+                scene->AddComponent<DirectionalLight>(selected);
+            }
+
+            if (ImGui::MenuItem("Occluder"))
+            {
+                scene->AddComponent<Occluder>(selected);
+            }
+
+            if (ImGui::MenuItem("Static"))
+            {
+                scene->AddComponent<Static>(selected);
+            }
+
             ImGui::EndPopup();
         }
 
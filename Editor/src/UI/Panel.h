@@ -2,6 +2,7 @@
 // Created by Nazarii on 11/29/2024.
 //
 #pragma once
+#include <cstdint>
 #include <string>
 
 #include <imgui.h>
@@ -10,14 +11,17 @@
 
 
 struct FrameStats;
+class Renderer;
+class DynamicResolution;
+enum class RenderPath : uint8_t;
 
 
 namespace UI
 {
     void DrawMainMenuBar();
-    void DrawSettingsPanel(FrameStats frameStats);
+    void DrawSettingsPanel(FrameStats frameStats, Renderer& renderer, RenderPath& sceneViewPath, DynamicResolution& sceneViewResolution);
     void DrawHierarchyPanel(Scene* scene, entt::entity& selected);
-    void DrawSceneViewPanel(FrameBuffer* frameBuffer, Camera& viewCamera, entt::entity selected, Scene* scene);
+    void DrawSceneViewPanel(FrameBuffer* frameBuffer, const DynamicResolution& resolution, Camera& viewCamera, entt::entity selected, Scene* scene);
 
 
 }  
@@ -12,6 +12,7 @@
 #include "imgui_impl_opengl3.h"
 #include "GLFW/glfw3.h"
 #include "System/Window.h"
+#include "Interface/GLStateCache.h"
 #include <tinyfiledialogs.h>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/type_ptr.hpp>
@@ -84,6 +85,9 @@ namespace UI
             // Restore the OpenGL rendering context to the main window DC, since platform windows might have changed it.
             glfwMakeContextCurrent(Window::currentWindow->GetHandle());
         }
+
+        // ImGui binds its own program, buffers and textures and changes blend state
+        GLStateCache::Invalidate();
     }
 
     void SetDarkTheme()
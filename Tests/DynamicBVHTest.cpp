@@ -0,0 +1,130 @@
+#include "Rendering/DynamicBVH.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+/*
+	Builds trees from boxes in the worst insertion order for a naive tree and from
+	random boxes, checks the height stays logarithmic and that frustum and box
+	queries return exactly what testing every fat box would.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+static AABB Box(const glm::vec3& center, float halfSize)
+{
+	return AABB{ center - glm::vec3(halfSize), center + glm::vec3(halfSize) };
+}
+
+static entt::entity Entity(size_t i)
+{
+	return static_cast<entt::entity>(i);
+}
+
+static std::vector<entt::entity> Sorted(std::vector<entt::entity> entities)
+{
+	std::sort(entities.begin(), entities.end());
+	return entities;
+}
+
+// The plane by plane test the masked traversal skips planes of
+static bool Touches(const Frustum& frustum, const AABB& box)
+{
+	const glm::vec3 center = box.GetCenter();
+	const glm::vec3 extents = box.GetExtents();
+	for (const glm::vec4& plane : frustum.Planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w + glm::dot(glm::abs(glm::vec3(plane)), extents) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+static void TestSortedInsertStaysBalanced()
+{
+	// A row of boxes inserted in order, every insert lands next to the last one
+	DynamicBVH bvh(0.0f);
+	const size_t count = 1024;
+	for (size_t i = 0; i < count; i++)
+		bvh.Insert(Box(glm::vec3(static_cast<float>(i) * 2.0f, 0.0f, 0.0f), 0.5f), Entity(i));
+
+	CHECK(bvh.Size() == count);
+	// Without the rotations this degenerates toward a list, log2(1024) is 10
+	CHECK(bvh.GetHeight() <= 14);
+
+	std::vector<entt::entity> result;
+	bvh.Query(Box(glm::vec3(100.0f, 0.0f, 0.0f), 1.0f), result);
+	CHECK(result.size() == 1 && result[0] == Entity(50));
+}
+
+static void TestSurfaceAreaInsert()
+{
+	// Two clusters far apart, a new box must join its own cluster's subtree
+	DynamicBVH bvh(0.0f);
+	for (size_t i = 0; i < 8; i++)
+	{
+		bvh.Insert(Box(glm::vec3(static_cast<float>(i), 0.0f, 0.0f), 0.4f), Entity(i));
+		bvh.Insert(Box(glm::vec3(1000.0f + static_cast<float>(i), 0.0f, 0.0f), 0.4f), Entity(100 + i));
+	}
+	CHECK(bvh.GetHeight() <= 5);
+
+	bvh.Insert(Box(glm::vec3(3.5f, 0.0f, 0.0f), 0.4f), Entity(200));
+
+	std::vector<entt::entity> result;
+	bvh.Query(AABB{ glm::vec3(-1.0f), glm::vec3(8.0f, 1.0f, 1.0f) }, result);
+	CHECK(result.size() == 9);
+	CHECK(std::find(result.begin(), result.end(), Entity(200)) != result.end());
+}
+
+static void TestFrustumQueryMatchesBruteForce()
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+	DynamicBVH bvh;
+	std::vector<int> proxies;
+	for (size_t i = 0; i < 2000; i++)
+		proxies.push_back(bvh.Insert(Box(glm::vec3(position(random), position(random), position(random)), size(random)), Entity(i)));
+
+	// Removing and moving leaves must not leave stale entries behind
+	for (size_t i = 0; i < proxies.size(); i += 3)
+		bvh.Remove(proxies[i]);
+	for (size_t i = 1; i < proxies.size(); i += 3)
+		bvh.Move(proxies[i], Box(glm::vec3(position(random), position(random), position(random)), size(random)));
+
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 60.0f);
+	const glm::vec3 eyes[] = { glm::vec3(0.0f), glm::vec3(40.0f, 10.0f, -30.0f), glm::vec3(-60.0f, 0.0f, 0.0f) };
+	for (const glm::vec3& eye : eyes)
+	{
+		const Frustum frustum = Frustum::FromMatrix(projection * glm::lookAt(eye, glm::vec3(5.0f, 0.0f, 5.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		std::vector<entt::entity> expected;
+		for (size_t i = 0; i < proxies.size(); i++)
+		{
+			if (i % 3 != 0 && Touches(frustum, bvh.GetFatBounds(proxies[i])))
+				expected.push_back(bvh.GetEntity(proxies[i]));
+		}
+
+		std::vector<entt::entity> result;
+		bvh.Query(frustum, result);
+		CHECK(!expected.empty());
+		CHECK(Sorted(result) == Sorted(expected));
+	}
+}
+
+int main()
+{
+	TestSortedInsertStaysBalanced();
+	TestSurfaceAreaInsert();
+	TestFrustumQueryMatchesBruteForce();
+
+	if (failures == 0)
+		std::printf("DynamicBVH: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}
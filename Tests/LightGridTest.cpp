@@ -0,0 +1,149 @@
+#include "Rendering/LightGrid.h"
+#include "System/JobSystem.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+/*
+	Assigns random point lights to the froxel grid and compares every froxel's
+	list with a sphere test against the froxel's box built from its unprojected
+	corners. Lights within a small tolerance of a box are allowed either way.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+static const float NearPlane = 0.1f;
+static const float FarPlane = 200.0f;
+
+static float SliceDepth(int slice)
+{
+	return NearPlane * std::pow(FarPlane / NearPlane, static_cast<float>(slice) / LightGrid::Slices);
+}
+
+// View space box of a froxel, from its eight corners
+static void FroxelBounds(const glm::mat4& inverseProjection, int x, int y, int slice, glm::vec3& low, glm::vec3& high)
+{
+	low = glm::vec3(1e30f);
+	high = glm::vec3(-1e30f);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		const float ndcX = -1.0f + 2.0f * static_cast<float>(x + (corner & 1)) / LightGrid::TilesX;
+		const float ndcY = -1.0f + 2.0f * static_cast<float>(y + ((corner >> 1) & 1)) / LightGrid::TilesY;
+		const float depth = SliceDepth(slice + ((corner >> 2) & 1));
+
+		glm::vec4 point = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+		const glm::vec3 view = glm::vec3(point / point.w);
+		const glm::vec3 scaled = view * (depth / -view.z);
+		low = glm::min(low, scaled);
+		high = glm::max(high, scaled);
+	}
+}
+
+static float DistanceSquared(const glm::vec3& point, const glm::vec3& low, const glm::vec3& high)
+{
+	const glm::vec3 delta = glm::max(glm::max(low - point, point - high), glm::vec3(0.0f));
+	return glm::dot(delta, delta);
+}
+
+static void CheckAssignment(LightGrid& grid)
+{
+	const glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 2.0f, 10.0f), glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projection = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, NearPlane, FarPlane);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> horizontal(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> depth(-120.0f, 20.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 8.0f);
+
+	std::vector<LightGrid::Light> lights(200);
+	for (LightGrid::Light& light : lights)
+	{
+		light.PositionRadius = glm::vec4(horizontal(random), horizontal(random) * 0.5f, depth(random), radius(random));
+		light.ColorIntensity = glm::vec4(1.0f);
+	}
+
+	grid.Build(view, projection, NearPlane, FarPlane, lights);
+
+	const std::vector<glm::uvec2>& clusters = grid.GetClusters();
+	const std::vector<uint32_t>& indices = grid.GetLightIndices();
+	CHECK(clusters.size() == static_cast<size_t>(LightGrid::ClusterCount));
+	CHECK(grid.GetDroppedAssignments() == 0);
+	CHECK(!indices.empty());
+
+	const glm::mat4 inverseProjection = glm::inverse(projection);
+	size_t missing = 0;
+	size_t extra = 0;
+	size_t nextOffset = 0;
+	for (int slice = 0; slice < LightGrid::Slices; slice++)
+	{
+		for (int y = 0; y < LightGrid::TilesY; y++)
+		{
+			for (int x = 0; x < LightGrid::TilesX; x++)
+			{
+				const glm::uvec2 cluster = clusters[LightGrid::GetClusterIndex(x, y, slice)];
+				// Lists are packed in cluster order
+				CHECK(cluster.x == nextOffset);
+				nextOffset = cluster.x + cluster.y;
+				if (nextOffset > indices.size())
+					return;
+
+				std::vector<uint8_t> listed(lights.size(), 0);
+				for (uint32_t i = cluster.x; i < cluster.x + cluster.y; i++)
+				{
+					CHECK(indices[i] < lights.size());
+					listed[indices[i]] = 1;
+				}
+
+				glm::vec3 low, high;
+				FroxelBounds(inverseProjection, x, y, slice, low, high);
+				for (size_t light = 0; light < lights.size(); light++)
+				{
+					const glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[light].PositionRadius), 1.0f));
+					const float radius = lights[light].PositionRadius.w;
+					const float distance = std::sqrt(DistanceSquared(center, low, high));
+					if (distance < radius - 1e-3f && !listed[light])
+						missing++;
+					if (distance > radius + 1e-3f && listed[light])
+						extra++;
+				}
+			}
+		}
+	}
+	CHECK(nextOffset == indices.size());
+	CHECK(missing == 0);
+	CHECK(extra == 0);
+}
+
+static void TestSliceParameters()
+{
+	LightGrid grid;
+	grid.Build(glm::mat4(1.0f), glm::perspective(glm::radians(60.0f), 1.0f, NearPlane, FarPlane), NearPlane, FarPlane, {});
+
+	// The shader's slice from depth lands on the slice boundaries the grid was built with
+	const glm::vec2 parameters = grid.GetSliceParameters();
+	for (int slice = 0; slice <= LightGrid::Slices; slice++)
+		CHECK(std::fabs(std::log(SliceDepth(slice)) * parameters.x + parameters.y - static_cast<float>(slice)) < 1e-3f);
+
+	for (const glm::uvec2& cluster : grid.GetClusters())
+		CHECK(cluster.y == 0);
+}
+
+int main()
+{
+	TestSliceParameters();
+
+	LightGrid serial;
+	CheckAssignment(serial);
+
+	JobSystem jobs(3);
+	LightGrid parallel(&jobs);
+	CheckAssignment(parallel);
+
+	if (failures == 0)
+		std::printf("LightGrid: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}
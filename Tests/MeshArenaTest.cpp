@@ -0,0 +1,288 @@
+#include "Rendering/MeshArena.h"
+#include "Interface/GLResource.h"
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+/*
+	Loads meshes into the MeshArena, unloads some, compacts and draws the rest.
+	The buffer and vertex array entry points are replaced with a CPU model of
+	them, and drawing reads every index through the vertex array state the way
+	glDrawElementsBaseVertex would, so this runs without a GL context.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+namespace FakeGL
+{
+	struct AttributeState
+	{
+		GLuint Buffer;
+		GLsizei Stride;
+		size_t Offset;
+	};
+
+	GLuint nextName = 1;
+	std::map<GLuint, std::vector<uint8_t>> buffers;
+	std::map<GLenum, GLuint> bound;
+	GLuint vertexArray = 0;
+	std::map<GLuint, GLuint> elementBuffers;
+	std::map<GLuint, std::map<GLuint, AttributeState>> attributes;
+
+	void APIENTRY GenNames(GLsizei count, GLuint* names)
+	{
+		for (GLsizei i = 0; i < count; i++)
+			names[i] = nextName++;
+	}
+
+	void APIENTRY DeleteBuffers(GLsizei count, const GLuint* names)
+	{
+		for (GLsizei i = 0; i < count; i++)
+			buffers.erase(names[i]);
+	}
+
+	void APIENTRY DeleteVertexArrays(GLsizei, const GLuint*) {}
+
+	void APIENTRY BindBuffer(GLenum target, GLuint buffer)
+	{
+		bound[target] = buffer;
+		if (target == GL_ELEMENT_ARRAY_BUFFER)
+			elementBuffers[vertexArray] = buffer;
+	}
+
+	void APIENTRY BindVertexArray(GLuint array)
+	{
+		vertexArray = array;
+	}
+
+	void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum)
+	{
+		std::vector<uint8_t>& buffer = buffers[bound[target]];
+		buffer.assign(static_cast<size_t>(size), 0);
+		if (data)
+			std::memcpy(buffer.data(), data, static_cast<size_t>(size));
+	}
+
+	void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		std::vector<uint8_t>& buffer = buffers[bound[target]];
+		CHECK(static_cast<size_t>(offset + size) <= buffer.size());
+		if (static_cast<size_t>(offset + size) <= buffer.size())
+			std::memcpy(buffer.data() + offset, data, static_cast<size_t>(size));
+	}
+
+	void APIENTRY CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+	{
+		const std::vector<uint8_t>& source = buffers[bound[readTarget]];
+		std::vector<uint8_t>& destination = buffers[bound[writeTarget]];
+		CHECK(static_cast<size_t>(readOffset + size) <= source.size());
+		CHECK(static_cast<size_t>(writeOffset + size) <= destination.size());
+		std::memcpy(destination.data() + writeOffset, source.data() + readOffset, static_cast<size_t>(size));
+	}
+
+	void APIENTRY EnableVertexAttribArray(GLuint) {}
+
+	void APIENTRY VertexAttribPointer(GLuint location, GLint, GLenum, GLboolean, GLsizei stride, const void* offset)
+	{
+		attributes[vertexArray][location] = AttributeState{ bound[GL_ARRAY_BUFFER], stride, reinterpret_cast<size_t>(offset) };
+	}
+
+	void Install()
+	{
+		glad_glGenBuffers = GenNames;
+		glad_glDeleteBuffers = DeleteBuffers;
+		glad_glGenVertexArrays = GenNames;
+		glad_glDeleteVertexArrays = DeleteVertexArrays;
+		glad_glBindBuffer = BindBuffer;
+		glad_glBindVertexArray = BindVertexArray;
+		glad_glBufferData = BufferData;
+		glad_glBufferSubData = BufferSubData;
+		glad_glCopyBufferSubData = CopyBufferSubData;
+		glad_glEnableVertexAttribArray = EnableVertexAttribArray;
+		glad_glVertexAttribPointer = VertexAttribPointer;
+	}
+
+	template<typename T>
+	T Read(GLuint buffer, size_t offset)
+	{
+		T value{};
+		const std::vector<uint8_t>& data = buffers[buffer];
+		if (offset + sizeof(T) <= data.size())
+			std::memcpy(&value, data.data() + offset, sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	T Fetch(GLuint array, GLuint location, unsigned int vertex)
+	{
+		const AttributeState& attribute = attributes[array][location];
+		return Read<T>(attribute.Buffer, attribute.Offset + static_cast<size_t>(vertex) * attribute.Stride);
+	}
+}
+
+// Both streams hold a value naming the mesh and the vertex, so any range that moved wrong shows up
+static uint32_t PositionValue(uint32_t mesh, uint32_t vertex) { return mesh << 16 | vertex; }
+static uint32_t AttributeValue(uint32_t mesh, uint32_t vertex) { return ~PositionValue(mesh, vertex); }
+
+struct TestMesh
+{
+	uint32_t Id;
+	unsigned int VertexCount;
+	std::unique_ptr<MeshGeometry> Geometry;
+};
+
+static VertexFormat TestFormat()
+{
+	VertexFormat format(2);
+	format[0].Stride = sizeof(uint32_t);
+	format[0].Attributes = { { Coordinates, 1, GL_UNSIGNED_INT, false, 0 } };
+	format[1].Stride = sizeof(uint32_t);
+	format[1].Attributes = { { NormalCoords, 1, GL_UNSIGNED_INT, false, 0 } };
+	return format;
+}
+
+static TestMesh Load(uint32_t id, unsigned int vertexCount)
+{
+	std::vector<uint32_t> positions(vertexCount);
+	std::vector<uint32_t> attributes(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		positions[i] = PositionValue(id, i);
+		attributes[i] = AttributeValue(id, i);
+	}
+
+	// Two triangles per vertex, reading it and its neighbours in reverse
+	std::vector<unsigned int> indices(vertexCount * 6);
+	for (size_t i = 0; i < indices.size(); i++)
+		indices[i] = static_cast<unsigned int>((indices.size() - 1 - i) % vertexCount);
+
+	const void* streams[] = { positions.data(), attributes.data() };
+	GeometryHandle handle = MeshArena::Get().Allocate(TestFormat(), streams, vertexCount, indices.data(), static_cast<unsigned int>(indices.size()));
+	return TestMesh{ id, vertexCount, std::make_unique<MeshGeometry>(handle) };
+}
+
+// What glDrawElementsBaseVertex of the mesh's range would fetch
+static bool Draw(const TestMesh& mesh)
+{
+	const MeshArena::Range* range = mesh.Geometry->GetRange();
+	if (!range || range->VertexCount != mesh.VertexCount || range->IndexCount != mesh.VertexCount * 6)
+		return false;
+
+	const GLuint array = MeshArena::Get().GetVertexArray(range->Pool).GetRendererID();
+	const GLuint elements = FakeGL::elementBuffers[array];
+	for (unsigned int i = 0; i < range->IndexCount; i++)
+	{
+		const unsigned int index = FakeGL::Read<unsigned int>(elements, (static_cast<size_t>(range->FirstIndex) + i) * sizeof(unsigned int));
+		const unsigned int expected = (range->IndexCount - 1 - i) % mesh.VertexCount;
+		if (index != expected)
+			return false;
+
+		const unsigned int vertex = range->BaseVertex + index;
+		if (FakeGL::Fetch<uint32_t>(array, Coordinates, vertex) != PositionValue(mesh.Id, index)
+			|| FakeGL::Fetch<uint32_t>(array, NormalCoords, vertex) != AttributeValue(mesh.Id, index))
+			return false;
+	}
+	return true;
+}
+
+static void TestFreeList()
+{
+	FreeListAllocator allocator(100);
+	const unsigned int a = allocator.Allocate(10);
+	const unsigned int b = allocator.Allocate(20);
+	const unsigned int c = allocator.Allocate(30);
+	CHECK(a == 0 && b == 10 && c == 30);
+
+	// The 20 hole is the best fit, not the 40 at the end
+	allocator.Free(b, 20);
+	CHECK(allocator.Allocate(15) == 10);
+	CHECK(allocator.GetFreeRangeCount() == 2);
+
+	// Neighbours merge back into one range
+	allocator.Free(a, 10);
+	allocator.Free(10, 15);
+	allocator.Free(c, 30);
+	CHECK(allocator.GetFreeSize() == 100 && allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFree() == 100);
+	CHECK(allocator.Allocate(101) == FreeListAllocator::Invalid);
+}
+
+static void TestLoadUnloadCompactDraw()
+{
+	MeshArena& arena = MeshArena::Get();
+	uint64_t frame = 1;
+	arena.Update(frame, 0);
+
+	std::vector<TestMesh> meshes;
+	for (uint32_t id = 0; id < 16; id++)
+		meshes.push_back(Load(id, 100 + id * 37));
+	for (const TestMesh& mesh : meshes)
+		CHECK(Draw(mesh));
+
+	std::vector<MeshArena::PoolStats> stats;
+	arena.GetPoolStats(stats);
+	CHECK(arena.GetPoolCount() == 1 && stats[0].Meshes == 16 && stats[0].Stride == 2 * sizeof(uint32_t));
+	const unsigned int loadedVertices = stats[0].VerticesUsed;
+
+	// Unload every other mesh
+	unsigned int unloadedVertices = 0;
+	for (size_t i = 0; i < meshes.size(); i += 2)
+	{
+		unloadedVertices += meshes[i].VertexCount;
+		meshes[i].Geometry.reset();
+	}
+
+	// Frames that may still draw the unloaded meshes keep their ranges taken
+	frame++;
+	arena.Update(frame, frame - 1);
+	arena.GetPoolStats(stats);
+	CHECK(stats[0].Meshes == 8 && stats[0].VerticesUsed == loadedVertices);
+
+	frame++;
+	arena.Update(frame, frame - 1);
+	arena.GetPoolStats(stats);
+	CHECK(stats[0].VerticesUsed == loadedVertices - unloadedVertices);
+	CHECK(stats[0].Fragmentation > 0.0f);
+
+	const unsigned int compactions = arena.GetCompactionCount();
+	const size_t pendingDeletes = GLDeletionQueue::GetPendingCount();
+	arena.Compact();
+	arena.GetPoolStats(stats);
+	CHECK(arena.GetCompactionCount() == compactions + 1);
+	CHECK(stats[0].Fragmentation == 0.0f && stats[0].VerticesUsed == loadedVertices - unloadedVertices);
+	// Two vertex streams and the index buffer, kept alive for the frames in flight
+	CHECK(GLDeletionQueue::GetPendingCount() == pendingDeletes + 3);
+
+	for (size_t i = 1; i < meshes.size(); i += 2)
+		CHECK(Draw(meshes[i]));
+
+	// Packed to the front, in the order they were
+	unsigned int nextVertex = 0;
+	for (size_t i = 1; i < meshes.size(); i += 2)
+	{
+		CHECK(meshes[i].Geometry->GetRange()->BaseVertex == nextVertex);
+		nextVertex += meshes[i].VertexCount;
+	}
+
+	// Loading after the compaction appends behind the packed meshes
+	meshes.push_back(Load(100, 500));
+	CHECK(meshes.back().Geometry->GetRange()->BaseVertex == nextVertex);
+	CHECK(Draw(meshes.back()));
+}
+
+int main()
+{
+	FakeGL::Install();
+
+	TestFreeList();
+	TestLoadUnloadCompactDraw();
+
+	if (failures == 0)
+		std::printf("MeshArena: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+#include "Rendering/MeshSimplifier.h"
+#include <cmath>
+#include <cstdio>
+#include <set>
+
+/*
+	Simplifies grids: a flat one must reduce to the target without error and
+	without moving its outline, a curved one must not collapse past the error
+	limit, and a UV seam through the middle must survive.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+struct Grid
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<unsigned int> Indices;
+};
+
+// size x size quads in the xy plane, z from height, the column at seam split into two copies
+static Grid MakeGrid(int size, float (*height)(float, float), int seam = -1)
+{
+	Grid grid;
+	const int row = size + 1;
+	for (int y = 0; y <= size; y++)
+	{
+		for (int x = 0; x <= size; x++)
+			grid.Positions.emplace_back(static_cast<float>(x), static_cast<float>(y), height(static_cast<float>(x), static_cast<float>(y)));
+	}
+
+	// Right of the seam, quads use copies of the seam vertices
+	std::vector<unsigned int> seamCopy(row);
+	for (int y = 0; y <= size && seam >= 0; y++)
+	{
+		seamCopy[y] = static_cast<unsigned int>(grid.Positions.size());
+		grid.Positions.push_back(grid.Positions[y * row + seam]);
+	}
+
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			auto vertex = [&](int vx, int vy)
+			{
+				return vx == seam && x >= seam ? seamCopy[vy] : static_cast<unsigned int>(vy * row + vx);
+			};
+			const unsigned int a = vertex(x, y), b = vertex(x + 1, y), c = vertex(x + 1, y + 1), d = vertex(x, y + 1);
+			grid.Indices.insert(grid.Indices.end(), { a, b, c, a, c, d });
+		}
+	}
+	return grid;
+}
+
+static float Flat(float, float) { return 0.0f; }
+static float Wavy(float x, float y) { return std::sin(x * 0.7f) * std::cos(y * 0.5f); }
+
+// Valid, non degenerate and still facing +z
+static bool IsValid(const Grid& grid, const std::vector<unsigned int>& indices)
+{
+	if (indices.size() % 3 != 0)
+		return false;
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			if (indices[i + e] >= grid.Positions.size())
+				return false;
+		}
+
+		const glm::vec3& p0 = grid.Positions[indices[i]];
+		const glm::vec3& p1 = grid.Positions[indices[i + 1]];
+		const glm::vec3& p2 = grid.Positions[indices[i + 2]];
+		if (glm::cross(p1 - p0, p2 - p0).z <= 0.0f)
+			return false;
+	}
+	return true;
+}
+
+static std::set<unsigned int> UsedVertices(const std::vector<unsigned int>& indices)
+{
+	return std::set<unsigned int>(indices.begin(), indices.end());
+}
+
+static void TestFlatGrid()
+{
+	const int size = 32;
+	const Grid grid = MakeGrid(size, Flat);
+
+	float error = -1.0f;
+	const size_t target = grid.Indices.size() / 8;
+	const std::vector<unsigned int> simplified = MeshSimplifier::Simplify(grid.Positions, grid.Indices, target, 1.0f, error);
+
+	CHECK(IsValid(grid, simplified));
+	CHECK(simplified.size() < grid.Indices.size() / 4);
+	CHECK(error >= 0.0f && error < 1e-3f);
+
+	// Borders only slide along themselves, so the corners stay and the area is unchanged
+	const std::set<unsigned int> used = UsedVertices(simplified);
+	const unsigned int corners[] = { 0u, static_cast<unsigned int>(size), static_cast<unsigned int>(size * (size + 1)), static_cast<unsigned int>((size + 1) * (size + 1) - 1) };
+	for (unsigned int corner : corners)
+		CHECK(used.count(corner) == 1);
+
+	float area = 0.0f;
+	for (size_t i = 0; i < simplified.size(); i += 3)
+	{
+		const glm::vec3& p0 = grid.Positions[simplified[i]];
+		area += glm::cross(grid.Positions[simplified[i + 1]] - p0, grid.Positions[simplified[i + 2]] - p0).z * 0.5f;
+	}
+	CHECK(std::fabs(area - static_cast<float>(size * size)) < 1e-2f);
+}
+
+static void TestErrorLimit()
+{
+	const Grid grid = MakeGrid(24, Wavy);
+
+	float error = 0.0f;
+	const float maxError = 0.05f;
+	const std::vector<unsigned int> simplified = MeshSimplifier::Simplify(grid.Positions, grid.Indices, 0, maxError, error);
+
+	CHECK(IsValid(grid, simplified));
+	CHECK(!simplified.empty() && simplified.size() < grid.Indices.size());
+	CHECK(error <= maxError);
+
+	// With no error allowed on a curved surface nothing collapses
+	const std::vector<unsigned int> exact = MeshSimplifier::Simplify(grid.Positions, grid.Indices, 0, 0.0f, error);
+	CHECK(exact == grid.Indices);
+	CHECK(error == 0.0f);
+}
+
+static void TestSeamIsKept()
+{
+	const int size = 16;
+	const int seam = size / 2;
+	const Grid grid = MakeGrid(size, Flat, seam);
+
+	float error = 0.0f;
+	const std::vector<unsigned int> simplified = MeshSimplifier::Simplify(grid.Positions, grid.Indices, grid.Indices.size() / 8, 1.0f, error);
+	CHECK(IsValid(grid, simplified));
+	CHECK(simplified.size() < grid.Indices.size() / 2);
+
+	// Both copies of every seam vertex are still drawn
+	const std::set<unsigned int> used = UsedVertices(simplified);
+	const unsigned int originalCount = static_cast<unsigned int>((size + 1) * (size + 1));
+	for (int y = 0; y <= size; y++)
+	{
+		CHECK(used.count(static_cast<unsigned int>(y * (size + 1) + seam)) == 1);
+		CHECK(used.count(originalCount + static_cast<unsigned int>(y)) == 1);
+	}
+}
+
+int main()
+{
+	TestFlatGrid();
+	TestErrorLimit();
+	TestSeamIsKept();
+
+	if (failures == 0)
+		std::printf("MeshSimplifier: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}
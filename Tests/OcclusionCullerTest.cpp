@@ -0,0 +1,66 @@
+#include "Rendering/OcclusionCuller.h"
+#include "System/JobSystem.h"
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+
+/*
+	Rasterizes one quad facing the camera and checks boxes behind, in front of and
+	beside it. Runs without a GL context.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+static AABB Box(const glm::vec3& center, float halfSize)
+{
+	return AABB{ center - glm::vec3(halfSize), center + glm::vec3(halfSize) };
+}
+
+static void TestQuadOccluder(JobSystem* jobs)
+{
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f),
+		static_cast<float>(OcclusionCuller::Width) / OcclusionCuller::Height, 0.1f, 100.0f);
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// 4 x 4 quad in the z = 0 plane
+	OccluderGeometry quad;
+	quad.Positions = { { -2.0f, -2.0f, 0.0f }, { 2.0f, -2.0f, 0.0f }, { 2.0f, 2.0f, 0.0f }, { -2.0f, 2.0f, 0.0f } };
+	quad.Indices = { 0, 1, 2, 0, 2, 3 };
+
+	OcclusionCuller culler(jobs);
+	culler.Begin(projection * view);
+	culler.AddOccluder(quad, glm::mat4(1.0f));
+	culler.Rasterize();
+
+	CHECK(culler.GetTriangleCount() == 2);
+	CHECK(!culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -5.0f), 0.5f)));
+	CHECK(culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, 2.0f), 0.5f)));
+	CHECK(culler.IsVisible(Box(glm::vec3(7.0f, 0.0f, -5.0f), 0.5f)));
+	// Straddling the edge of the quad, partly uncovered
+	CHECK(culler.IsVisible(Box(glm::vec3(4.0f, 0.0f, -5.0f), 0.5f)));
+
+	std::vector<AABB> boxes = { Box(glm::vec3(0.0f, 0.0f, -5.0f), 0.5f), Box(glm::vec3(0.0f, 0.0f, 2.0f), 0.5f) };
+	std::vector<uint8_t> visible;
+	culler.TestVisibility(boxes, visible);
+	CHECK(visible.size() == 2 && visible[0] == 0 && visible[1] == 1);
+
+	// A transformed occluder moved off to the side no longer hides the box
+	culler.Begin(projection * view);
+	culler.AddOccluder(quad, glm::translate(glm::mat4(1.0f), glm::vec3(-6.0f, 0.0f, 0.0f)));
+	culler.Rasterize();
+	CHECK(culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -5.0f), 0.5f)));
+}
+
+int main()
+{
+	TestQuadOccluder(nullptr);
+
+	JobSystem jobs(2);
+	TestQuadOccluder(&jobs);
+
+	if (failures == 0)
+		std::printf("OcclusionCuller: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}
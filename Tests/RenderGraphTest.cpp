@@ -0,0 +1,204 @@
+#include "Rendering/RenderGraph.h"
+#include "Interface/GLResource.h"
+#include <glad/glad.h>
+#include <cstdio>
+#include <map>
+
+/*
+	Compiles graphs and checks which passes are culled, how transients alias and
+	that pooled textures of a retired size are deleted. Compile only creates
+	textures, those entry points are replaced with a CPU model of them, so this
+	runs without a GL context. Nothing is executed.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+namespace FakeGL
+{
+	GLuint nextName = 1;
+	// Live textures and their size
+	std::map<GLuint, glm::ivec2> textures;
+	GLuint bound = 0;
+
+	void APIENTRY GenTextures(GLsizei count, GLuint* names)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			names[i] = nextName++;
+			textures[names[i]] = glm::ivec2(0);
+		}
+	}
+
+	void APIENTRY DeleteTextures(GLsizei count, const GLuint* names)
+	{
+		for (GLsizei i = 0; i < count; i++)
+			textures.erase(names[i]);
+	}
+
+	void APIENTRY BindTexture(GLenum, GLuint texture) { bound = texture; }
+	void APIENTRY ActiveTexture(GLenum) {}
+	void APIENTRY TexParameteri(GLenum, GLenum, GLint) {}
+
+	void APIENTRY TexImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum, GLenum, const void*)
+	{
+		textures[bound] = glm::ivec2(width, height);
+	}
+
+	void Install()
+	{
+		glad_glGenTextures = GenTextures;
+		glad_glDeleteTextures = DeleteTextures;
+		glad_glBindTexture = BindTexture;
+		glad_glActiveTexture = ActiveTexture;
+		glad_glTexParameteri = TexParameteri;
+		glad_glTexImage2D = TexImage2D;
+	}
+
+	size_t CountTextures(const glm::ivec2& size)
+	{
+		size_t count = 0;
+		for (const auto& texture : textures)
+			count += texture.second == size ? 1 : 0;
+		return count;
+	}
+}
+
+static void Nothing(const RenderGraph::Context&) {}
+
+static void TestPassCulling()
+{
+	RenderGraph graph;
+	graph.Reset();
+	const RenderGraphTextureDesc desc{ 64, 32, FrameBufferFormat::RGBA8 };
+	const RenderGraphResource view = graph.ImportFramebuffer("View", 0, glm::ivec4(0, 0, 64, 32));
+
+	// Nobody reads what it writes
+	graph.AddPass("Unused", [&](RenderGraph::Builder& builder) { builder.Write(builder.Create("Unused", desc)); }, Nothing);
+
+	// Only feeds a pass that is culled itself
+	RenderGraphResource chain = RenderGraph::InvalidResource;
+	graph.AddPass("ChainFirst", [&](RenderGraph::Builder& builder) { chain = builder.Write(builder.Create("Chain", desc)); }, Nothing);
+	graph.AddPass("ChainSecond", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(chain);
+		builder.Write(builder.Create("ChainOut", desc));
+	}, Nothing);
+
+	// Reaches the imported view, so both stay
+	RenderGraphResource lit = RenderGraph::InvalidResource;
+	graph.AddPass("Producer", [&](RenderGraph::Builder& builder) { lit = builder.Write(builder.Create("Lit", desc), LoadOp::Clear); }, Nothing);
+	graph.AddPass("Consumer", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(lit);
+		builder.Write(view);
+	}, Nothing);
+
+	// Unread output, kept for its side effect
+	graph.AddPass("Readback", [&](RenderGraph::Builder& builder)
+	{
+		builder.Write(builder.Create("Readback", desc));
+		builder.SetSideEffect();
+	}, Nothing);
+
+	graph.Compile();
+	const RenderGraph::Stats& stats = graph.GetStats();
+	CHECK(stats.Passes == 6);
+	CHECK(stats.PassesCulled == 3);
+	// Lit and Readback, the culled passes' transients never get a texture
+	CHECK(stats.TransientTextures == 2);
+	CHECK(FakeGL::CountTextures(glm::ivec2(64, 32)) == stats.PooledTextures);
+}
+
+static void TestAliasing()
+{
+	RenderGraph graph;
+	graph.Reset();
+	const RenderGraphTextureDesc desc{ 128, 128, FrameBufferFormat::RGBA16F };
+	const RenderGraphResource view = graph.ImportFramebuffer("View", 0, glm::ivec4(0, 0, 128, 128));
+
+	// A -> B -> C -> view, the first and last transient never live at once
+	RenderGraphResource a = RenderGraph::InvalidResource, b = RenderGraph::InvalidResource, c = RenderGraph::InvalidResource;
+	graph.AddPass("A", [&](RenderGraph::Builder& builder) { a = builder.Write(builder.Create("A", desc)); }, Nothing);
+	graph.AddPass("B", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(a);
+		b = builder.Write(builder.Create("B", desc));
+	}, Nothing);
+	graph.AddPass("C", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(b);
+		c = builder.Write(builder.Create("C", desc));
+	}, Nothing);
+	graph.AddPass("Resolve", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(c);
+		builder.Write(view);
+	}, Nothing);
+
+	graph.Compile();
+	CHECK(graph.GetStats().PassesCulled == 0);
+	CHECK(graph.GetStats().TransientTextures == 3);
+	CHECK(graph.GetStats().PhysicalTextures == 2);
+	// First loads of a transient become clears, it holds what its previous owner left
+	CHECK(graph.GetStats().Clears == 3);
+
+	// Next frame the same graph reuses the pool
+	const size_t created = FakeGL::nextName;
+	graph.Reset();
+	graph.AddPass("A", [&](RenderGraph::Builder& builder) { a = builder.Write(builder.Create("A", desc)); }, Nothing);
+	graph.AddPass("Resolve", [&](RenderGraph::Builder& builder)
+	{
+		builder.Read(a);
+		builder.Write(graph.ImportFramebuffer("View", 0, glm::ivec4(0, 0, 128, 128)));
+	}, Nothing);
+	graph.Compile();
+	CHECK(FakeGL::nextName == created);
+	CHECK(graph.GetStats().PooledTextures == 2);
+}
+
+static void TestRetireSize()
+{
+	RenderGraph graph;
+	const glm::ivec2 sizes[] = { glm::ivec2(200, 100), glm::ivec2(150, 75) };
+	for (const glm::ivec2& size : sizes)
+	{
+		graph.Reset();
+		const RenderGraphResource view = graph.ImportFramebuffer("View", 0, glm::ivec4(0, 0, size.x, size.y));
+		RenderGraphResource color = RenderGraph::InvalidResource;
+		graph.AddPass("Scene", [&](RenderGraph::Builder& builder)
+		{
+			color = builder.Write(builder.Create("Color", { size.x, size.y, FrameBufferFormat::RGBA8 }));
+		}, Nothing);
+		graph.AddPass("Resolve", [&](RenderGraph::Builder& builder)
+		{
+			builder.Read(color);
+			builder.Write(view);
+		}, Nothing);
+		graph.Compile();
+	}
+	CHECK(FakeGL::CountTextures(sizes[0]) == 1 && FakeGL::CountTextures(sizes[1]) == 1);
+
+	// Only the size that was given up goes, once the frames in flight are done with it
+	graph.RetireSize(sizes[0]);
+	graph.Reset();
+	graph.Compile();
+	CHECK(graph.GetStats().PooledTextures == 1);
+	GLDeletionQueue::Flush();
+	CHECK(FakeGL::CountTextures(sizes[0]) == 0 && FakeGL::CountTextures(sizes[1]) == 1);
+}
+
+int main()
+{
+	FakeGL::Install();
+
+	TestPassCulling();
+	TestAliasing();
+	TestRetireSize();
+
+	if (failures == 0)
+		std::printf("RenderGraph: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}
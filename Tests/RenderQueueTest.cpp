@@ -0,0 +1,104 @@
+#include "Rendering/RenderQueue.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+/*
+	Sorts queues of random keys with the radix sort and compares the order with a
+	stable sort of the same keys, then checks the draw order the key layout gives.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+// The model matrix carries the packet's push position
+static DrawPacket Packet(uint64_t key, size_t id)
+{
+	DrawPacket packet{};
+	packet.Key = key;
+	packet.Model[0][0] = static_cast<float>(id);
+	return packet;
+}
+
+static size_t Id(const DrawPacket& packet)
+{
+	return static_cast<size_t>(packet.Model[0][0]);
+}
+
+// Positions in push order, sorted like the queue has to
+static std::vector<size_t> ExpectedOrder(const std::vector<uint64_t>& keys)
+{
+	std::vector<size_t> order(keys.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+	return order;
+}
+
+static void CheckSorted(RenderQueue& queue, const std::vector<uint64_t>& keys)
+{
+	queue.Clear();
+	for (size_t i = 0; i < keys.size(); i++)
+		queue.Push(Packet(keys[i], i));
+	queue.Sort();
+
+	const std::vector<size_t> expected = ExpectedOrder(keys);
+	bool same = queue.Size() == expected.size();
+	for (size_t i = 0; same && i < expected.size(); i++)
+		same = Id(queue[i]) == expected[i];
+	CHECK(same);
+}
+
+static void TestRadixSortMatchesStableSort()
+{
+	std::mt19937_64 random(42);
+	RenderQueue queue;
+
+	std::vector<uint64_t> keys(5000);
+	for (uint64_t& key : keys)
+		key = random();
+	CheckSorted(queue, keys);
+
+	// Few distinct values, so most digit passes are skipped and ties have to stay in push order
+	for (uint64_t& key : keys)
+		key = (random() % 4) << 62 | (random() % 3) << 17;
+	CheckSorted(queue, keys);
+
+	// Every key equal, nothing may move
+	std::fill(keys.begin(), keys.end(), 0x123456789ABCDEFull);
+	CheckSorted(queue, keys);
+
+	CheckSorted(queue, {});
+	CheckSorted(queue, { 7 });
+}
+
+static void TestKeyOrder()
+{
+	RenderQueue queue;
+	// Translucent, far before near
+	queue.Push(Packet(RenderQueue::MakeKey(RenderPass::Main, true, 1, 1, 1, 0.2f), 0));
+	queue.Push(Packet(RenderQueue::MakeKey(RenderPass::Main, true, 1, 1, 1, 0.9f), 1));
+	// Opaque, grouped by shader, then near before far
+	queue.Push(Packet(RenderQueue::MakeKey(RenderPass::Main, false, 2, 1, 1, 0.1f), 2));
+	queue.Push(Packet(RenderQueue::MakeKey(RenderPass::Main, false, 1, 1, 1, 0.8f), 3));
+	queue.Push(Packet(RenderQueue::MakeKey(RenderPass::Main, false, 1, 1, 1, 0.3f), 4));
+	queue.Sort();
+
+	const size_t expected[] = { 4, 3, 2, 1, 0 };
+	CHECK(queue.Size() == 5);
+	for (size_t i = 0; i < 5; i++)
+		CHECK(Id(queue[i]) == expected[i]);
+	CHECK(!RenderQueue::IsTranslucent(queue[2].Key) && RenderQueue::IsTranslucent(queue[3].Key));
+}
+
+int main()
+{
+	TestRadixSortMatchesStableSort();
+	TestKeyOrder();
+
+	if (failures == 0)
+		std::printf("RenderQueue: all checks passed\n");
+	return failures == 0 ? 0 : 1;
+}